@@ -0,0 +1,108 @@
+#include "audio_source.h"
+#include "audio_source_backend.h"
+#include <iostream>
+
+// C接口实现
+extern "C" {
+
+void audio_source_default_config(AudioSourceConfig* config) {
+#ifdef _WIN32
+    config->type = AUDIO_SOURCE_WASAPI;
+#else
+    config->type = AUDIO_SOURCE_SYNTH;
+#endif
+    config->path = nullptr;
+    config->pid = 0;
+    config->event_driven = 1;
+    config->sample_rate = 48000;
+    config->channels = 1;
+    config->pcm_format = AUDIO_PCM_S16;
+    config->synth_signal = AUDIO_SYNTH_SINE;
+    config->synth_frequency = 440.0f;
+    config->synth_amplitude = 0.3f;
+    config->duration_s = 0.0;
+    config->pace = 1.0f;
+    config->packet_frames = 0;
+    config->synth_gap_interval_s = 0.0;
+    config->synth_gap_ms = 200.0;
+    config->channel_weights = nullptr;
+    config->n_channel_weights = 0;
+    config->capture_cpu = -1;
+    config->realtime_priority = 0;
+}
+
+void* audio_source_create(const AudioSourceConfig* config) {
+    switch (config->type) {
+    case AUDIO_SOURCE_WAV:
+        return create_wav_source(*config);
+    case AUDIO_SOURCE_PCM_PIPE:
+        return create_pcm_pipe_source(*config);
+    case AUDIO_SOURCE_SYNTH:
+        return create_synth_source(*config);
+    case AUDIO_SOURCE_WASAPI:
+#ifdef _WIN32
+        return create_wasapi_source(*config);
+#else
+        std::cerr << "WASAPI audio source is only available on Windows" << std::endl;
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+void audio_source_destroy(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    delete source;
+}
+
+int audio_source_initialize(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->initialize() ? 1 : 0;
+}
+
+int audio_source_start(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->start() ? 1 : 0;
+}
+
+void audio_source_stop(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    source->stop();
+}
+
+void audio_source_set_callback(void* handle, audio_callback callback, void* user_data) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    source->set_callback(callback, user_data);
+}
+
+int audio_source_get_format(void* handle, AudioFormat* format) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->get_format(format) ? 1 : 0;
+}
+
+void audio_source_set_chunk_callback(void* handle, audio_chunk_callback callback, void* user_data) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    source->set_chunk_callback(callback, user_data);
+}
+
+int audio_source_enable_read(void* handle, int capacity_frames) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return capacity_frames > 0 && source->enable_read((size_t)capacity_frames) ? 1 : 0;
+}
+
+int audio_source_read(void* handle, float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->read(dst, max_frames, timeout_ms, position, flags);
+}
+
+int audio_source_is_finished(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->is_finished() ? 1 : 0;
+}
+
+int audio_source_is_live(void* handle) {
+    auto* source = static_cast<AudioSourceBackend*>(handle);
+    return source->is_live() ? 1 : 0;
+}
+
+}
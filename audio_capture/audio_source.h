@@ -0,0 +1,96 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include "audio_types.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 音频源类型
+typedef enum {
+    AUDIO_SOURCE_WASAPI = 0,   // Windows系统/进程音频（仅Windows）
+    AUDIO_SOURCE_WAV,          // WAV文件
+    AUDIO_SOURCE_PCM_PIPE,     // 原始PCM：stdin或命名管道
+    AUDIO_SOURCE_SYNTH         // 合成信号发生器
+} AudioSourceType;
+
+// 原始PCM样本格式
+typedef enum {
+    AUDIO_PCM_S16 = 0,
+    AUDIO_PCM_F32
+} AudioPcmFormat;
+
+// 合成信号类型
+typedef enum {
+    AUDIO_SYNTH_SINE = 0,      // 正弦波
+    AUDIO_SYNTH_NOISE,         // 白噪声
+    AUDIO_SYNTH_SILENCE,       // 静音
+    AUDIO_SYNTH_BURSTS         // 间歇的调制音（模拟语音段/停顿交替）
+} AudioSynthSignal;
+
+// 音频源配置
+typedef struct {
+    AudioSourceType type;
+    const char* path;            // WAV文件路径 / PCM管道路径（"-" 表示stdin）
+    unsigned int pid;            // WASAPI：捕获指定进程，0表示系统音频
+    int event_driven;            // WASAPI：事件驱动捕获，0表示轮询
+
+    unsigned int sample_rate;    // PCM/合成源采样率
+    unsigned int channels;       // PCM/合成源声道数
+    AudioPcmFormat pcm_format;   // PCM样本格式
+
+    AudioSynthSignal synth_signal;
+    float synth_frequency;       // 合成信号频率(Hz)
+    float synth_amplitude;       // 合成信号幅度 [0-1]
+    double duration_s;           // 合成信号时长(秒)，0表示无限
+
+    float pace;                  // 投递速度：1.0为实时，2.0为两倍速，0为尽可能快
+    unsigned int packet_frames;  // 每次回调的帧数，0表示10ms
+
+    double synth_gap_interval_s; // 合成信号：每隔多少秒模拟一次数据丢失，0表示不丢失
+    double synth_gap_ms;         // 合成信号：每次丢失的时长(ms)，默认200
+
+    const float* channel_weights;    // WASAPI：下混为单声道时各声道的权重，NULL表示平均（创建时复制）
+    unsigned int n_channel_weights;
+
+    int capture_cpu;             // 采集/读取线程固定到的逻辑CPU，-1表示不固定
+    int realtime_priority;       // 采集/读取线程提升为实时优先级（Windows为MMCSS "Pro Audio"，Linux为SCHED_FIFO）
+} AudioSourceConfig;
+
+void audio_source_default_config(AudioSourceConfig* config);
+
+void* audio_source_create(const AudioSourceConfig* config);
+void audio_source_destroy(void* handle);
+int audio_source_initialize(void* handle);
+int audio_source_start(void* handle);
+void audio_source_stop(void* handle);
+void audio_source_set_callback(void* handle, audio_callback callback, void* user_data);
+int audio_source_get_format(void* handle, AudioFormat* format);
+
+// 带时间信息的回调（采集位置、采集时刻、静音/不连续标志），可与audio_source_set_callback同时使用
+void audio_source_set_chunk_callback(void* handle, audio_chunk_callback callback, void* user_data);
+
+// 拉取式读取：启用后音频源把单声道样本写入容量为capacity_frames帧的内部环形缓冲，
+// 消费者用audio_source_read按自选批量读取，适合每次调用开销较大的绑定层（可与回调同时使用）。
+// 需在start之前调用，成功返回1。实时捕获在缓冲满时丢弃新数据，文件/管道/合成源则等待读取
+int audio_source_enable_read(void* handle, int capacity_frames);
+
+// 读取最多max_frames帧：等待直到凑满max_frames、超时或音频源结束/停止。
+// timeout_ms为0时不等待，小于0时一直等待。返回读取的帧数（超时可能为0），已结束且缓冲为空时返回-1。
+// position（可为NULL）返回首帧在采集流中的位置（帧，与AudioChunkInfo.position相同，丢弃或丢失的帧也计入）；
+// flags（可为NULL）在这批之前有帧丢失时含AUDIO_CHUNK_DISCONTINUITY。一批内的帧总是连续的，遇到间断时提前返回
+int audio_source_read(void* handle, float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags);
+
+// 有限长度的音频源（文件、管道EOF、定长合成信号）投递完毕后返回1
+int audio_source_is_finished(void* handle);
+
+// 实时捕获设备返回1（需由用户停止）；文件、管道、合成信号返回0
+int audio_source_is_live(void* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_SOURCE_H
@@ -0,0 +1,52 @@
+#ifndef AUDIO_SOURCE_BACKEND_H
+#define AUDIO_SOURCE_BACKEND_H
+
+#include "audio_source.h"
+#include <cstddef>
+#include <cstdint>
+
+// 音频源后端基类，audio_source_* C接口转发到具体实现
+class AudioSourceBackend {
+public:
+    virtual ~AudioSourceBackend() = default;
+
+    virtual bool initialize() = 0;
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual bool get_format(AudioFormat* format) = 0;
+    virtual bool is_finished() const { return false; }
+    virtual bool is_live() const { return false; }
+
+    // 拉取式读取，见audio_source_enable_read/audio_source_read
+    virtual bool enable_read(size_t capacity_frames) { (void)capacity_frames; return false; }
+    virtual int read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+        (void)dst; (void)max_frames; (void)timeout_ms; (void)position; (void)flags;
+        return -1;
+    }
+
+    void set_callback(audio_callback callback, void* user_data) {
+        callback_ = callback;
+        user_data_ = user_data;
+    }
+
+    void set_chunk_callback(audio_chunk_callback callback, void* user_data) {
+        chunk_callback_ = callback;
+        chunk_user_data_ = user_data;
+    }
+
+protected:
+    audio_callback callback_ = nullptr;
+    void* user_data_ = nullptr;
+    audio_chunk_callback chunk_callback_ = nullptr;
+    void* chunk_user_data_ = nullptr;
+};
+
+// 各后端的创建函数，失败返回nullptr
+AudioSourceBackend* create_wav_source(const AudioSourceConfig& config);
+AudioSourceBackend* create_pcm_pipe_source(const AudioSourceConfig& config);
+AudioSourceBackend* create_synth_source(const AudioSourceConfig& config);
+#ifdef _WIN32
+AudioSourceBackend* create_wasapi_source(const AudioSourceConfig& config);
+#endif
+
+#endif // AUDIO_SOURCE_BACKEND_H
@@ -0,0 +1,38 @@
+#ifndef AUDIO_TYPES_H
+#define AUDIO_TYPES_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 音频数据回调：buffer为单声道float样本，frames为帧数
+typedef void (*audio_callback)(void* user_data, float* buffer, int frames);
+
+// 音频块标志
+#define AUDIO_CHUNK_SILENT          0x1u   // 设备报告为静音，buffer为全零
+#define AUDIO_CHUNK_DISCONTINUITY   0x2u   // 与上一块之间有数据丢失，position已跳过丢失的帧
+
+// 音频块的时间信息
+typedef struct {
+    uint64_t position;       // 首帧在采集流中的位置（帧，采集采样率），单调递增，丢失的帧也计入
+    int64_t capture_ns;      // 首帧的采集时刻，steady_clock纳秒（Windows上即QPC时间）
+    unsigned int flags;      // AUDIO_CHUNK_*
+} AudioChunkInfo;
+
+// 带时间信息的音频数据回调，与audio_callback相同的数据，静音块也会投递
+typedef void (*audio_chunk_callback)(void* user_data, const float* buffer, int frames, const AudioChunkInfo* info);
+
+// 音频格式结构体
+typedef struct {
+    unsigned int sample_rate;
+    unsigned int channels;
+    unsigned int bits_per_sample;
+} AudioFormat;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_TYPES_H
@@ -0,0 +1,92 @@
+#ifndef AUDIO_NOTIFIER_H
+#define AUDIO_NOTIFIER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// 生产者→消费者的数据就绪通知（条件变量/eventfd风格）
+// 消费者设置唤醒阈值后阻塞等待；生产者每次写入后调用notify()，
+// 只有在消费者正在等待且可读数据达到阈值时才加锁唤醒，其余情况只有几次原子操作。
+// 同时记录数据达到阈值的时刻，用于统计"唤醒到处理"的延迟。
+class AudioNotifier {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // ---- 生产者 ----
+
+    // 写入数据后调用，available为当前可读数据量
+    void notify(size_t available) {
+        if (available < threshold_.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        // 记录首次达到阈值的时刻，消费者处理时取走
+        int64_t expected = 0;
+        ready_ns_.compare_exchange_strong(expected, now_ns(), std::memory_order_relaxed);
+
+        // 与消费者的waiting_写入配对，避免丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    // 无条件唤醒（输入结束、停止等）
+    void wake() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            signaled_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // ---- 消费者 ----
+
+    // 设置唤醒阈值：可读数据达到threshold时才通知，同时清除旧阈值下的就绪时刻
+    void set_threshold(size_t threshold) {
+        threshold_.store(threshold > 0 ? threshold : 1, std::memory_order_relaxed);
+        ready_ns_.store(0, std::memory_order_relaxed);
+    }
+
+    // 等待直到available()达到阈值、被wake()唤醒或超时；返回等待结束时是否达到阈值
+    template <typename Available, typename Rep, typename Period>
+    bool wait(Available available, const std::chrono::duration<Rep, Period>& timeout) {
+        const size_t threshold = threshold_.load(std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // 发布等待标志后再检查一次，防止生产者在此之前写入而未唤醒
+        if (available() < threshold && !signaled_) {
+            cv_.wait_for(lock, timeout, [&] { return signaled_; });
+        }
+        signaled_ = false;
+        waiting_.store(false, std::memory_order_relaxed);
+        return available() >= threshold;
+    }
+
+    // 取出数据达到阈值的时刻（纳秒，steady_clock），没有记录时返回0
+    int64_t take_ready_time() {
+        return ready_ns_.exchange(0, std::memory_order_relaxed);
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<size_t> threshold_{1};
+    std::atomic<bool> waiting_{false};
+    std::atomic<int64_t> ready_ns_{0};
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool signaled_ = false;
+};
+
+#endif // AUDIO_NOTIFIER_H
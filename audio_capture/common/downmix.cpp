@@ -0,0 +1,385 @@
+#include "downmix.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define DOWNMIX_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define DOWNMIX_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC/Clang需要按函数开启AVX2，MSVC可直接使用
+#if defined(DOWNMIX_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DOWNMIX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DOWNMIX_TARGET_AVX2
+#endif
+
+namespace {
+
+// ---- 标量内核 ----
+
+const int MAX_LOCAL_CHANNELS = 32;
+
+void downmix_scalar(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    // 权重复制到局部数组：否则编译器无法排除out与weights重叠，每帧都要重新加载权重
+    float w[MAX_LOCAL_CHANNELS];
+    if (channels <= MAX_LOCAL_CHANNELS) {
+        std::copy(weights, weights + channels, w);
+        weights = w;
+    }
+    for (size_t i = 0; i < frames; i++) {
+        const float* frame = in + i * channels;
+        float sum = 0.0f;
+        for (int ch = 0; ch < channels; ch++) {
+            sum += frame[ch] * weights[ch];
+        }
+        out[i] = sum;
+    }
+}
+
+void downmix_scalar_1(const float* in, float* out, size_t frames, int, const float* weights) {
+    const float w = weights[0];
+    for (size_t i = 0; i < frames; i++) {
+        out[i] = in[i] * w;
+    }
+}
+
+void downmix_scalar_2(const float* in, float* out, size_t frames, int, const float* weights) {
+    const float w0 = weights[0], w1 = weights[1];
+    for (size_t i = 0; i < frames; i++) {
+        out[i] = in[2 * i] * w0 + in[2 * i + 1] * w1;
+    }
+}
+
+#ifdef DOWNMIX_X86
+
+// ---- SSE2 ----
+
+// 4个向量各自水平求和，结果依次放入返回向量的4个通道
+inline __m128 hsum4_sse(__m128 a, __m128 b, __m128 c, __m128 d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    return _mm_add_ps(_mm_add_ps(a, b), _mm_add_ps(c, d));
+}
+
+void downmix_sse2_1(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m128 w = _mm_set1_ps(weights[0]);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), w));
+    }
+    downmix_scalar_1(in + i, out + i, frames - i, channels, weights);
+}
+
+void downmix_sse2_2(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m128 w = _mm_setr_ps(weights[0], weights[1], weights[0], weights[1]);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_mul_ps(_mm_loadu_ps(in + 2 * i), w);      // f0 f0 f1 f1
+        const __m128 b = _mm_mul_ps(_mm_loadu_ps(in + 2 * i + 4), w);  // f2 f2 f3 f3
+        const __m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_add_ps(even, odd));
+    }
+    downmix_scalar_2(in + 2 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_sse2_4(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m128 w = _mm_loadu_ps(weights);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float* p = in + 4 * i;
+        _mm_storeu_ps(out + i, hsum4_sse(_mm_mul_ps(_mm_loadu_ps(p), w), _mm_mul_ps(_mm_loadu_ps(p + 4), w),
+                                         _mm_mul_ps(_mm_loadu_ps(p + 8), w), _mm_mul_ps(_mm_loadu_ps(p + 12), w)));
+    }
+    downmix_scalar(in + 4 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_sse2_6(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    // 每2帧12个样本对应3个向量：[f0c0-3] [f0c4-5 f1c0-1] [f1c2-5]
+    const __m128 wa = _mm_loadu_ps(weights);
+    const __m128 wb = _mm_setr_ps(weights[4], weights[5], weights[0], weights[1]);
+    const __m128 wc = _mm_loadu_ps(weights + 2);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float* p = in + 6 * i;
+        __m128 f[4];
+        for (int k = 0; k < 2; k++) {
+            const __m128 a = _mm_mul_ps(_mm_loadu_ps(p + 12 * k), wa);
+            const __m128 b = _mm_mul_ps(_mm_loadu_ps(p + 12 * k + 4), wb);
+            const __m128 c = _mm_mul_ps(_mm_loadu_ps(p + 12 * k + 8), wc);
+            f[2 * k] = _mm_add_ps(a, _mm_movelh_ps(b, zero));
+            f[2 * k + 1] = _mm_add_ps(c, _mm_movehl_ps(zero, b));
+        }
+        _mm_storeu_ps(out + i, hsum4_sse(f[0], f[1], f[2], f[3]));
+    }
+    downmix_scalar(in + 6 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_sse2_8(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m128 wlo = _mm_loadu_ps(weights);
+    const __m128 whi = _mm_loadu_ps(weights + 4);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float* p = in + 8 * i;
+        __m128 f[4];
+        for (int k = 0; k < 4; k++) {
+            f[k] = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(p + 8 * k), wlo), _mm_mul_ps(_mm_loadu_ps(p + 8 * k + 4), whi));
+        }
+        _mm_storeu_ps(out + i, hsum4_sse(f[0], f[1], f[2], f[3]));
+    }
+    downmix_scalar(in + 8 * i, out + i, frames - i, channels, weights);
+}
+
+// ---- AVX2 ----
+
+DOWNMIX_TARGET_AVX2
+void downmix_avx2_1(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m256 w = _mm256_set1_ps(weights[0]);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), w));
+    }
+    downmix_scalar_1(in + i, out + i, frames - i, channels, weights);
+}
+
+DOWNMIX_TARGET_AVX2
+void downmix_avx2_2(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m256 w = _mm256_setr_ps(weights[0], weights[1], weights[0], weights[1],
+                                    weights[0], weights[1], weights[0], weights[1]);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i), w);       // f0-f3
+        const __m256 b = _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i + 8), w);   // f4-f7
+        // hadd结果为[f0 f1 f4 f5 | f2 f3 f6 f7]，按64位重排为f0-f7
+        const __m256 s = _mm256_hadd_ps(a, b);
+        _mm256_storeu_ps(out + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    downmix_scalar_2(in + 2 * i, out + i, frames - i, channels, weights);
+}
+
+DOWNMIX_TARGET_AVX2
+void downmix_avx2_8(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const __m256 w = _mm256_loadu_ps(weights);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const float* p = in + 8 * i;
+        __m256 f[8];
+        for (int k = 0; k < 8; k++) {
+            f[k] = _mm256_mul_ps(_mm256_loadu_ps(p + 8 * k), w);
+        }
+        // 两级hadd得到每帧两个128位半部的部分和，再交叉相加
+        const __m256 t0 = _mm256_hadd_ps(f[0], f[1]);
+        const __m256 t1 = _mm256_hadd_ps(f[2], f[3]);
+        const __m256 t2 = _mm256_hadd_ps(f[4], f[5]);
+        const __m256 t3 = _mm256_hadd_ps(f[6], f[7]);
+        const __m256 u0 = _mm256_hadd_ps(t0, t1);   // [f0-3低半部 | f0-3高半部]
+        const __m256 u1 = _mm256_hadd_ps(t2, t3);   // [f4-7低半部 | f4-7高半部]
+        const __m256 lo = _mm256_permute2f128_ps(u0, u1, 0x20);
+        const __m256 hi = _mm256_permute2f128_ps(u0, u1, 0x31);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(lo, hi));
+    }
+    downmix_scalar(in + 8 * i, out + i, frames - i, channels, weights);
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;    // 操作系统保存YMM状态
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7) return false;
+    __cpuid(1, eax, ebx, ecx, edx);
+    const bool osxsave = (ecx & (1u << 27)) != 0;
+    const bool avx = (ecx & (1u << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6) != 0x6) return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & (1u << 5)) != 0;
+#endif
+}
+
+#endif // DOWNMIX_X86
+
+#ifdef DOWNMIX_NEON
+
+// ---- NEON (AArch64) ----
+
+void downmix_neon_1(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const float32x4_t w = vdupq_n_f32(weights[0]);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), w));
+    }
+    downmix_scalar_1(in + i, out + i, frames - i, channels, weights);
+}
+
+void downmix_neon_2(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const float32x4_t w0 = vdupq_n_f32(weights[0]);
+    const float32x4_t w1 = vdupq_n_f32(weights[1]);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4x2_t v = vld2q_f32(in + 2 * i);     // 解交错为左/右声道
+        vst1q_f32(out + i, vmlaq_f32(vmulq_f32(v.val[0], w0), v.val[1], w1));
+    }
+    downmix_scalar_2(in + 2 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_neon_4(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    const float32x4_t w0 = vdupq_n_f32(weights[0]);
+    const float32x4_t w1 = vdupq_n_f32(weights[1]);
+    const float32x4_t w2 = vdupq_n_f32(weights[2]);
+    const float32x4_t w3 = vdupq_n_f32(weights[3]);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4x4_t v = vld4q_f32(in + 4 * i);     // 解交错为4个声道
+        vst1q_f32(out + i, vmlaq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[0], w0), v.val[1], w1), v.val[2], w2), v.val[3], w3));
+    }
+    downmix_scalar(in + 4 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_neon_6(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    // vld3q按3路解交错2帧：val[k] = [f0c(k) f0c(k+3) f1c(k) f1c(k+3)]
+    float32x4_t w[3];
+    for (int k = 0; k < 3; k++) {
+        const float wk[4] = { weights[k], weights[k + 3], weights[k], weights[k + 3] };
+        w[k] = vld1q_f32(wk);
+    }
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t s[2];
+        for (int j = 0; j < 2; j++) {
+            const float32x4x3_t v = vld3q_f32(in + 6 * i + 12 * j);
+            s[j] = vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[0], w[0]), v.val[1], w[1]), v.val[2], w[2]);
+        }
+        vst1q_f32(out + i, vpaddq_f32(s[0], s[1]));
+    }
+    downmix_scalar(in + 6 * i, out + i, frames - i, channels, weights);
+}
+
+void downmix_neon_8(const float* in, float* out, size_t frames, int channels, const float* weights) {
+    // vld4q按4路解交错2帧：val[k] = [f0c(k) f0c(k+4) f1c(k) f1c(k+4)]
+    float32x4_t w[4];
+    for (int k = 0; k < 4; k++) {
+        const float wk[4] = { weights[k], weights[k + 4], weights[k], weights[k + 4] };
+        w[k] = vld1q_f32(wk);
+    }
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t s[2];
+        for (int j = 0; j < 2; j++) {
+            const float32x4x4_t v = vld4q_f32(in + 8 * i + 16 * j);
+            s[j] = vmlaq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[0], w[0]), v.val[1], w[1]), v.val[2], w[2]), v.val[3], w[3]);
+        }
+        vst1q_f32(out + i, vpaddq_f32(s[0], s[1]));
+    }
+    downmix_scalar(in + 8 * i, out + i, frames - i, channels, weights);
+}
+
+#endif // DOWNMIX_NEON
+
+} // namespace
+
+DownmixIsa downmix_detect_isa() {
+#if defined(DOWNMIX_X86)
+    static const DownmixIsa isa = cpu_has_avx2() ? DOWNMIX_ISA_AVX2 : DOWNMIX_ISA_SSE2;
+    return isa;
+#elif defined(DOWNMIX_NEON)
+    return DOWNMIX_ISA_NEON;
+#else
+    return DOWNMIX_ISA_SCALAR;
+#endif
+}
+
+const char* downmix_isa_name(DownmixIsa isa) {
+    switch (isa) {
+    case DOWNMIX_ISA_AUTO: return downmix_isa_name(downmix_detect_isa());
+    case DOWNMIX_ISA_SCALAR: return "scalar";
+    case DOWNMIX_ISA_SSE2: return "sse2";
+    case DOWNMIX_ISA_AVX2: return "avx2";
+    case DOWNMIX_ISA_NEON: return "neon";
+    }
+    return "unknown";
+}
+
+downmix_kernel downmix_get_kernel(DownmixIsa isa, int channels) {
+    if (isa == DOWNMIX_ISA_AUTO) {
+        isa = downmix_detect_isa();
+    }
+
+    switch (isa) {
+    case DOWNMIX_ISA_SCALAR:
+        return channels == 1 ? downmix_scalar_1 : channels == 2 ? downmix_scalar_2 : downmix_scalar;
+#ifdef DOWNMIX_X86
+    case DOWNMIX_ISA_AVX2:
+        if (!cpu_has_avx2()) return nullptr;
+        switch (channels) {
+        case 1: return downmix_avx2_1;
+        case 2: return downmix_avx2_2;
+        case 4: return downmix_sse2_4;  // 4/6声道帧与256位寄存器不对齐，沿用SSE2内核
+        case 6: return downmix_sse2_6;
+        case 8: return downmix_avx2_8;
+        default: return downmix_scalar;
+        }
+    case DOWNMIX_ISA_SSE2:
+        switch (channels) {
+        case 1: return downmix_sse2_1;
+        case 2: return downmix_sse2_2;
+        case 4: return downmix_sse2_4;
+        case 6: return downmix_sse2_6;
+        case 8: return downmix_sse2_8;
+        default: return downmix_scalar;
+        }
+#endif
+#ifdef DOWNMIX_NEON
+    case DOWNMIX_ISA_NEON:
+        switch (channels) {
+        case 1: return downmix_neon_1;
+        case 2: return downmix_neon_2;
+        case 4: return downmix_neon_4;
+        case 6: return downmix_neon_6;
+        case 8: return downmix_neon_8;
+        default: return downmix_scalar;
+        }
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+bool Downmixer::init(int channels, const float* weights, DownmixIsa isa) {
+    if (channels <= 0) return false;
+
+    const DownmixIsa selected = isa == DOWNMIX_ISA_AUTO ? downmix_detect_isa() : isa;
+    downmix_kernel kernel = downmix_get_kernel(selected, channels);
+    if (!kernel) return false;
+
+    channels_ = channels;
+    isa_ = selected;
+    kernel_ = kernel;
+    if (weights) {
+        weights_.assign(weights, weights + channels);
+    } else {
+        weights_.assign(channels, 1.0f / channels);
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef DOWNMIX_H
+#define DOWNMIX_H
+
+#include <cstddef>
+#include <vector>
+
+// 下混内核使用的指令集
+enum DownmixIsa {
+    DOWNMIX_ISA_AUTO = 0,   // 运行时检测
+    DOWNMIX_ISA_SCALAR,
+    DOWNMIX_ISA_SSE2,
+    DOWNMIX_ISA_AVX2,
+    DOWNMIX_ISA_NEON
+};
+
+// 交错多声道 → 单声道下混内核：out[i] = Σ in[i*channels + ch] * weights[ch]
+typedef void (*downmix_kernel)(const float* in, float* out, size_t frames, int channels, const float* weights);
+
+// 交错多声道float → 单声道的向量化下混
+// 1/2/4/6/8声道有专门的SSE2/AVX2/NEON内核，其他声道数使用通用内核；
+// 指令集在init()时按CPU运行时选择，process()中没有按样本的分支。
+class Downmixer {
+public:
+    // weights为nullptr时各声道取平均（权重1/channels）；isa可强制指定指令集（用于测试与性能对比）
+    bool init(int channels, const float* weights = nullptr, DownmixIsa isa = DOWNMIX_ISA_AUTO);
+
+    // 下混frames帧，in与out不能重叠
+    void process(const float* in, float* out, size_t frames) const {
+        kernel_(in, out, frames, channels_, weights_.data());
+    }
+
+    int channels() const { return channels_; }
+    DownmixIsa isa() const { return isa_; }
+    const float* weights() const { return weights_.data(); }
+
+private:
+    int channels_ = 1;
+    DownmixIsa isa_ = DOWNMIX_ISA_SCALAR;
+    downmix_kernel kernel_ = nullptr;
+    std::vector<float> weights_;
+};
+
+// 当前CPU支持的最佳指令集
+DownmixIsa downmix_detect_isa();
+
+// 指令集名称
+const char* downmix_isa_name(DownmixIsa isa);
+
+// 查找指定指令集和声道数的内核，该指令集不可用时返回nullptr
+downmix_kernel downmix_get_kernel(DownmixIsa isa, int channels);
+
+#endif // DOWNMIX_H
@@ -0,0 +1,187 @@
+#ifndef PULL_READER_H
+#define PULL_READER_H
+
+#include "spsc_ring.h"
+#include "audio_notifier.h"
+#include "audio_types.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// 拉取式读取缓冲：采集线程把单声道样本写入无锁环形缓冲，消费者按自己选择的批量阻塞读取。
+// 相比每个设备包（约10ms）一次回调，绑定层（如cgo）可以一次跨越取走任意多帧。
+// 每批返回首帧在采集流中的位置（与AudioChunkInfo.position相同，丢弃和丢失的帧也计入），
+// 位置跳变处记一个间断标记，读取不跨越间断。生产者与消费者各自只能有一个线程。
+class PullReader {
+public:
+    // 分配容量（帧），非线程安全，只能在采集开始前调用
+    void reset(size_t capacity_frames) {
+        ring_.reset(capacity_frames);
+        gaps_.reset(capacity_frames > 0 ? MAX_GAPS : 0);
+        written_ = 0;
+        write_pos_ = 0;
+        have_write_pos_ = false;
+        ring_read_ = 0;
+        read_pos_ = 0;
+        read_flags_ = 0;
+        dropped_.store(0, std::memory_order_relaxed);
+        finished_.store(false, std::memory_order_relaxed);
+        enabled_ = capacity_frames > 0;
+    }
+
+    bool enabled() const { return enabled_; }
+    size_t capacity() const { return ring_.capacity(); }
+
+    // ---- 生产者 ----
+
+    // 原地写入frames帧，首帧位于采集流的position，flags为AUDIO_CHUNK_*（只关心AUDIO_CHUNK_DISCONTINUITY）。
+    // fill(dst, offset, n)把第offset帧起的n帧写到dst，最多调用两次（环绕时）。
+    // 空间不足时丢弃多余的新数据并计入dropped，返回实际写入帧数
+    template <typename Fill>
+    size_t write_with(size_t frames, uint64_t position, unsigned int flags, Fill fill) {
+        float* first;
+        float* second;
+        size_t first_n, second_n;
+        const size_t n = std::min(frames, ring_.prepare(&first, &first_n, &second, &second_n));
+        if (n == 0 || !mark_gap(position, flags)) {
+            account(frames, 0);
+            return 0;
+        }
+        const size_t n1 = std::min(n, first_n);
+        if (n1 > 0) fill(first, (size_t)0, n1);
+        if (n > n1) fill(second, n1, n - n1);
+        ring_.commit(n);
+        advance(position, n);
+        account(frames, n);
+        return n;
+    }
+
+    size_t write(const float* data, size_t frames, uint64_t position, unsigned int flags) {
+        if (frames == 0 || ring_.write_available() == 0 || !mark_gap(position, flags)) {
+            account(frames, 0);
+            return 0;
+        }
+        const size_t n = ring_.write(data, frames);
+        advance(position, n);
+        account(frames, n);
+        return n;
+    }
+
+    // 可写空间（帧）
+    size_t write_available() const { return ring_.write_available(); }
+
+    // 输入结束或采集停止：唤醒等待中的读取，缓冲读空后read()返回-1
+    void finish() {
+        finished_.store(true, std::memory_order_release);
+        notifier_.wake();
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // ---- 消费者 ----
+
+    // 读取最多max_frames帧到dst：等待直到凑满max_frames、超时或输入结束；遇到间断时提前返回，
+    // 一批内的帧在采集流中连续。timeout_ms为0时不等待，小于0时一直等待。
+    // 返回读取的帧数（超时可能为0），输入已结束且缓冲为空时返回-1。
+    // position（可为空）返回首帧在采集流中的位置（帧）；flags（可为空）在这批与上一批之间有帧丢失时
+    // 含AUDIO_CHUNK_DISCONTINUITY，丢失的帧已计入position
+    int read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+        if (!enabled_ || max_frames <= 0) return enabled_ ? 0 : -1;
+
+        const size_t want = std::min((size_t)max_frames, ring_.capacity());
+        auto available = [this] { return ring_.read_available(); };
+        if (available() < want && timeout_ms != 0) {
+            notifier_.set_threshold(want);
+            const auto deadline = AudioNotifier::clock::now() + std::chrono::milliseconds(timeout_ms);
+            while (available() < want && !finished_.load(std::memory_order_acquire)) {
+                // 不限时等待按固定间隔重新检查，不依赖单次超长的wait_for
+                const auto now = AudioNotifier::clock::now();
+                if (timeout_ms > 0 && now >= deadline) break;
+                const auto slice = timeout_ms > 0 ? deadline - now : AudioNotifier::clock::duration(std::chrono::milliseconds(100));
+                notifier_.wait(available, slice);
+            }
+        }
+
+        // 先取可读帧数：这些帧之前的间断标记一定已经可见
+        size_t n = std::min((size_t)max_frames, available());
+        const Gap* first;
+        const Gap* second;
+        size_t first_n, second_n;
+        while (gaps_.peek(&first, &first_n, &second, &second_n) > 0) {
+            if (first->index > ring_read_) {
+                n = std::min<size_t>(n, (size_t)(first->index - ring_read_));
+                break;
+            }
+            read_pos_ = first->position;
+            read_flags_ |= first->flags;
+            gaps_.consume(1);
+        }
+
+        if (position) *position = read_pos_;
+        if (flags) *flags = n > 0 ? read_flags_ : 0;
+        n = ring_.read(dst, n);
+        if (n == 0 && finished_.load(std::memory_order_acquire) && available() == 0) {
+            return -1;
+        }
+        if (n > 0) read_flags_ = 0;
+        ring_read_ += n;
+        read_pos_ += n;
+        return (int)n;
+    }
+
+private:
+    // 缓冲中一处位置跳变：自第index个写入环形缓冲的帧起，位置为position
+    struct Gap {
+        uint64_t index;
+        uint64_t position;
+        unsigned int flags;
+    };
+    static constexpr size_t MAX_GAPS = 256;
+
+    // 位置与上次写入的结尾不连续（或源报告不连续）时记一个间断标记。缓冲已满时不调用，
+    // 整块丢弃的帧不移动write_pos_，由下一次写入记为间断；标记队列满时返回false，同样整块丢弃
+    bool mark_gap(uint64_t position, unsigned int flags) {
+        const bool discontinuity = have_write_pos_ && (position != write_pos_ || (flags & AUDIO_CHUNK_DISCONTINUITY));
+        if (have_write_pos_ && !discontinuity) {
+            return true;
+        }
+        const Gap gap = { written_, position, discontinuity ? (unsigned int)AUDIO_CHUNK_DISCONTINUITY : 0u };
+        if (gaps_.write(&gap, 1) == 0) {
+            return false;
+        }
+        write_pos_ = position;
+        have_write_pos_ = true;
+        return true;
+    }
+
+    void advance(uint64_t position, size_t written) {
+        written_ += written;
+        write_pos_ = position + written;
+    }
+
+    void account(size_t frames, size_t written) {
+        if (written < frames) {
+            dropped_.fetch_add(frames - written, std::memory_order_relaxed);
+        }
+        notifier_.notify(ring_.read_available());
+    }
+
+    SpscRing<float> ring_;
+    SpscRing<Gap> gaps_;
+    AudioNotifier notifier_;
+    bool enabled_ = false;
+    // 生产者
+    uint64_t written_ = 0;          // 已写入环形缓冲的帧数
+    uint64_t write_pos_ = 0;        // 下一个连续帧在采集流中的位置
+    bool have_write_pos_ = false;
+    // 消费者
+    uint64_t ring_read_ = 0;        // 已从环形缓冲读出的帧数
+    uint64_t read_pos_ = 0;         // 下一个读出的帧在采集流中的位置
+    unsigned int read_flags_ = 0;   // 下一批要报告的标志
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> finished_{false};
+};
+
+#endif // PULL_READER_H
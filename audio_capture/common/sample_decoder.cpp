@@ -0,0 +1,182 @@
+#include "sample_decoder.h"
+#include <cstring>
+
+namespace {
+
+// 每种格式的样本读取：load()返回未归一化的值，归一化系数scale()在内核入口并入权重
+template <SampleFormat F> struct SampleTraits;
+
+template <> struct SampleTraits<SAMPLE_FORMAT_U8> {
+    static const size_t bytes = 1;
+    static float scale() { return 1.0f / 128.0f; }
+    static float load(const uint8_t* p) { return (float)((int)p[0] - 128); }
+};
+
+template <> struct SampleTraits<SAMPLE_FORMAT_S16> {
+    static const size_t bytes = 2;
+    static float scale() { return 1.0f / 32768.0f; }
+    static float load(const uint8_t* p) {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        return (float)v;
+    }
+};
+
+template <> struct SampleTraits<SAMPLE_FORMAT_S24> {
+    static const size_t bytes = 3;
+    static float scale() { return 1.0f / 2147483648.0f; }
+    static float load(const uint8_t* p) {
+        // 放入32位的高24位，符号位随之扩展
+        return (float)(int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+    }
+};
+
+template <> struct SampleTraits<SAMPLE_FORMAT_S32> {
+    static const size_t bytes = 4;
+    static float scale() { return 1.0f / 2147483648.0f; }
+    static float load(const uint8_t* p) {
+        int32_t v;
+        memcpy(&v, p, sizeof(v));
+        return (float)v;
+    }
+};
+
+template <> struct SampleTraits<SAMPLE_FORMAT_F32> {
+    static const size_t bytes = 4;
+    static float scale() { return 1.0f; }
+    static float load(const uint8_t* p) {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+};
+
+template <> struct SampleTraits<SAMPLE_FORMAT_F64> {
+    static const size_t bytes = 8;
+    static float scale() { return 1.0f; }
+    static float load(const uint8_t* p) {
+        double v;
+        memcpy(&v, p, sizeof(v));
+        return (float)v;
+    }
+};
+
+const int MAX_LOCAL_CHANNELS = 32;
+
+// N > 0：声道数为编译期常量，内层循环可完全展开；N == 0：运行时声道数
+template <SampleFormat F, int N>
+void decode_downmix(const uint8_t* in, float* out, size_t frames, int channels, const float* weights) {
+    typedef SampleTraits<F> T;
+    const int n = N > 0 ? N : channels;
+
+    // 归一化系数并入权重；复制到局部数组也避免了out与weights可能重叠导致的重复加载
+    std::vector<float> heap_weights;
+    float local_weights[MAX_LOCAL_CHANNELS];
+    float* w = local_weights;
+    if (n > MAX_LOCAL_CHANNELS) {
+        heap_weights.resize(n);
+        w = heap_weights.data();
+    }
+    for (int ch = 0; ch < n; ch++) {
+        w[ch] = weights[ch] * T::scale();
+    }
+
+    const size_t frame_bytes = T::bytes * n;
+    for (size_t i = 0; i < frames; i++) {
+        const uint8_t* frame = in + i * frame_bytes;
+        float sum = 0.0f;
+        for (int ch = 0; ch < n; ch++) {
+            sum += T::load(frame + ch * T::bytes) * w[ch];
+        }
+        out[i] = sum;
+    }
+}
+
+template <SampleFormat F>
+sample_decode_kernel kernel_for_channels(int channels) {
+    switch (channels) {
+    case 1: return decode_downmix<F, 1>;
+    case 2: return decode_downmix<F, 2>;
+    case 4: return decode_downmix<F, 4>;
+    case 6: return decode_downmix<F, 6>;
+    case 8: return decode_downmix<F, 8>;
+    default: return decode_downmix<F, 0>;
+    }
+}
+
+} // namespace
+
+bool sample_format_from_wave(uint16_t format_tag, unsigned int bits_per_sample, SampleFormat* format) {
+    if (format_tag == WAV_FORMAT_IEEE_FLOAT) {
+        switch (bits_per_sample) {
+        case 32: *format = SAMPLE_FORMAT_F32; return true;
+        case 64: *format = SAMPLE_FORMAT_F64; return true;
+        default: return false;
+        }
+    }
+    if (format_tag == WAV_FORMAT_PCM) {
+        switch (bits_per_sample) {
+        case 8: *format = SAMPLE_FORMAT_U8; return true;
+        case 16: *format = SAMPLE_FORMAT_S16; return true;
+        case 24: *format = SAMPLE_FORMAT_S24; return true;
+        case 32: *format = SAMPLE_FORMAT_S32; return true;
+        default: return false;
+        }
+    }
+    return false;
+}
+
+size_t sample_format_bytes(SampleFormat format) {
+    switch (format) {
+    case SAMPLE_FORMAT_U8: return 1;
+    case SAMPLE_FORMAT_S16: return 2;
+    case SAMPLE_FORMAT_S24: return 3;
+    case SAMPLE_FORMAT_S32: return 4;
+    case SAMPLE_FORMAT_F32: return 4;
+    case SAMPLE_FORMAT_F64: return 8;
+    }
+    return 0;
+}
+
+const char* sample_format_name(SampleFormat format) {
+    switch (format) {
+    case SAMPLE_FORMAT_U8: return "u8";
+    case SAMPLE_FORMAT_S16: return "s16";
+    case SAMPLE_FORMAT_S24: return "s24";
+    case SAMPLE_FORMAT_S32: return "s32";
+    case SAMPLE_FORMAT_F32: return "f32";
+    case SAMPLE_FORMAT_F64: return "f64";
+    }
+    return "unknown";
+}
+
+sample_decode_kernel sample_decoder_get_kernel(SampleFormat format, int channels) {
+    switch (format) {
+    case SAMPLE_FORMAT_U8: return kernel_for_channels<SAMPLE_FORMAT_U8>(channels);
+    case SAMPLE_FORMAT_S16: return kernel_for_channels<SAMPLE_FORMAT_S16>(channels);
+    case SAMPLE_FORMAT_S24: return kernel_for_channels<SAMPLE_FORMAT_S24>(channels);
+    case SAMPLE_FORMAT_S32: return kernel_for_channels<SAMPLE_FORMAT_S32>(channels);
+    case SAMPLE_FORMAT_F32: return kernel_for_channels<SAMPLE_FORMAT_F32>(channels);
+    case SAMPLE_FORMAT_F64: return kernel_for_channels<SAMPLE_FORMAT_F64>(channels);
+    }
+    return nullptr;
+}
+
+bool SampleDecoder::init(SampleFormat format, int channels, const float* weights) {
+    if (channels <= 0) return false;
+
+    sample_decode_kernel kernel = sample_decoder_get_kernel(format, channels);
+    if (!kernel) return false;
+    if (format == SAMPLE_FORMAT_F32 && !downmixer_.init(channels, weights)) return false;
+
+    format_ = format;
+    channels_ = channels;
+    frame_bytes_ = sample_format_bytes(format) * channels;
+    kernel_ = kernel;
+    if (weights) {
+        weights_.assign(weights, weights + channels);
+    } else {
+        weights_.assign(channels, 1.0f / channels);
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef SAMPLE_DECODER_H
+#define SAMPLE_DECODER_H
+
+#include "downmix.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 交错PCM样本格式（小端）
+enum SampleFormat {
+    SAMPLE_FORMAT_U8 = 0,   // 8位无符号
+    SAMPLE_FORMAT_S16,      // 16位有符号
+    SAMPLE_FORMAT_S24,      // 紧凑排列的24位有符号（3字节）
+    SAMPLE_FORMAT_S32,      // 32位有符号（包括32位容器中左对齐的24位有效位）
+    SAMPLE_FORMAT_F32,
+    SAMPLE_FORMAT_F64
+};
+
+// WAVEFORMATEX格式标签
+const uint16_t WAV_FORMAT_PCM = 0x0001;
+const uint16_t WAV_FORMAT_IEEE_FLOAT = 0x0003;
+const uint16_t WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+
+// 由WAVEFORMATEX的格式标签与位深得到样本格式，不支持时返回false。
+// format_tag为WAV_FORMAT_EXTENSIBLE时需先换成SubFormat GUID的前两个字节
+bool sample_format_from_wave(uint16_t format_tag, unsigned int bits_per_sample, SampleFormat* format);
+
+// 每个样本的字节数
+size_t sample_format_bytes(SampleFormat format);
+
+const char* sample_format_name(SampleFormat format);
+
+// 解码 + 下混内核：out[i] = Σ decode(in[i][ch]) * weights[ch]
+typedef void (*sample_decode_kernel)(const uint8_t* in, float* out, size_t frames, int channels, const float* weights);
+
+// 格式 × 声道数的编译期特化实例（1/2/4/6/8声道，其他声道数为通用实例）
+sample_decode_kernel sample_decoder_get_kernel(SampleFormat format, int channels);
+
+// 任意交错PCM → 单声道float：解码与下混在一次遍历中完成。
+// 内核在init()时按格式和声道数选定，process()中没有按样本的格式分支；
+// 32位float输入直接使用Downmixer的SIMD内核。
+class SampleDecoder {
+public:
+    // weights为nullptr时各声道取平均
+    bool init(SampleFormat format, int channels, const float* weights = nullptr);
+
+    // 解码frames帧到out（至少frames个float）
+    void process(const void* in, float* out, size_t frames) const {
+        if (format_ == SAMPLE_FORMAT_F32) {
+            downmixer_.process(static_cast<const float*>(in), out, frames);
+        } else {
+            kernel_(static_cast<const uint8_t*>(in), out, frames, channels_, weights_.data());
+        }
+    }
+
+    SampleFormat format() const { return format_; }
+    int channels() const { return channels_; }
+    size_t frame_bytes() const { return frame_bytes_; }
+
+private:
+    SampleFormat format_ = SAMPLE_FORMAT_F32;
+    int channels_ = 1;
+    size_t frame_bytes_ = 4;
+    sample_decode_kernel kernel_ = nullptr;
+    std::vector<float> weights_;
+    Downmixer downmixer_;
+};
+
+#endif // SAMPLE_DECODER_H
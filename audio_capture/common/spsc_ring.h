@@ -0,0 +1,136 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// 缓存行大小，读写索引分别独占一行避免伪共享
+constexpr size_t SPSC_CACHE_LINE = 64;
+
+// 单生产者/单消费者无锁环形缓冲
+// 容量在reset()时一次性分配（向上取整为2的幂），读写过程中不加锁、不分配内存。
+// 生产者只调用write系列函数，消费者只调用read/peek/consume系列函数。
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRing requires trivially copyable elements");
+
+public:
+    SpscRing() = default;
+    explicit SpscRing(size_t capacity) { reset(capacity); }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // 重新分配缓冲并清空，非线程安全，只能在生产者/消费者都未运行时调用
+    void reset(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buffer_.reset(new T[size]);
+        capacity_ = size;
+        mask_ = size - 1;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        cached_tail_ = 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // ---- 生产者 ----
+
+    // 写入最多n个元素，返回实际写入数量（空间不足时丢弃多余的新数据）
+    size_t write(const T* data, size_t n) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        size_t free = capacity_ - (head - cached_tail_);
+        if (free < n) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            free = capacity_ - (head - cached_tail_);
+        }
+        n = std::min(n, free);
+        if (n == 0) return 0;
+
+        const size_t pos = head & mask_;
+        const size_t first = std::min(n, capacity_ - pos);
+        memcpy(buffer_.get() + pos, data, first * sizeof(T));
+        memcpy(buffer_.get(), data + first, (n - first) * sizeof(T));
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // 原地写入：返回空闲空间的两段连续区间（第二段可能为空），写完后调用commit()发布
+    size_t prepare(T** first, size_t* first_n, T** second, size_t* second_n) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        const size_t n = capacity_ - (head - cached_tail_);
+        const size_t pos = head & mask_;
+        *first = buffer_.get() + pos;
+        *first_n = std::min(n, capacity_ - pos);
+        *second = buffer_.get();
+        *second_n = n - *first_n;
+        return n;
+    }
+
+    // 发布prepare()区间中已写入的前n个元素
+    void commit(size_t n) {
+        head_.store(head_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    size_t write_available() const {
+        return capacity_ - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+    }
+
+    // ---- 消费者 ----
+
+    size_t read_available() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+    }
+
+    // 原地读取：返回可读数据的两段连续区间（第二段可能为空），数据在consume()前保持有效
+    size_t peek(const T** first, size_t* first_n, const T** second, size_t* second_n) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t n = head_.load(std::memory_order_acquire) - tail;
+        const size_t pos = tail & mask_;
+        *first = buffer_.get() + pos;
+        *first_n = std::min(n, capacity_ - pos);
+        *second = buffer_.get();
+        *second_n = n - *first_n;
+        return n;
+    }
+
+    // 释放已读取的n个元素
+    void consume(size_t n) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // 拷贝读取最多n个元素，返回实际读取数量
+    size_t read(T* dst, size_t n) {
+        const T* first;
+        const T* second;
+        size_t first_n, second_n;
+        n = std::min(n, peek(&first, &first_n, &second, &second_n));
+        const size_t n1 = std::min(n, first_n);
+        memcpy(dst, first, n1 * sizeof(T));
+        memcpy(dst + n1, second, (n - n1) * sizeof(T));
+        consume(n);
+        return n;
+    }
+
+private:
+    // 生产者写索引与其缓存的读索引
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // 消费者读索引
+    alignas(SPSC_CACHE_LINE) std::atomic<size_t> tail_{0};
+
+    // 只读的缓冲描述，与两个索引分开
+    alignas(SPSC_CACHE_LINE) std::unique_ptr<T[]> buffer_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+};
+
+#endif // SPSC_RING_H
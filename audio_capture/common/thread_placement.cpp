@@ -0,0 +1,427 @@
+#include "thread_placement.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+
+// SCHED_FIFO优先级：高于普通线程，低于内核的中断线程（50）
+const int REALTIME_PRIORITY = 10;
+
+// 解析 "0-3,8,10-11" 形式的CPU列表
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int first = 0, last = 0;
+        const int n = sscanf(item.c_str(), "%d-%d", &first, &last);
+        if (n == 1) {
+            last = first;
+        } else if (n != 2) {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+bool read_line(const std::string& path, std::string* line) {
+    std::ifstream file(path);
+    return file && std::getline(file, *line);
+}
+
+int read_int(const std::string& path, int fallback) {
+    std::string line;
+    return read_line(path, &line) ? atoi(line.c_str()) : fallback;
+}
+
+// 本进程所在cgroup的有效cpuset（v2: cpuset.cpus.effective，v1: cpuset.effective_cpus），读不到时为空
+std::vector<int> cgroup_cpuset() {
+    std::ifstream file("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(file, line)) {
+        // 格式 "层级ID:控制器列表:路径"
+        const size_t a = line.find(':');
+        const size_t b = a == std::string::npos ? a : line.find(':', a + 1);
+        if (b == std::string::npos) {
+            continue;
+        }
+        const std::string controllers = line.substr(a + 1, b - a - 1);
+        const std::string path = line.substr(b + 1);
+        std::string cpus;
+        if (controllers.empty()) {
+            if (read_line("/sys/fs/cgroup" + path + "/cpuset.cpus.effective", &cpus)) {
+                return parse_cpu_list(cpus);
+            }
+        } else if (("," + controllers + ",").find(",cpuset,") != std::string::npos) {
+            if (read_line("/sys/fs/cgroup/cpuset" + path + "/cpuset.effective_cpus", &cpus)) {
+                return parse_cpu_list(cpus);
+            }
+        }
+    }
+    return {};
+}
+
+bool detect_linux(CpuTopology* topo) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+        return false;
+    }
+    std::vector<int> allowed;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &mask)) {
+            allowed.push_back(cpu);
+        }
+    }
+    const std::vector<int> cpuset = cgroup_cpuset();
+    if (!cpuset.empty()) {
+        std::vector<int> both;
+        std::set_intersection(allowed.begin(), allowed.end(), cpuset.begin(), cpuset.end(), std::back_inserter(both));
+        if (!both.empty()) {
+            allowed.swap(both);
+        }
+    }
+
+    // Intel混合架构的P核/E核各有一个PMU设备；ARM big.LITTLE由cpu_capacity区分
+    std::set<int> p_cores, e_cores;
+    std::string list;
+    if (read_line("/sys/devices/cpu_core/cpus", &list)) {
+        const std::vector<int> cpus = parse_cpu_list(list);
+        p_cores.insert(cpus.begin(), cpus.end());
+    }
+    if (read_line("/sys/devices/cpu_atom/cpus", &list)) {
+        const std::vector<int> cpus = parse_cpu_list(list);
+        e_cores.insert(cpus.begin(), cpus.end());
+    }
+
+    std::map<std::pair<int, int>, int> core_ids;     // (封装, 核) → 统一编号
+    for (int cpu : allowed) {
+        const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        CpuInfo info;
+        info.cpu = cpu;
+        const int package = read_int(dir + "/topology/physical_package_id", 0);
+        const int core = read_int(dir + "/topology/core_id", cpu);
+        auto it = core_ids.emplace(std::make_pair(package, core), (int)core_ids.size()).first;
+        info.core = it->second;
+
+        // SMT序号：在兄弟列表中的位置
+        if (read_line(dir + "/topology/thread_siblings_list", &list)) {
+            const std::vector<int> siblings = parse_cpu_list(list);
+            info.smt_index = (int)(std::find(siblings.begin(), siblings.end(), cpu) - siblings.begin());
+            if (info.smt_index >= (int)siblings.size()) {
+                info.smt_index = 0;
+            }
+        }
+
+        if (!p_cores.empty() && !e_cores.empty()) {
+            info.efficiency = p_cores.count(cpu) ? 1 : 0;
+        } else {
+            info.efficiency = read_int(dir + "/cpu_capacity", 0);
+        }
+        topo->cpus.push_back(info);
+    }
+    return !topo->cpus.empty();
+}
+
+#elif defined(_WIN32)
+
+bool detect_windows(CpuTopology* topo) {
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+    if (length == 0) {
+        return false;
+    }
+    std::vector<char> buffer(length);
+    auto* first = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+    if (!GetLogicalProcessorInformationEx(RelationProcessorCore, first, &length)) {
+        return false;
+    }
+
+    // 进程只属于一个处理器组时（Windows 11之前的默认情况），按进程亲和性过滤
+    USHORT group_count = 1;
+    USHORT process_group = 0;
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    const bool single_group = GetProcessGroupAffinity(GetCurrentProcess(), &group_count, &process_group) &&
+        GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask);
+
+    const int bits = (int)sizeof(KAFFINITY) * 8;
+    int core = 0;
+    for (DWORD offset = 0; offset < length; ) {
+        auto* info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+        if (info->Relationship == RelationProcessorCore) {
+            const PROCESSOR_RELATIONSHIP& processor = info->Processor;
+            int smt_index = 0;
+            for (WORD g = 0; g < processor.GroupCount; g++) {
+                const GROUP_AFFINITY& affinity = processor.GroupMask[g];
+                for (int bit = 0; bit < bits; bit++) {
+                    if (!(affinity.Mask & ((KAFFINITY)1 << bit))) {
+                        continue;
+                    }
+                    const int index = smt_index++;
+                    if (single_group && (affinity.Group != process_group || !(process_mask & ((DWORD_PTR)1 << bit)))) {
+                        continue;
+                    }
+                    CpuInfo cpu;
+                    cpu.cpu = affinity.Group * 64 + bit;
+                    cpu.core = core;
+                    cpu.smt_index = index;
+                    cpu.efficiency = processor.EfficiencyClass;
+                    topo->cpus.push_back(cpu);
+                }
+            }
+            core++;
+        }
+        offset += info->Size;
+    }
+    return !topo->cpus.empty();
+}
+
+#endif
+
+} // namespace
+
+std::string CpuTopology::describe() const {
+    std::string text = std::to_string(cpus.size()) + " CPU / " + std::to_string(n_cores) + " 核";
+    if ((int)cpus.size() > n_cores) {
+        text += " (SMT)";
+    }
+    if (hybrid) {
+        int top = 0;
+        for (const CpuInfo& cpu : cpus) {
+            top = std::max(top, cpu.efficiency);
+        }
+        std::set<int> fast, slow;
+        for (const CpuInfo& cpu : cpus) {
+            (cpu.efficiency == top ? fast : slow).insert(cpu.core);
+        }
+        text += ", 混合: " + std::to_string(fast.size()) + " P + " + std::to_string(slow.size()) + " E";
+    }
+    return text;
+}
+
+bool cpu_topology_detect(CpuTopology* topo) {
+    *topo = CpuTopology();
+#ifdef __linux__
+    const bool ok = detect_linux(topo);
+#elif defined(_WIN32)
+    const bool ok = detect_windows(topo);
+#else
+    // 没有拓扑接口：每个逻辑CPU视为一个物理核
+    const int n = (int)std::thread::hardware_concurrency();
+    for (int i = 0; i < n; i++) {
+        CpuInfo cpu;
+        cpu.cpu = i;
+        cpu.core = i;
+        topo->cpus.push_back(cpu);
+    }
+    const bool ok = n > 0;
+#endif
+    if (!ok) {
+        return false;
+    }
+
+    std::sort(topo->cpus.begin(), topo->cpus.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.cpu < b.cpu; });
+    std::set<int> cores, classes;
+    for (const CpuInfo& cpu : topo->cpus) {
+        cores.insert(cpu.core);
+        classes.insert(cpu.efficiency);
+    }
+    topo->n_cores = (int)cores.size();
+    topo->hybrid = classes.size() > 1;
+    return true;
+}
+
+ThreadPlacement plan_thread_placement(const CpuTopology& topo) {
+    ThreadPlacement plan;
+    if (topo.n_cores < 2) {
+        return plan;
+    }
+
+    // 每个物理核的第一个超线程
+    std::map<int, const CpuInfo*> primary;
+    for (const CpuInfo& cpu : topo.cpus) {
+        auto it = primary.find(cpu.core);
+        if (it == primary.end() || cpu.smt_index < it->second->smt_index) {
+            primary[cpu.core] = &cpu;
+        }
+    }
+
+    // 采集线程：性能等级最低的核中编号最大的一个（避开常处理中断的CPU 0）
+    const CpuInfo* capture = nullptr;
+    int top = 0;
+    for (const auto& entry : primary) {
+        const CpuInfo* cpu = entry.second;
+        top = std::max(top, cpu->efficiency);
+        if (!capture || cpu->efficiency < capture->efficiency ||
+            (cpu->efficiency == capture->efficiency && cpu->cpu > capture->cpu)) {
+            capture = cpu;
+        }
+    }
+    plan.capture_cpu = capture->cpu;
+
+    for (const auto& entry : primary) {
+        const CpuInfo* cpu = entry.second;
+        if (cpu->core != capture->core && cpu->efficiency == top) {
+            plan.inference_cpus.push_back(cpu->cpu);
+        }
+    }
+    // 只有一个P核且被采集线程占用等情况：退回其余所有核
+    if (plan.inference_cpus.empty()) {
+        for (const auto& entry : primary) {
+            if (entry.second->core != capture->core) {
+                plan.inference_cpus.push_back(entry.second->cpu);
+            }
+        }
+    }
+    std::sort(plan.inference_cpus.begin(), plan.inference_cpus.end());
+    return plan;
+}
+
+std::vector<int> partition_cpus(const std::vector<int>& cpus, int n_groups, int index) {
+    if (n_groups <= 1 || (int)cpus.size() < n_groups) {
+        return cpus;
+    }
+    const size_t begin = cpus.size() * index / n_groups;
+    const size_t end = cpus.size() * (index + 1) / n_groups;
+    return std::vector<int>(cpus.begin() + begin, cpus.begin() + end);
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return false;
+    }
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &mask);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+#elif defined(_WIN32)
+    // 线程亲和性只能在一个处理器组内，取第一个CPU所在的组
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = (WORD)(cpus[0] / 64);
+    for (int cpu : cpus) {
+        if (cpu / 64 == affinity.Group) {
+            affinity.Mask |= (KAFFINITY)1 << (cpu % 64);
+        }
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    return false;
+#endif
+}
+
+bool set_default_thread_cpus(const std::vector<int>& cpus) {
+#if defined(_WIN32) && defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0A00
+    if (cpus.empty()) {
+        return SetProcessDefaultCpuSets(GetCurrentProcess(), nullptr, 0) != 0;
+    }
+    ULONG length = 0;
+    GetSystemCpuSetInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+    if (length == 0) {
+        return false;
+    }
+    std::vector<char> buffer(length);
+    if (!GetSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()), length, &length,
+                                    GetCurrentProcess(), 0)) {
+        return false;
+    }
+    // CPU集合ID与逻辑CPU编号不同，按(组, 组内编号)对应
+    std::vector<ULONG> ids;
+    for (ULONG offset = 0; offset < length; ) {
+        auto* info = reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data() + offset);
+        if (info->Type == CpuSetInformation) {
+            const int cpu = info->CpuSet.Group * 64 + info->CpuSet.LogicalProcessorIndex;
+            if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+                ids.push_back(info->CpuSet.Id);
+            }
+        }
+        offset += info->Size;
+    }
+    return !ids.empty() && SetProcessDefaultCpuSets(GetCurrentProcess(), ids.data(), (ULONG)ids.size()) != 0;
+#elif defined(_WIN32)
+    (void)cpus;
+    return false;
+#else
+    (void)cpus;
+    return true;
+#endif
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size(); ) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            j++;
+        }
+        if (!text.empty()) {
+            text += ",";
+        }
+        text += std::to_string(cpus[i]);
+        if (j > i) {
+            text += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return text;
+}
+
+bool RealtimePriority::raise() {
+    if (active_) {
+        return true;
+    }
+#ifdef _WIN32
+    DWORD task_index = 0;
+    task_ = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+    active_ = task_ != nullptr;
+#elif defined(__linux__)
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &old_policy_, &param) != 0) {
+        return false;
+    }
+    old_priority_ = param.sched_priority;
+    sched_param rt = {};
+    rt.sched_priority = std::min(REALTIME_PRIORITY, sched_get_priority_max(SCHED_FIFO));
+    active_ = pthread_setschedparam(pthread_self(), SCHED_FIFO, &rt) == 0;
+#endif
+    return active_;
+}
+
+void RealtimePriority::release() {
+    if (!active_) {
+        return;
+    }
+#ifdef _WIN32
+    AvRevertMmThreadCharacteristics(task_);
+    task_ = nullptr;
+#elif defined(__linux__)
+    sched_param param = {};
+    param.sched_priority = old_priority_;
+    pthread_setschedparam(pthread_self(), old_policy_, &param);
+#endif
+    active_ = false;
+}
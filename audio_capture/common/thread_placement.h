@@ -0,0 +1,75 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <string>
+#include <vector>
+
+// 一个逻辑CPU
+struct CpuInfo {
+    int cpu = 0;            // 逻辑CPU编号（Windows为 处理器组*64 + 组内编号）
+    int core = 0;           // 所属物理核（进程内统一编号，SMT兄弟相同）
+    int smt_index = 0;      // 在物理核内的序号，0为第一个超线程
+    int efficiency = 0;     // 性能等级，混合架构上越大越快（P核 > E核），否则全为0
+};
+
+// 当前进程可用的CPU拓扑，已按进程亲和性与cgroup cpuset过滤
+struct CpuTopology {
+    std::vector<CpuInfo> cpus;  // 按cpu编号排序
+    int n_cores = 0;            // 物理核数
+    bool hybrid = false;        // 存在不同性能等级的核
+
+    // 如 "8 CPU / 4 核 (SMT)"、"16 CPU / 12 核, 混合: 4 P + 8 E"
+    std::string describe() const;
+};
+
+// 读取拓扑：Linux为sysfs + sched_getaffinity + cgroup cpuset，Windows为GetLogicalProcessorInformationEx
+bool cpu_topology_detect(CpuTopology* topo);
+
+// 线程放置方案
+struct ThreadPlacement {
+    int capture_cpu = -1;               // 采集线程独占的逻辑CPU，-1为不固定
+    std::vector<int> inference_cpus;    // 推理线程使用的逻辑CPU：其余物理核各取第一个超线程
+};
+
+// 采集线程放在一个低性能等级的物理核上（同核的SMT兄弟空出），推理线程占用其余物理核，
+// 混合架构上只用最高性能等级的核（图计算按最慢的线程同步）。少于2个物理核时不固定
+ThreadPlacement plan_thread_placement(const CpuTopology& topo);
+
+// 把cpus平均分给n_groups组（如每个推理工作线程一组），组数多于CPU数时各组共享全部
+std::vector<int> partition_cpus(const std::vector<int>& cpus, int n_groups, int index);
+
+// 把当前线程限制在cpus上。Linux上之后由该线程创建的线程（ggml/OpenMP计算线程）继承该限制
+bool pin_current_thread(const std::vector<int>& cpus);
+
+// 新线程的默认CPU：Windows上新线程不继承创建者的亲和性，用进程默认CPU集合让ggml计算线程落在cpus上；
+// Linux上由pin_current_thread的继承保证，不做任何事
+bool set_default_thread_cpus(const std::vector<int>& cpus);
+
+// 格式化CPU列表，如 "0,2,4-7"
+std::string format_cpu_list(const std::vector<int>& cpus);
+
+// 音频线程优先级：raise()把当前线程注册为MMCSS "Pro Audio"任务（Windows）或设为SCHED_FIFO（Linux），
+// 析构或release()时恢复。必须在同一线程上调用；没有权限时raise()返回false，线程保持原优先级
+class RealtimePriority {
+public:
+    RealtimePriority() = default;
+    ~RealtimePriority() { release(); }
+
+    RealtimePriority(const RealtimePriority&) = delete;
+    RealtimePriority& operator=(const RealtimePriority&) = delete;
+
+    bool raise();
+    void release();
+    bool active() const { return active_; }
+
+private:
+    bool active_ = false;
+#ifdef _WIN32
+    void* task_ = nullptr;      // AvSetMmThreadCharacteristics返回的句柄
+#else
+    int old_policy_ = 0;
+    int old_priority_ = 0;
+#endif
+};
+
+#endif // THREAD_PLACEMENT_H
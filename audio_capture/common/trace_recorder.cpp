@@ -0,0 +1,166 @@
+#include "trace_recorder.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t t0_ns;
+    int64_t dur_ns;         // 时刻事件为-1
+    int32_t stream;
+};
+
+const size_t BLOCK_EVENTS = 4096;
+const size_t MAX_BLOCKS = 256;          // 每个线程最多约100万个事件（32MB），之后丢弃并计数
+
+// 一个线程的事件缓冲：只有所属线程写入，按块分配不搬移，
+// count以release发布，读取方只读count之前的事件
+struct ThreadTrace {
+    int tid = 0;
+    std::string name;                   // 在g_mtx下访问
+    std::unique_ptr<TraceEvent[]> blocks[MAX_BLOCKS];
+    std::atomic<size_t> count{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+std::atomic<bool> g_enabled{false};
+std::atomic<int64_t> g_origin_ns{0};
+std::mutex g_mtx;                       // 保护线程列表与线程名
+std::vector<std::unique_ptr<ThreadTrace>> g_threads;
+thread_local ThreadTrace* t_trace = nullptr;
+
+ThreadTrace* local_trace() {
+    if (!t_trace) {
+        std::lock_guard<std::mutex> lock(g_mtx);
+        g_threads.emplace_back(new ThreadTrace());
+        t_trace = g_threads.back().get();
+        t_trace->tid = (int)g_threads.size();
+        t_trace->name = "thread " + std::to_string(t_trace->tid);
+    }
+    return t_trace;
+}
+
+void append(const TraceEvent& event) {
+    ThreadTrace* t = local_trace();
+    const size_t n = t->count.load(std::memory_order_relaxed);
+    const size_t block = n / BLOCK_EVENTS;
+    if (block >= MAX_BLOCKS) {
+        t->dropped.store(t->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    if (!t->blocks[block]) {
+        t->blocks[block].reset(new TraceEvent[BLOCK_EVENTS]);
+    }
+    t->blocks[block][n % BLOCK_EVENTS] = event;
+    t->count.store(n + 1, std::memory_order_release);
+}
+
+std::string json_escape(const std::string& text) {
+    std::string out;
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        if ((unsigned char)c >= 0x20) {
+            out += c;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+void trace_start() {
+    g_origin_ns.store(trace_now(), std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_release);
+}
+
+bool trace_enabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+int64_t trace_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace_complete(const char* name, int64_t t0_ns, int64_t t1_ns, int stream) {
+    if (!trace_enabled()) {
+        return;
+    }
+    append({ name, t0_ns, t1_ns > t0_ns ? t1_ns - t0_ns : 0, stream });
+}
+
+void trace_instant(const char* name, int64_t t_ns, int stream) {
+    if (!trace_enabled()) {
+        return;
+    }
+    append({ name, t_ns, -1, stream });
+}
+
+void trace_set_thread_name(const std::string& name) {
+    ThreadTrace* t = local_trace();
+    std::lock_guard<std::mutex> lock(g_mtx);
+    t->name = name;
+}
+
+long long trace_write(const std::string& path) {
+    g_enabled.store(false, std::memory_order_relaxed);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return -1;
+    }
+
+    // 时间为微秒，相对trace_start()
+    const int64_t origin = g_origin_ns.load(std::memory_order_relaxed);
+    long long n_events = 0;
+    uint64_t n_dropped = 0;
+    bool first = true;
+    auto separator = [&]() {
+        const char* sep = first ? "\n" : ",\n";
+        first = false;
+        return sep;
+    };
+
+    std::lock_guard<std::mutex> lock(g_mtx);
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (const auto& t : g_threads) {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+            separator(), t->tid, json_escape(t->name).c_str());
+        const size_t count = t->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent& e = t->blocks[i / BLOCK_EVENTS][i % BLOCK_EVENTS];
+            const double ts_us = (e.t0_ns - origin) / 1e3;
+            if (e.dur_ns >= 0) {
+                fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                    separator(), e.name, t->tid, ts_us, e.dur_ns / 1e3);
+            } else {
+                fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f",
+                    separator(), e.name, t->tid, ts_us);
+            }
+            if (e.stream >= 0) {
+                fprintf(file, ", \"args\": {\"stream\": %d}}", e.stream);
+            } else {
+                fprintf(file, "}");
+            }
+            n_events++;
+        }
+        n_dropped += t->dropped.load(std::memory_order_relaxed);
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0) {
+        return -1;
+    }
+    if (n_dropped > 0) {
+        std::cerr << "Trace buffers full, dropped " << n_dropped << " events" << std::endl;
+    }
+    return n_events;
+}
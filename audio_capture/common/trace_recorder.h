@@ -0,0 +1,50 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <cstdint>
+#include <string>
+
+// 流水线时间线记录，输出为Chrome trace-event JSON（chrome://tracing 或 Perfetto打开）。
+// 每个线程写自己的缓冲：事件只追加，首次记录时在锁下注册一次，之后记录不加锁也没有原子读改写。
+// 未开启时每个记录点只有一次relaxed读取。事件名必须是静态字符串（只保存指针）
+
+// 开始记录，时间以此刻为零点。在各线程开始记录之前调用一次
+void trace_start();
+bool trace_enabled();
+
+// 当前时刻，steady_clock纳秒
+int64_t trace_now();
+
+// 一个已结束的区间 [t0_ns, t1_ns)；stream为流ID，-1为不属于某路流
+void trace_complete(const char* name, int64_t t0_ns, int64_t t1_ns, int stream = -1);
+// 一个时刻事件（丢弃、超时等）
+void trace_instant(const char* name, int64_t t_ns, int stream = -1);
+
+// 当前线程在时间线上显示的名字，可在开始记录之前调用
+void trace_set_thread_name(const std::string& name);
+
+// 停止记录并写入path，返回写入的事件数，失败返回-1。
+// 写入时仍在记录的线程的最后几个事件可能不包含在内
+long long trace_write(const std::string& path);
+
+// 作用域内的区间：构造时记录开始时刻，析构时写入一个区间事件
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, int stream = -1)
+        : name_(name), stream_(stream), t0_(trace_enabled() ? trace_now() : 0) {}
+    ~TraceSpan() {
+        if (t0_ != 0) {
+            trace_complete(name_, t0_, trace_now(), stream_);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    int stream_;
+    int64_t t0_;
+};
+
+#endif // TRACE_RECORDER_H
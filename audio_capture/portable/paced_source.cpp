@@ -0,0 +1,131 @@
+#include "paced_source.h"
+#include "thread_placement.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+PacedSource::PacedSource(const AudioSourceConfig& config) :
+    pace_(config.pace),
+    packet_frames_(config.packet_frames),
+    capture_cpu_(config.capture_cpu),
+    realtime_(config.realtime_priority != 0) {
+}
+
+PacedSource::~PacedSource() {
+    stop();
+}
+
+bool PacedSource::start() {
+    if (!is_initialized_ || capture_thread_.joinable()) return false;
+
+    if (packet_frames_ == 0) {
+        packet_frames_ = sample_rate_ / 100; // 与WASAPI一致的10ms包
+    }
+    buffer_.resize(packet_frames_);
+    if (read_capacity_ > 0) {
+        reader_.reset(read_capacity_);
+    }
+
+    stop_capture_ = false;
+    finished_ = false;
+    capture_thread_ = std::thread(&PacedSource::capture_proc, this);
+    return true;
+}
+
+void PacedSource::stop() {
+    if (capture_thread_.joinable()) {
+        stop_capture_ = true;
+        capture_thread_.join();
+    }
+}
+
+bool PacedSource::enable_read(size_t capacity_frames) {
+    if (capture_thread_.joinable()) return false;
+    read_capacity_ = capacity_frames;
+    reader_.reset(capacity_frames);
+    return true;
+}
+
+int PacedSource::read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+    return reader_.read(dst, max_frames, timeout_ms, position, flags);
+}
+
+bool PacedSource::get_format(AudioFormat* format) {
+    if (!is_initialized_ && !initialize()) {
+        return false;
+    }
+
+    // 与WASAPI后端一致：输出单声道，保持原始采样率
+    format->sample_rate = sample_rate_;
+    format->channels = 1;
+    format->bits_per_sample = bits_per_sample_;
+    return true;
+}
+
+void PacedSource::capture_proc() {
+    using clock = std::chrono::steady_clock;
+
+    const auto t_start = clock::now();
+    next_position_ = 0;
+    trace_set_thread_name("capture");
+
+    // 与实时采集相同的放置，回放测试时推理线程与读取线程的竞争和真实采集一致
+    if (capture_cpu_ >= 0 && !pin_current_thread({capture_cpu_})) {
+        std::cerr << "Failed to pin source thread to CPU " << capture_cpu_ << std::endl;
+    }
+    RealtimePriority priority;
+    if (realtime_ && !priority.raise()) {
+        std::cerr << "Failed to raise source thread priority (needs CAP_SYS_NICE or an rtprio limit)" << std::endl;
+    }
+
+    while (!stop_capture_) {
+        chunk_flags_ = 0;
+        const int64_t t_read = trace_enabled() ? trace_now() : 0;
+        const int frames = read_frames(buffer_.data(), (int)packet_frames_);
+        if (frames <= 0) {
+            break;
+        }
+        if (t_read != 0) {
+            trace_complete("read", t_read, trace_now());
+        }
+
+        // 按pace计算该包应当到达的时刻（按位置计算，丢失的帧同样占用时间）；
+        // pace<=0时不等待，由消费者的回调决定速度
+        AudioChunkInfo info;
+        info.position = next_position_;
+        info.flags = chunk_flags_;
+        if (pace_ > 0.0f) {
+            const double rate = sample_rate_ * (double)pace_;
+            const auto t_first = t_start + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(next_position_ / rate));
+            std::this_thread::sleep_until(t_start +
+                std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>((next_position_ + frames) / rate)));
+            info.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t_first.time_since_epoch()).count();
+        } else {
+            info.capture_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+        }
+
+        TraceSpan span("deliver");
+        if (chunk_callback_) {
+            chunk_callback_(chunk_user_data_, buffer_.data(), frames, &info);
+        }
+        if (callback_) {
+            callback_(user_data_, buffer_.data(), frames);
+        }
+        if (reader_.enabled()) {
+            // 非实时源不丢数据：缓冲满时等待消费者读取
+            size_t written = 0;
+            while (!stop_capture_) {
+                const size_t n = std::min((size_t)frames - written, reader_.write_available());
+                written += reader_.write(buffer_.data() + written, n, info.position + written, written == 0 ? info.flags : 0u);
+                if (written >= (size_t)frames) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        next_position_ += frames;
+    }
+
+    finished_ = true;
+    reader_.finish();
+}
@@ -0,0 +1,62 @@
+#ifndef PACED_SOURCE_H
+#define PACED_SOURCE_H
+
+#include "../audio_source_backend.h"
+#include "pull_reader.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 可移植音频源的公共实现：独立线程按包读取音频，
+// 按pace控制投递速度（实时/倍速/尽可能快），并通过回调输出单声道float
+class PacedSource : public AudioSourceBackend {
+public:
+    explicit PacedSource(const AudioSourceConfig& config);
+    ~PacedSource() override;
+
+    bool start() override;
+    void stop() override;
+    bool get_format(AudioFormat* format) override;
+    bool is_finished() const override { return finished_; }
+    bool enable_read(size_t capacity_frames) override;
+    int read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) override;
+
+protected:
+    // 读取最多frames帧单声道样本到mono，返回实际帧数，返回0表示音频结束
+    virtual int read_frames(float* mono, int frames) = 0;
+
+    // 读取线程是否被要求停止（阻塞式读取可据此提前返回）
+    bool stop_requested() const { return stop_capture_; }
+
+    // read_frames()中可调用：本块之前丢失了frames帧（位置跳过，并标记不连续）
+    void skip_frames(uint64_t frames) {
+        next_position_ += frames;
+        chunk_flags_ |= AUDIO_CHUNK_DISCONTINUITY;
+    }
+
+    // read_frames()中可调用：本块为已知的静音
+    void mark_silent() { chunk_flags_ |= AUDIO_CHUNK_SILENT; }
+
+    unsigned int sample_rate_ = 0;      // 由派生类在initialize()中设置
+    unsigned int bits_per_sample_ = 32;
+    bool is_initialized_ = false;
+
+private:
+    void capture_proc();
+
+    float pace_;
+    unsigned int packet_frames_;
+    int capture_cpu_;                   // 读取线程固定到的逻辑CPU，-1为不固定
+    bool realtime_;
+    std::vector<float> buffer_;
+    uint64_t next_position_ = 0;        // 下一块首帧的位置（帧）
+    unsigned int chunk_flags_ = 0;      // 当前块的AUDIO_CHUNK_*标志
+    PullReader reader_;
+    size_t read_capacity_ = 0;
+
+    std::thread capture_thread_;
+    std::atomic<bool> stop_capture_{false};
+    std::atomic<bool> finished_{false};
+};
+
+#endif // PACED_SOURCE_H
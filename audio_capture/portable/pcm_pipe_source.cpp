@@ -0,0 +1,97 @@
+#include "paced_source.h"
+#include "pcm_reader.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <poll.h>
+#endif
+
+namespace {
+
+// 原始PCM音频源：读取stdin或命名管道（FIFO）中的交错PCM数据
+class PcmPipeSource : public PacedSource {
+public:
+    explicit PcmPipeSource(const AudioSourceConfig& config) :
+        PacedSource(config),
+        path_(config.path ? config.path : "-"),
+        channels_(config.channels),
+        pcm_format_(config.pcm_format),
+        file_(nullptr) {
+        sample_rate_ = config.sample_rate;
+        bits_per_sample_ = config.pcm_format == AUDIO_PCM_F32 ? 32 : 16;
+    }
+
+    ~PcmPipeSource() override {
+        stop();
+        if (file_ && file_ != stdin) {
+            fclose(file_);
+        }
+        file_ = nullptr;
+    }
+
+    bool initialize() override {
+        if (is_initialized_) return true;
+
+        if (path_ == "-") {
+            file_ = stdin;
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        } else {
+            // 打开FIFO会阻塞直到写端就绪
+            file_ = fopen(path_.c_str(), "rb");
+            if (!file_) {
+                std::cerr << "Failed to open PCM pipe: " << path_ << std::endl;
+                return false;
+            }
+        }
+
+#ifndef _WIN32
+        // 关闭stdio缓冲，使poll()看到的可读状态与fread()一致
+        setvbuf(file_, nullptr, _IONBF, 0);
+#endif
+
+        if (!reader_.reset(file_, channels_, bits_per_sample_, pcm_format_ == AUDIO_PCM_F32)) {
+            return false;
+        }
+
+        is_initialized_ = true;
+        return true;
+    }
+
+protected:
+    int read_frames(float* mono, int frames) override {
+#ifndef _WIN32
+        // 等待数据期间定期检查停止请求，避免stop()阻塞在read上
+        struct pollfd pfd = { fileno(file_), POLLIN, 0 };
+        while (!stop_requested()) {
+            const int ret = poll(&pfd, 1, 100);
+            if (ret > 0) break;
+            if (ret < 0) return 0;
+        }
+        if (stop_requested()) return 0;
+#endif
+        return reader_.read(mono, frames);
+    }
+
+private:
+    std::string path_;
+    unsigned int channels_;
+    AudioPcmFormat pcm_format_;
+    FILE* file_;
+    PcmReader reader_;
+};
+
+} // namespace
+
+AudioSourceBackend* create_pcm_pipe_source(const AudioSourceConfig& config) {
+    if (config.sample_rate == 0 || config.channels == 0) {
+        std::cerr << "PCM audio source requires sample rate and channel count" << std::endl;
+        return nullptr;
+    }
+    return new PcmPipeSource(config);
+}
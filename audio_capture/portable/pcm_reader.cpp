@@ -0,0 +1,41 @@
+#include "pcm_reader.h"
+#include <iostream>
+
+bool PcmReader::reset(FILE* file, unsigned int channels, unsigned int bits_per_sample, bool is_float) {
+    if (!file || channels == 0) return false;
+
+    SampleFormat format;
+    if (!sample_format_from_wave(is_float ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM, bits_per_sample, &format) ||
+        !decoder_.init(format, (int)channels)) {
+        std::cerr << "Unsupported PCM format: " << bits_per_sample
+                  << (is_float ? "-bit float" : "-bit integer") << std::endl;
+        return false;
+    }
+
+    file_ = file;
+    frames_left_ = 0;
+    return true;
+}
+
+int PcmReader::read(float* mono, int frames) {
+    if (!file_ || frames <= 0) return 0;
+    if (frames_left_ > 0 && (uint64_t)frames > frames_left_) {
+        frames = (int)frames_left_;
+    }
+
+    const size_t frame_size = decoder_.frame_bytes();
+    raw_.resize(frame_size * frames);
+
+    const size_t n_read = fread(raw_.data(), frame_size, frames, file_);
+    if (frames_left_ > 0) {
+        frames_left_ -= n_read;
+        if (frames_left_ == 0) {
+            file_ = nullptr; // data块读完，后续读取直接返回EOF
+        }
+    }
+
+    // 解码并转换为单声道：各声道取平均
+    decoder_.process(raw_.data(), mono, n_read);
+
+    return (int)n_read;
+}
@@ -0,0 +1,28 @@
+#ifndef PCM_READER_H
+#define PCM_READER_H
+
+#include "sample_decoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// 从FILE*读取交错PCM数据并转换为单声道float
+// 支持8位无符号、16/24/32位有符号整数以及32/64位浮点
+class PcmReader {
+public:
+    bool reset(FILE* file, unsigned int channels, unsigned int bits_per_sample, bool is_float);
+
+    // 读取最多frames帧，返回实际读取的完整帧数，0表示EOF
+    int read(float* mono, int frames);
+
+    // 剩余可读帧数上限（WAV的data块长度），0表示不限
+    void set_frame_limit(uint64_t frames) { frames_left_ = frames; }
+
+private:
+    FILE* file_ = nullptr;
+    SampleDecoder decoder_;
+    uint64_t frames_left_ = 0;
+    std::vector<uint8_t> raw_;
+};
+
+#endif // PCM_READER_H
@@ -0,0 +1,116 @@
+#include "paced_source.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+
+// 合成信号音频源：用于在没有音频设备的机器上驱动和压测整条流水线
+class SynthSource : public PacedSource {
+public:
+    explicit SynthSource(const AudioSourceConfig& config) :
+        PacedSource(config),
+        signal_(config.synth_signal),
+        frequency_(config.synth_frequency),
+        amplitude_(config.synth_amplitude),
+        total_frames_(config.duration_s > 0.0 ? (uint64_t)(config.duration_s * config.sample_rate) : 0),
+        frames_generated_(0),
+        gap_interval_(config.synth_gap_interval_s > 0.0 ? (uint64_t)(config.synth_gap_interval_s * config.sample_rate) : 0),
+        gap_frames_((uint64_t)(std::max(0.0, config.synth_gap_ms) * config.sample_rate / 1000)),
+        next_gap_(gap_interval_),
+        noise_state_(0x12345678u) {
+        sample_rate_ = config.sample_rate;
+    }
+
+    ~SynthSource() override {
+        stop();
+    }
+
+    bool initialize() override {
+        is_initialized_ = sample_rate_ > 0;
+        return is_initialized_;
+    }
+
+protected:
+    int read_frames(float* mono, int frames) override {
+        // 模拟设备数据丢失：跳过一段帧（信号按时间继续），并且不让一块跨越丢失点
+        if (gap_interval_ > 0 && gap_frames_ > 0) {
+            if (frames_generated_ >= next_gap_) {
+                skip_frames(gap_frames_);
+                frames_generated_ += gap_frames_;
+                next_gap_ += gap_interval_ + gap_frames_;
+            }
+            frames = (int)std::min<uint64_t>(frames, next_gap_ - frames_generated_);
+        }
+        if (signal_ == AUDIO_SYNTH_SILENCE) {
+            mark_silent();
+        }
+
+        if (total_frames_ > 0) {
+            if (frames_generated_ >= total_frames_) return 0;
+            if ((uint64_t)frames > total_frames_ - frames_generated_) {
+                frames = (int)(total_frames_ - frames_generated_);
+            }
+        }
+
+        for (int i = 0; i < frames; i++) {
+            mono[i] = next_sample(frames_generated_ + i);
+        }
+        frames_generated_ += frames;
+        return frames;
+    }
+
+private:
+    // 确定性的伪随机噪声，保证多次运行结果一致
+    float next_noise() {
+        noise_state_ = noise_state_ * 1664525u + 1013904223u;
+        return (int32_t)noise_state_ / 2147483648.0f;
+    }
+
+    float next_sample(uint64_t n) {
+        const double t = (double)n / sample_rate_;
+
+        switch (signal_) {
+        case AUDIO_SYNTH_SINE:
+            return amplitude_ * (float)std::sin(TWO_PI * frequency_ * t);
+        case AUDIO_SYNTH_NOISE:
+            return amplitude_ * next_noise();
+        case AUDIO_SYNTH_SILENCE:
+            return 0.0f;
+        case AUDIO_SYNTH_BURSTS: {
+            // 1.5秒带谐波、4Hz调幅的"发声"段与1.5秒低噪声段交替
+            const double period = 3.0;
+            const double phase = std::fmod(t, period);
+            if (phase >= period / 2) {
+                return amplitude_ * 0.01f * next_noise();
+            }
+            const double envelope = 0.5 * (1.0 - std::cos(TWO_PI * 4.0 * phase));
+            double v = 0.0;
+            for (int h = 1; h <= 4; h++) {
+                v += std::sin(TWO_PI * frequency_ * h * t) / h;
+            }
+            return amplitude_ * (float)(0.5 * envelope * v);
+        }
+        }
+        return 0.0f;
+    }
+
+    AudioSynthSignal signal_;
+    float frequency_;
+    float amplitude_;
+    uint64_t total_frames_;
+    uint64_t frames_generated_;
+    uint64_t gap_interval_;     // 两次丢失之间的帧数，0表示不丢失
+    uint64_t gap_frames_;       // 每次丢失的帧数
+    uint64_t next_gap_;         // 下一次丢失开始的位置
+    uint32_t noise_state_;
+};
+
+} // namespace
+
+AudioSourceBackend* create_synth_source(const AudioSourceConfig& config) {
+    if (config.sample_rate == 0) return nullptr;
+    return new SynthSource(config);
+}
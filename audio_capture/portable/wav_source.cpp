@@ -0,0 +1,130 @@
+#include "paced_source.h"
+#include "pcm_reader.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+uint16_t read_u16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t read_u32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+// WAV文件音频源
+class WavSource : public PacedSource {
+public:
+    explicit WavSource(const AudioSourceConfig& config) :
+        PacedSource(config),
+        path_(config.path ? config.path : ""),
+        file_(nullptr) {
+    }
+
+    ~WavSource() override {
+        stop();
+        if (file_) {
+            fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    bool initialize() override {
+        if (is_initialized_) return true;
+
+        file_ = fopen(path_.c_str(), "rb");
+        if (!file_) {
+            std::cerr << "Failed to open WAV file: " << path_ << std::endl;
+            return false;
+        }
+
+        if (!parse_header()) {
+            fclose(file_);
+            file_ = nullptr;
+            return false;
+        }
+
+        is_initialized_ = true;
+        return true;
+    }
+
+protected:
+    int read_frames(float* mono, int frames) override {
+        return reader_.read(mono, frames);
+    }
+
+private:
+    // 解析RIFF头，定位到data块起始位置
+    bool parse_header() {
+        uint8_t riff[12];
+        if (fread(riff, 1, sizeof(riff), file_) != sizeof(riff) ||
+            memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+            std::cerr << "Not a RIFF/WAVE file: " << path_ << std::endl;
+            return false;
+        }
+
+        bool have_fmt = false;
+        uint16_t format_tag = 0;
+        uint16_t channels = 0;
+        uint32_t sample_rate = 0;
+        uint16_t bits = 0;
+
+        uint8_t chunk[8];
+        while (fread(chunk, 1, sizeof(chunk), file_) == sizeof(chunk)) {
+            const uint32_t size = read_u32(chunk + 4);
+
+            if (memcmp(chunk, "fmt ", 4) == 0) {
+                uint8_t fmt[40] = {0};
+                const uint32_t n = size < sizeof(fmt) ? size : (uint32_t)sizeof(fmt);
+                if (size < 16 || fread(fmt, 1, n, file_) != n) break;
+                if (size > n) fseek(file_, size - n, SEEK_CUR);
+
+                format_tag = read_u16(fmt);
+                channels = read_u16(fmt + 2);
+                sample_rate = read_u32(fmt + 4);
+                bits = read_u16(fmt + 14);
+                if (format_tag == WAV_FORMAT_EXTENSIBLE && size >= 40) {
+                    // SubFormat GUID的前两个字节即为实际格式标签
+                    format_tag = read_u16(fmt + 24);
+                }
+                have_fmt = true;
+            } else if (memcmp(chunk, "data", 4) == 0) {
+                if (!have_fmt) break;
+                if (format_tag != WAV_FORMAT_PCM && format_tag != WAV_FORMAT_IEEE_FLOAT) {
+                    std::cerr << "Unsupported WAV format tag: 0x" << std::hex << format_tag << std::dec << std::endl;
+                    return false;
+                }
+                if (!reader_.reset(file_, channels, bits, format_tag == WAV_FORMAT_IEEE_FLOAT)) {
+                    return false;
+                }
+                // 流式写出的WAV可能将data长度记为0或0xFFFFFFFF，此时读到文件末尾
+                const uint32_t frame_size = channels * (bits / 8);
+                if (size != 0 && size != 0xFFFFFFFF) {
+                    reader_.set_frame_limit(size / frame_size);
+                }
+
+                sample_rate_ = sample_rate;
+                bits_per_sample_ = bits;
+                return true;
+            } else {
+                // 跳过其它块（LIST等），块长度按偶数对齐
+                fseek(file_, size + (size & 1), SEEK_CUR);
+            }
+        }
+
+        std::cerr << "Invalid WAV file (missing fmt or data chunk): " << path_ << std::endl;
+        return false;
+    }
+
+    std::string path_;
+    FILE* file_;
+    PcmReader reader_;
+};
+
+} // namespace
+
+AudioSourceBackend* create_wav_source(const AudioSourceConfig& config) {
+    if (!config.path) {
+        std::cerr << "WAV audio source requires a file path" << std::endl;
+        return nullptr;
+    }
+    return new WavSource(config);
+}
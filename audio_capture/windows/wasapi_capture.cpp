@@ -1,9 +1,15 @@
 #include "wasapi_capture.h"
+#include "sample_decoder.h"
+#include "pull_reader.h"
+#include "thread_placement.h"
+#include "trace_recorder.h"
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <audiopolicy.h>
 #include <functiondiscoverykeys_devpkey.h>
 #include <windows.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <initguid.h>
@@ -27,9 +33,14 @@ public:
         capture_client_(nullptr),
         session_manager_(nullptr),
         is_initialized_(false),
+        stop_capture_(false),
+        capture_thread_(nullptr),
+        event_driven_(true),
+        capture_event_(nullptr),
         callback_(nullptr),
         user_data_(nullptr),
-        mix_format_(nullptr) {
+        mix_format_(nullptr),
+        sample_format_(SAMPLE_FORMAT_F32) {
         CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     }
 
@@ -46,13 +57,37 @@ public:
         if (!get_format(&format)) {
             return false;
         }
+        if (!resolve_sample_format()) {
+            return false;
+        }
 
         // 初始化音频客户端 - 使用原始格式
-        HRESULT hr = audio_client_->Initialize(
-            AUDCLNT_SHAREMODE_SHARED,
-            AUDCLNT_STREAMFLAGS_LOOPBACK,
-            0, 0, mix_format_, nullptr
-        );
+        // 事件驱动模式下由音频引擎在每个周期触发事件，不支持时退回轮询
+        HRESULT hr = E_FAIL;
+        if (event_driven_) {
+            hr = audio_client_->Initialize(
+                AUDCLNT_SHAREMODE_SHARED,
+                AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                0, 0, mix_format_, nullptr
+            );
+            if (SUCCEEDED(hr)) {
+                capture_event_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+                hr = capture_event_ ? audio_client_->SetEventHandle(capture_event_) : E_FAIL;
+            }
+            if (FAILED(hr)) {
+                std::cerr << "Event-driven capture unavailable (0x" << std::hex << hr << std::dec
+                          << "), falling back to polling" << std::endl;
+                event_driven_ = false;
+                reset_audio_client();
+            }
+        }
+        if (!event_driven_) {
+            hr = audio_client_->Initialize(
+                AUDCLNT_SHAREMODE_SHARED,
+                AUDCLNT_STREAMFLAGS_LOOPBACK,
+                0, 0, mix_format_, nullptr
+            );
+        }
         if (FAILED(hr)) {
             std::cerr << "Failed to initialize audio client: 0x" << std::hex << hr << std::endl;
             return false;
@@ -73,6 +108,9 @@ public:
 
     bool start() {
         if (!is_initialized_) return false;
+        if (read_capacity_ > 0) {
+            reader_.reset(read_capacity_);  // 采集线程尚未运行，可以安全地清空
+        }
         HRESULT hr = audio_client_->Start();
         if (FAILED(hr)) return false;
 
@@ -102,6 +140,41 @@ public:
         user_data_ = user_data;
     }
 
+    bool enable_read(int capacity_frames) {
+        if (capture_thread_ || capacity_frames <= 0) return false;
+        read_capacity_ = (size_t)capacity_frames;
+        reader_.reset(read_capacity_);
+        return true;
+    }
+
+    int read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+        return reader_.read(dst, max_frames, timeout_ms, position, flags);
+    }
+
+    void set_chunk_callback(audio_chunk_callback callback, void* user_data) {
+        chunk_callback_ = callback;
+        chunk_user_data_ = user_data;
+    }
+
+    void set_event_driven(bool enabled) {
+        if (!is_initialized_) {
+            event_driven_ = enabled;
+        }
+    }
+
+    void set_channel_weights(const float* weights, int count) {
+        if (weights && count > 0) {
+            channel_weights_.assign(weights, weights + count);
+        } else {
+            channel_weights_.clear();
+        }
+    }
+
+    void set_thread_placement(int cpu, bool realtime) {
+        capture_cpu_ = cpu;
+        realtime_ = realtime;
+    }
+
     int get_applications(AudioAppInfo* apps, int max_count) {
         if (!session_manager_) {
             HRESULT hr = audio_device_->Activate(
@@ -239,50 +312,166 @@ public:
     }
 
 private:
+    // 由混音格式确定样本格式；WAVE_FORMAT_EXTENSIBLE的实际格式在SubFormat GUID中
+    bool resolve_sample_format() {
+        uint16_t format_tag = mix_format_->wFormatTag;
+        if (format_tag == WAV_FORMAT_EXTENSIBLE && mix_format_->cbSize >= sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)) {
+            format_tag = (uint16_t)reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(mix_format_)->SubFormat.Data1;
+        }
+        if (!sample_format_from_wave(format_tag, mix_format_->wBitsPerSample, &sample_format_)) {
+            std::cerr << "Unsupported mix format: tag 0x" << std::hex << format_tag << std::dec
+                      << ", " << mix_format_->wBitsPerSample << " bits" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 初始化失败后IAudioClient不能再次Initialize，重新激活一个新的实例
+    void reset_audio_client() {
+        if (capture_event_) {
+            CloseHandle(capture_event_);
+            capture_event_ = nullptr;
+        }
+        if (audio_client_) {
+            audio_client_->Release();
+            audio_client_ = nullptr;
+        }
+        audio_device_->Activate(
+            IID_IAudioClient, CLSCTX_ALL,
+            nullptr, (void**)&audio_client_
+        );
+    }
+
+    // 由GetBuffer的设备位置与QPC位置生成块信息：位置相对于第一个包，保证单调递增；
+    // 时间戳无效时按上一块推算，位置跳变或驱动报告不连续时标记AUDIO_CHUNK_DISCONTINUITY
+    AudioChunkInfo chunk_info(DWORD flags, UINT64 device_position, UINT64 qpc_position, UINT32 frames) {
+        AudioChunkInfo info = {};
+        const bool timestamp_valid = !(flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR);
+        if (!have_position_ && timestamp_valid) {
+            position_base_ = device_position;
+            have_position_ = true;
+        }
+
+        uint64_t position = next_position_;
+        if (timestamp_valid && device_position >= position_base_) {
+            position = std::max<uint64_t>(device_position - position_base_, next_position_);
+        }
+        info.position = position;
+        // QPC位置以100ns为单位，与steady_clock（基于QPC）的纳秒时间同一起点
+        info.capture_ns = timestamp_valid && qpc_position > 0
+            ? (int64_t)qpc_position * 100
+            : std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
+            info.flags |= AUDIO_CHUNK_SILENT;
+        }
+        if ((flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) || position != next_position_) {
+            info.flags |= AUDIO_CHUNK_DISCONTINUITY;
+        }
+        next_position_ = position + frames;
+        return info;
+    }
+
     static DWORD WINAPI capture_thread_proc(LPVOID param) {
         auto* capture = static_cast<WasapiCapture*>(param);
-        return capture->capture_proc();
+        const DWORD ret = capture->capture_proc();
+        capture->reader_.finish();  // 唤醒阻塞在read()中的消费者
+        return ret;
     }
 
     DWORD capture_proc() {
         stop_capture_ = false;
-        const UINT32 buffer_frame_count = mix_format_->nSamplesPerSec / 100; // 10ms buffer
-        std::vector<float> buffer(buffer_frame_count);  // 单声道缓冲区
+        have_position_ = false;
+        position_base_ = 0;
+        next_position_ = 0;
+        std::vector<float> buffer(mix_format_->nSamplesPerSec / 100);  // 单声道缓冲区，按包大小扩展
+        trace_set_thread_name("capture (WASAPI)");
+
+        // 采集线程独占一个核并以MMCSS调度，避免被推理线程抢占而错过设备缓冲
+        if (capture_cpu_ >= 0 && !pin_current_thread({capture_cpu_})) {
+            std::cerr << "Failed to pin capture thread to CPU " << capture_cpu_ << std::endl;
+        }
+        RealtimePriority priority;
+        if (realtime_ && !priority.raise()) {
+            std::cerr << "Failed to register capture thread with MMCSS: " << GetLastError() << std::endl;
+        }
+
+        // 解码+下混内核按样本格式、声道数和CPU指令集选定一次，权重数与声道数不符时退回平均
+        const int channels = mix_format_->nChannels;
+        const bool use_weights = (int)channel_weights_.size() == channels;
+        if (!channel_weights_.empty() && !use_weights) {
+            std::cerr << "Channel weights count (" << channel_weights_.size() << ") does not match "
+                      << channels << " channels, averaging instead" << std::endl;
+        }
+        SampleDecoder decoder;
+        if (!decoder.init(sample_format_, channels, use_weights ? channel_weights_.data() : nullptr)) {
+            std::cerr << "Unsupported capture format: " << sample_format_name(sample_format_)
+                      << ", " << channels << " channels" << std::endl;
+            return 1;
+        }
+
+        // 部分系统上环回流不会触发事件：连续多次超时后仍有数据则退回轮询
+        const DWORD event_timeout_ms = 20;
+        int stale_timeouts = 0;
 
         while (!stop_capture_) {
+            bool timed_out = false;
+            if (event_driven_) {
+                timed_out = WaitForSingleObject(capture_event_, event_timeout_ms) == WAIT_TIMEOUT;
+            }
+
             UINT32 next_packet_size = 0;
             HRESULT hr = capture_client_->GetNextPacketSize(&next_packet_size);
             if (FAILED(hr)) break;
+            const bool got_packet = next_packet_size > 0;
 
             while (next_packet_size > 0) {
+                TraceSpan span("packet");
                 BYTE* data = nullptr;
                 UINT32 frames_available = 0;
                 DWORD flags = 0;
+                UINT64 device_position = 0;
+                UINT64 qpc_position = 0;
 
                 hr = capture_client_->GetBuffer(&data,
                     &frames_available,
                     &flags,
-                    nullptr,
-                    nullptr);
+                    &device_position,
+                    &qpc_position);
 
                 if (FAILED(hr)) break;
 
-                if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT)) {
-                    const float* float_data = reinterpret_cast<const float*>(data);
-                    const int channels = mix_format_->nChannels;
+                const AudioChunkInfo info = chunk_info(flags, device_position, qpc_position, frames_available);
+                const bool silent = (info.flags & AUDIO_CHUNK_SILENT) != 0;
 
-                    // 转换为单声道
-                    for (UINT32 i = 0; i < frames_available; i++) {
-                        float sum = 0.0f;
-                        for (int ch = 0; ch < channels; ch++) {
-                            sum += float_data[i * channels + ch];
+                if (!callback_ && !chunk_callback_ && reader_.enabled()) {
+                    // 只有拉取式读取：直接解码到环形缓冲，省去中间缓冲的拷贝
+                    reader_.write_with(frames_available, info.position, info.flags, [&](float* dst, size_t offset, size_t n) {
+                        if (silent) {
+                            std::fill(dst, dst + n, 0.0f);
+                        } else {
+                            decoder.process(data + offset * decoder.frame_bytes(), dst, n);
                         }
-                        buffer[i] = sum / channels;  // 平均值作为单声道数据
+                    });
+                } else {
+                    if (frames_available > buffer.size()) {
+                        buffer.resize(frames_available);
+                    }
+                    // 静音包也以全零投递，保持下游时间线连续
+                    if (silent) {
+                        std::fill(buffer.begin(), buffer.begin() + frames_available, 0.0f);
+                    } else {
+                        decoder.process(data, buffer.data(), frames_available);  // 解码并转换为单声道
                     }
 
+                    if (chunk_callback_) {
+                        chunk_callback_(chunk_user_data_, buffer.data(), frames_available, &info);
+                    }
                     if (callback_) {
                         callback_(user_data_, buffer.data(), frames_available);
                     }
+                    if (reader_.enabled()) {
+                        reader_.write(buffer.data(), frames_available, info.position, info.flags);
+                    }
                 }
 
                 hr = capture_client_->ReleaseBuffer(frames_available);
@@ -292,7 +481,15 @@ private:
                 if (FAILED(hr)) break;
             }
 
-            Sleep(1); // 避免CPU占用过高
+            if (event_driven_) {
+                stale_timeouts = timed_out && got_packet ? stale_timeouts + 1 : 0;
+                if (stale_timeouts >= 10) {
+                    std::cerr << "Capture event not signaled, falling back to polling" << std::endl;
+                    event_driven_ = false;
+                }
+            } else {
+                Sleep(1); // 避免CPU占用过高
+            }
         }
 
         return 0;
@@ -300,6 +497,11 @@ private:
 
     void cleanup() {
         stop();
+
+        if (capture_event_) {
+            CloseHandle(capture_event_);
+            capture_event_ = nullptr;
+        }
         
         if (mix_format_) {
             CoTaskMemFree(mix_format_);
@@ -338,13 +540,28 @@ private:
     IAudioCaptureClient* capture_client_;
     IAudioSessionManager2* session_manager_;
     WAVEFORMATEX* mix_format_;
+    SampleFormat sample_format_;
     
     bool is_initialized_;
     bool stop_capture_;
     HANDLE capture_thread_;
+    bool event_driven_;      // 事件驱动捕获（AUDCLNT_STREAMFLAGS_EVENTCALLBACK）
+    HANDLE capture_event_;
+    std::vector<float> channel_weights_;  // 下混权重，为空表示各声道平均
+    PullReader reader_;                   // 拉取式读取缓冲，enable_read()后启用
+    size_t read_capacity_ = 0;
+    int capture_cpu_ = -1;                // 采集线程固定到的逻辑CPU，-1为不固定
+    bool realtime_ = false;               // 采集线程注册为MMCSS "Pro Audio"任务
     
     audio_callback callback_;
     void* user_data_;
+    audio_chunk_callback chunk_callback_ = nullptr;
+    void* chunk_user_data_ = nullptr;
+
+    // 采集线程的位置记录
+    bool have_position_ = false;
+    uint64_t position_base_ = 0;          // 第一个包的设备位置
+    uint64_t next_position_ = 0;          // 下一块的预期位置
 };
 
 // C接口实现
@@ -379,6 +596,36 @@ void wasapi_capture_set_callback(void* handle, audio_callback callback, void* us
     capture->set_callback(callback, user_data);
 }
 
+void wasapi_capture_set_event_driven(void* handle, int enabled) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    capture->set_event_driven(enabled != 0);
+}
+
+void wasapi_capture_set_channel_weights(void* handle, const float* weights, int count) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    capture->set_channel_weights(weights, count);
+}
+
+void wasapi_capture_set_chunk_callback(void* handle, audio_chunk_callback callback, void* user_data) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    capture->set_chunk_callback(callback, user_data);
+}
+
+void wasapi_capture_set_thread_placement(void* handle, int cpu, int realtime) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    capture->set_thread_placement(cpu, realtime != 0);
+}
+
+int wasapi_capture_enable_read(void* handle, int capacity_frames) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->enable_read(capacity_frames) ? 1 : 0;
+}
+
+int wasapi_capture_read(void* handle, float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) {
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->read(dst, max_frames, timeout_ms, position, flags);
+}
+
 int wasapi_capture_get_applications(void* handle, AudioAppInfo* apps, int max_count) {
     auto* capture = static_cast<WasapiCapture*>(handle);
     return capture->get_applications(apps, max_count);
@@ -3,13 +3,13 @@
 
 #include <windows.h>
 #include <audiopolicy.h>
+#include <stdint.h>
+#include "../audio_types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef void (*audio_callback)(void* user_data, float* buffer, int frames);
-
 // 声明Go回调函数
 extern void goAudioCallback(void* user_data, float* buffer, int frames);
 
@@ -19,13 +19,6 @@ typedef struct {
     wchar_t name[260]; // 使用 260 替代 MAX_PATH
 } AudioAppInfo;
 
-// 音频格式结构体
-typedef struct {
-    unsigned int sample_rate;
-    unsigned int channels;
-    unsigned int bits_per_sample;
-} AudioFormat;
-
 void* wasapi_capture_create();
 void wasapi_capture_destroy(void* handle);
 int wasapi_capture_initialize(void* handle);
@@ -33,6 +26,30 @@ int wasapi_capture_start(void* handle);
 void wasapi_capture_stop(void* handle);
 void wasapi_capture_set_callback(void* handle, audio_callback callback, void* user_data);
 
+// 带时间信息的回调：位置来自GetBuffer的设备位置，采集时刻来自QPC位置；
+// 静音包以全零投递并带AUDIO_CHUNK_SILENT，数据丢失时带AUDIO_CHUNK_DISCONTINUITY
+void wasapi_capture_set_chunk_callback(void* handle, audio_chunk_callback callback, void* user_data);
+
+// 事件驱动捕获（默认开启），需在initialize之前调用；0表示每1ms轮询
+void wasapi_capture_set_event_driven(void* handle, int enabled);
+
+// 下混为单声道时各声道的权重（按设备声道顺序），需在start之前调用；weights为NULL表示各声道平均
+void wasapi_capture_set_channel_weights(void* handle, const float* weights, int count);
+
+// 采集线程固定到逻辑CPU cpu（-1为不固定），realtime非0时注册为MMCSS "Pro Audio"任务；需在start之前调用
+void wasapi_capture_set_thread_placement(void* handle, int cpu, int realtime);
+
+// 拉取式读取：启用后采集线程把单声道样本写入容量为capacity_frames帧的内部环形缓冲，
+// 消费者用wasapi_capture_read按自选批量读取（可与回调同时使用）。需在start之前调用，成功返回1
+int wasapi_capture_enable_read(void* handle, int capacity_frames);
+
+// 读取最多max_frames帧单声道样本：等待直到凑满max_frames、超时或采集停止。
+// timeout_ms为0时不等待，小于0时一直等待。返回读取的帧数（超时可能为0），采集已停止且缓冲为空时返回-1。
+// position（可为NULL）返回首帧在采集流中的位置（帧，与AudioChunkInfo.position相同）；缓冲满时新数据被丢弃，
+// 丢弃或设备丢失的帧计入position，flags（可为NULL）在这批之前有帧丢失时含AUDIO_CHUNK_DISCONTINUITY。
+// 一批内的帧总是连续的，遇到间断时提前返回
+int wasapi_capture_read(void* handle, float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags);
+
 // 新增：获取应用程序列表
 int wasapi_capture_get_applications(void* handle, AudioAppInfo* apps, int max_count);
 
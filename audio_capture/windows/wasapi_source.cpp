@@ -0,0 +1,66 @@
+#include "wasapi_capture.h"
+#include "../audio_source_backend.h"
+
+namespace {
+
+// WASAPI后端适配：转发到wasapi_capture_* C接口
+class WasapiSource : public AudioSourceBackend {
+public:
+    explicit WasapiSource(const AudioSourceConfig& config) :
+        capture_(wasapi_capture_create()),
+        pid_(config.pid) {
+        wasapi_capture_set_event_driven(capture_, config.event_driven);
+        wasapi_capture_set_channel_weights(capture_, config.channel_weights, (int)config.n_channel_weights);
+        wasapi_capture_set_thread_placement(capture_, config.capture_cpu, config.realtime_priority);
+    }
+
+    ~WasapiSource() override {
+        if (capture_) {
+            wasapi_capture_destroy(capture_);
+            capture_ = nullptr;
+        }
+    }
+
+    bool initialize() override {
+        return wasapi_capture_initialize(capture_) != 0;
+    }
+
+    bool start() override {
+        wasapi_capture_set_callback(capture_, callback_, user_data_);
+        wasapi_capture_set_chunk_callback(capture_, chunk_callback_, chunk_user_data_);
+        if (pid_ > 0) {
+            return wasapi_capture_start_process(capture_, pid_) != 0;
+        }
+        return wasapi_capture_start(capture_) != 0;
+    }
+
+    void stop() override {
+        wasapi_capture_stop(capture_);
+    }
+
+    bool get_format(AudioFormat* format) override {
+        return wasapi_capture_get_format(capture_, format) != 0;
+    }
+
+    bool enable_read(size_t capacity_frames) override {
+        return wasapi_capture_enable_read(capture_, (int)capacity_frames) != 0;
+    }
+
+    int read(float* dst, int max_frames, int timeout_ms, uint64_t* position, unsigned int* flags) override {
+        return wasapi_capture_read(capture_, dst, max_frames, timeout_ms, position, flags);
+    }
+
+    bool is_live() const override {
+        return true;
+    }
+
+private:
+    void* capture_;
+    unsigned int pid_;
+};
+
+} // namespace
+
+AudioSourceBackend* create_wasapi_source(const AudioSourceConfig& config) {
+    return new WasapiSource(config);
+}
@@ -0,0 +1,234 @@
+// audio_ctx 准确率/延迟对比：对WAV文件按与stream相同的滑动窗口切分，
+// 每个窗口分别以默认audio_ctx(30秒)和自适应audio_ctx调用whisper_full，
+// 统计推理耗时以及两者转写结果的词/字错误率（以默认audio_ctx的结果为参考）。
+#include "whisper.h"
+#include "audio_source.h"
+#include "resampler.h"
+#include "audio_ctx.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+// 读取整个WAV文件并重采样到16kHz
+static bool load_wav_16k(const char* path, std::vector<float>& pcm16k) {
+    AudioSourceConfig config;
+    audio_source_default_config(&config);
+    config.type = AUDIO_SOURCE_WAV;
+    config.path = path;
+    config.pace = 0.0f;
+
+    void* source = audio_source_create(&config);
+    AudioFormat format;
+    if (!source || !audio_source_get_format(source, &format)) {
+        if (source) audio_source_destroy(source);
+        return false;
+    }
+
+    std::vector<float> raw;
+    audio_source_set_callback(source, [](void* user_data, float* buffer, int frames) {
+        auto* out = static_cast<std::vector<float>*>(user_data);
+        out->insert(out->end(), buffer, buffer + frames);
+    }, &raw);
+
+    if (!audio_source_start(source)) {
+        audio_source_destroy(source);
+        return false;
+    }
+    while (!audio_source_is_finished(source)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    audio_source_stop(source);
+    audio_source_destroy(source);
+
+    Resampler resampler;
+    resampler.init(format.sample_rate, WHISPER_SAMPLE_RATE);
+    pcm16k.clear();
+    resampler.process(raw.data(), raw.size(), pcm16k);
+    return true;
+}
+
+// 切分为比较单元：空白分隔的词，CJK等多字节字符各自作为一个单元
+static std::vector<std::string> tokenize(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string word;
+    for (size_t i = 0; i < text.size();) {
+        const unsigned char c = text[i];
+        const size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        if (len == 1 && (c == ' ' || c == '\t' || c == '\n' || ispunct(c))) {
+            if (!word.empty()) tokens.push_back(word);
+            word.clear();
+        } else if (len >= 3) {
+            if (!word.empty()) tokens.push_back(word);
+            word.clear();
+            tokens.push_back(text.substr(i, len));
+        } else {
+            word += text.substr(i, len);
+        }
+        i += len;
+    }
+    if (!word.empty()) tokens.push_back(word);
+    return tokens;
+}
+
+// 编辑距离
+static size_t edit_distance(const std::vector<std::string>& a, const std::vector<std::string>& b) {
+    std::vector<size_t> prev(b.size() + 1), cur(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) prev[j] = j;
+    for (size_t i = 1; i <= a.size(); i++) {
+        cur[0] = i;
+        for (size_t j = 1; j <= b.size(); j++) {
+            cur[j] = std::min({ prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1) });
+        }
+        std::swap(prev, cur);
+    }
+    return prev[b.size()];
+}
+
+static std::string transcribe(struct whisper_context* ctx, whisper_full_params wparams,
+                              const float* samples, int n, double* elapsed_ms) {
+    const auto t0 = bench_clock::now();
+    const int ret = whisper_full(ctx, wparams, samples, n);
+    *elapsed_ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+    if (ret != 0) return std::string();
+
+    std::string text;
+    const int n_segments = whisper_full_n_segments(ctx);
+    for (int i = 0; i < n_segments; i++) {
+        text += whisper_full_get_segment_text(ctx, i);
+    }
+    return text;
+}
+
+static void show_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] <model_path> <file.wav> [file.wav ...]\n", program);
+    fprintf(stderr, "  -t,  --threads <n>      线程数 (默认: 8)\n");
+    fprintf(stderr, "  -l,  --language <lang>  输入语言 (默认: auto)\n");
+    fprintf(stderr, "  -sm, --step-ms <n>      窗口步长(ms) (默认: 500)\n");
+    fprintf(stderr, "  -lm, --length-ms <n>    窗口长度(ms) (默认: 5000)\n");
+    fprintf(stderr, "  --margin <x>            自适应audio_ctx安全余量 (默认: 0.1)\n");
+    fprintf(stderr, "  --max-windows <n>       每个文件最多比较的窗口数 (默认: 0, 不限)\n");
+    fprintf(stderr, "  -v,  --verbose          输出每个窗口的转写结果\n");
+}
+
+int main(int argc, char** argv) {
+    int threads = 8;
+    std::string language = "auto";
+    int step_ms = 500;
+    int length_ms = 5000;
+    float margin = 0.1f;
+    int max_windows = 0;
+    bool verbose = false;
+    std::vector<const char*> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") { show_usage(argv[0]); return 0; }
+        else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) threads = atoi(argv[++i]);
+        else if ((arg == "-l" || arg == "--language") && i + 1 < argc) language = argv[++i];
+        else if ((arg == "-sm" || arg == "--step-ms") && i + 1 < argc) step_ms = atoi(argv[++i]);
+        else if ((arg == "-lm" || arg == "--length-ms") && i + 1 < argc) length_ms = atoi(argv[++i]);
+        else if (arg == "--margin" && i + 1 < argc) margin = (float)atof(argv[++i]);
+        else if (arg == "--max-windows" && i + 1 < argc) max_windows = atoi(argv[++i]);
+        else if (arg == "-v" || arg == "--verbose") verbose = true;
+        else positional.push_back(argv[i]);
+    }
+    if (positional.size() < 2) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    struct whisper_context_params cparams = whisper_context_default_params();
+    struct whisper_context* ctx = whisper_init_from_file_with_params(positional[0], cparams);
+    if (!ctx) {
+        fprintf(stderr, "Failed to initialize whisper\n");
+        return 1;
+    }
+
+    const int n_audio_ctx = whisper_model_n_audio_ctx(ctx);
+    const int adaptive_ctx = adaptive_audio_ctx(length_ms, n_audio_ctx, margin);
+
+    // 与stream/main.cpp一致的推理参数
+    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    wparams.print_progress = false;
+    wparams.print_realtime = false;
+    wparams.print_timestamps = false;
+    wparams.language = language.c_str();
+    wparams.n_threads = threads;
+    wparams.max_tokens = 32;
+    wparams.single_segment = true;
+    wparams.no_context = true;
+    wparams.duration_ms = length_ms;
+
+    const int n_samples_step = WHISPER_SAMPLE_RATE * step_ms / 1000;
+    const int n_samples_len = WHISPER_SAMPLE_RATE * length_ms / 1000;
+
+    printf("model n_audio_ctx=%d, window=%d ms, step=%d ms, adaptive audio_ctx=%d (margin %.2f)\n",
+        n_audio_ctx, length_ms, step_ms, adaptive_ctx, margin);
+
+    size_t total_errors = 0;
+    size_t total_ref_tokens = 0;
+    size_t n_exact = 0;
+    size_t n_windows = 0;
+    double full_ms = 0.0;
+    double adaptive_ms = 0.0;
+
+    for (size_t f = 1; f < positional.size(); f++) {
+        std::vector<float> pcm;
+        if (!load_wav_16k(positional[f], pcm)) {
+            fprintf(stderr, "Failed to load %s\n", positional[f]);
+            continue;
+        }
+
+        int file_windows = 0;
+        for (size_t start = 0; start + n_samples_len <= pcm.size(); start += n_samples_step) {
+            if (max_windows > 0 && file_windows >= max_windows) break;
+            file_windows++;
+
+            double t_full, t_adaptive;
+            wparams.audio_ctx = 0;
+            const std::string ref = transcribe(ctx, wparams, pcm.data() + start, n_samples_len, &t_full);
+            wparams.audio_ctx = adaptive_ctx;
+            const std::string hyp = transcribe(ctx, wparams, pcm.data() + start, n_samples_len, &t_adaptive);
+
+            const auto ref_tokens = tokenize(ref);
+            const auto hyp_tokens = tokenize(hyp);
+            const size_t errors = edit_distance(ref_tokens, hyp_tokens);
+            total_errors += errors;
+            total_ref_tokens += ref_tokens.size();
+            n_exact += errors == 0 ? 1 : 0;
+            n_windows++;
+            full_ms += t_full;
+            adaptive_ms += t_adaptive;
+
+            if (verbose) {
+                printf("[%s @ %.1fs] full %.0f ms / adaptive %.0f ms, errors %zu/%zu\n  full:     %s\n  adaptive: %s\n",
+                    positional[f], (double)start / WHISPER_SAMPLE_RATE, t_full, t_adaptive,
+                    errors, ref_tokens.size(), ref.c_str(), hyp.c_str());
+            }
+        }
+    }
+
+    if (n_windows == 0) {
+        fprintf(stderr, "No complete windows to compare\n");
+        whisper_free(ctx);
+        return 1;
+    }
+
+    printf("windows: %zu\n", n_windows);
+    printf("latency full:     %.1f ms/window\n", full_ms / n_windows);
+    printf("latency adaptive: %.1f ms/window (%.2fx faster)\n", adaptive_ms / n_windows,
+        adaptive_ms > 0.0 ? full_ms / adaptive_ms : 0.0);
+    printf("identical transcripts: %.1f%%\n", 100.0 * n_exact / n_windows);
+    printf("token error rate vs full audio_ctx: %.2f%% (%zu/%zu)\n",
+        total_ref_tokens > 0 ? 100.0 * total_errors / total_ref_tokens : 0.0, total_errors, total_ref_tokens);
+
+    whisper_free(ctx);
+    return 0;
+}
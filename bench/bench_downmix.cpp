@@ -0,0 +1,128 @@
+// 交错多声道 → 单声道下混微基准：原捕获回调中的标量循环与各指令集内核对比。
+// 每种声道数、每个可用指令集处理相同的随机输入，统计每秒处理的帧数，
+// 并以双精度求和的结果为参考检查最大绝对误差。
+#include "downmix.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+// 与wasapi_capture.cpp原实现一致的下混循环
+static void downmix_reference_loop(const float* in, float* out, size_t frames, int channels) {
+    for (size_t i = 0; i < frames; i++) {
+        float sum = 0.0f;
+        for (int ch = 0; ch < channels; ch++) {
+            sum += in[i * channels + ch];
+        }
+        out[i] = sum / channels;
+    }
+}
+
+// 对in按packet_frames分包处理iterations遍，返回每秒处理的帧数
+template <typename F>
+static double measure(F&& fn, const std::vector<float>& in, std::vector<float>& out,
+                      int channels, size_t packet_frames, int iterations) {
+    const size_t total_frames = in.size() / channels;
+    const auto t0 = bench_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (size_t pos = 0; pos < total_frames; pos += packet_frames) {
+            const size_t n = std::min(packet_frames, total_frames - pos);
+            fn(in.data() + pos * channels, out.data() + pos, n);
+        }
+    }
+    const double seconds = std::chrono::duration<double>(bench_clock::now() - t0).count();
+    return seconds > 0.0 ? (double)total_frames * iterations / seconds : 0.0;
+}
+
+int main(int argc, char** argv) {
+    size_t frames = 48000 * 10;     // 10秒48kHz音频
+    size_t packet_frames = 480;     // 10ms包
+    int iterations = 20;
+    bool weighted = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) frames = (size_t)atol(argv[++i]);
+        else if (arg == "--packet" && i + 1 < argc) packet_frames = (size_t)atol(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc) iterations = atoi(argv[++i]);
+        else if (arg == "--weighted") weighted = true;
+        else {
+            fprintf(stderr, "Usage: %s [--frames n] [--packet n] [--iterations n] [--weighted]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames == 0 || packet_frames == 0 || iterations <= 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    printf("frames=%zu packet=%zu iterations=%d weights=%s detected=%s\n",
+        frames, packet_frames, iterations, weighted ? "random" : "average",
+        downmix_isa_name(downmix_detect_isa()));
+    printf("%-4s %-8s %12s %9s %12s\n", "ch", "kernel", "Mframes/s", "speedup", "max_err");
+
+    const DownmixIsa isas[] = { DOWNMIX_ISA_SCALAR, DOWNMIX_ISA_SSE2, DOWNMIX_ISA_AVX2, DOWNMIX_ISA_NEON };
+    const int channel_counts[] = { 1, 2, 4, 6, 8 };
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    bool ok = true;
+
+    for (int channels : channel_counts) {
+        std::vector<float> in(frames * channels);
+        for (float& v : in) v = dist(rng);
+
+        std::vector<float> weights(channels, 1.0f / channels);
+        if (weighted) {
+            for (float& w : weights) w = dist(rng);
+        }
+
+        // 双精度参考结果
+        std::vector<double> expected(frames);
+        for (size_t i = 0; i < frames; i++) {
+            double sum = 0.0;
+            for (int ch = 0; ch < channels; ch++) {
+                sum += (double)in[i * channels + ch] * weights[ch];
+            }
+            expected[i] = sum;
+        }
+
+        std::vector<float> out(frames);
+        double baseline = 0.0;
+        if (!weighted) {
+            baseline = measure([&](const float* src, float* dst, size_t n) {
+                downmix_reference_loop(src, dst, n, channels);
+            }, in, out, channels, packet_frames, iterations);
+            printf("%-4d %-8s %12.1f %9s %12s\n", channels, "loop", baseline / 1e6, "1.00x", "-");
+        }
+
+        for (DownmixIsa isa : isas) {
+            Downmixer downmixer;
+            if (!downmixer.init(channels, weights.data(), isa)) continue;   // 该指令集不可用
+
+            std::fill(out.begin(), out.end(), 0.0f);
+            const double rate = measure([&](const float* src, float* dst, size_t n) {
+                downmixer.process(src, dst, n);
+            }, in, out, channels, packet_frames, iterations);
+
+            double max_err = 0.0;
+            for (size_t i = 0; i < frames; i++) {
+                max_err = std::max(max_err, std::fabs((double)out[i] - expected[i]));
+            }
+            const bool pass = max_err <= 1e-5 * channels;
+            ok = ok && pass;
+
+            char speedup[32] = "-";
+            if (baseline > 0.0) snprintf(speedup, sizeof(speedup), "%.2fx", rate / baseline);
+            printf("%-4d %-8s %12.1f %9s %12.2e%s\n", channels, downmix_isa_name(isa),
+                rate / 1e6, speedup, max_err, pass ? "" : "  FAIL");
+        }
+    }
+
+    return ok ? 0 : 1;
+}
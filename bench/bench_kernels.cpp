@@ -0,0 +1,477 @@
+// 音频热路径内核微基准：每个热循环的原实现（reference）与替代实现在相同输入上单线程对比，
+// 结果以固定格式的JSON输出，便于逐次提交跟踪性能回退。
+//   downmix    交错多声道 → 单声道：capture_proc原标量循环 / 各指令集Downmixer内核
+//   silence    静音判断：原逐样本提前退出的max|x|循环 / 分块求最大值 / 流式VAD（16kHz，按包增量）
+//   resample   重采样到16kHz：原逐窗口线性插值 / 流式多相sinc Resampler
+//   handoff    采集回调 → 处理线程的交接：原mutex + std::queue<std::vector<float>> / SpscRing
+//              （单线程写入再取出，只测交接本身的开销；多线程竞争见bench_spsc_ring）
+//   utf8       片段文本UTF-8 → 宽字符：原实现 / ASCII快速路径的单遍解码
+// 包大小为480帧（48kHz下10ms），窗口为5秒；下混覆盖2/6/8声道。
+//
+// JSON格式（schema "bench_kernels/1"）：results按固定顺序列出，每项的字段固定：
+//   kernel, variant, case, items（每次调用处理的帧/样本/字节数）, ns_per_call（5轮的中位数）,
+//   ns_per_call_min, ns_per_item, x_realtime（音频时长/耗时，非音频内核为0）, speedup（相对同case的reference）
+#include "downmix.h"
+#include "spsc_ring.h"
+#include "resampler.h"
+#include "vad.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+
+const int CAPTURE_RATE = 48000;
+const int WHISPER_RATE = 16000;
+const size_t PACKET_FRAMES = 480;           // 48kHz下10ms
+const size_t WINDOW_FRAMES = 5 * 48000;     // 5秒窗口
+const int N_ROUNDS = 5;
+
+struct Result {
+    std::string kernel;
+    std::string variant;
+    std::string case_name;
+    size_t items = 0;
+    double audio_s = 0.0;       // 每次调用处理的音频时长，非音频内核为0
+    double ns_median = 0.0;
+    double ns_min = 0.0;
+};
+
+std::vector<Result> g_results;
+double g_min_time_ms = 250.0;
+std::string g_filter;
+volatile float g_sink = 0.0f;   // 防止被测代码被优化掉
+
+// 先标定每轮的调用次数（每轮约min_time/N_ROUNDS），再跑N_ROUNDS轮，记录每次调用耗时的中位数和最小值
+template <typename F>
+void run(const char* kernel, const char* variant, const std::string& case_name, size_t items, double audio_s, F&& fn) {
+    if (!g_filter.empty() && g_filter != kernel) {
+        return;
+    }
+
+    const double round_ns = g_min_time_ms * 1e6 / N_ROUNDS;
+    uint64_t calls = 1;
+    for (;;) {
+        const auto t0 = bench_clock::now();
+        for (uint64_t i = 0; i < calls; i++) fn();
+        const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count();
+        if (ns >= round_ns / 4 || calls >= (1ull << 30)) {
+            calls = std::max<uint64_t>(1, (uint64_t)(calls * round_ns / std::max(ns, 1.0)));
+            break;
+        }
+        calls *= 4;
+    }
+
+    std::vector<double> per_call;
+    for (int round = 0; round < N_ROUNDS; round++) {
+        const auto t0 = bench_clock::now();
+        for (uint64_t i = 0; i < calls; i++) fn();
+        const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now() - t0).count();
+        per_call.push_back(ns / calls);
+    }
+    std::sort(per_call.begin(), per_call.end());
+
+    Result result;
+    result.kernel = kernel;
+    result.variant = variant;
+    result.case_name = case_name;
+    result.items = items;
+    result.audio_s = audio_s;
+    result.ns_median = per_call[N_ROUNDS / 2];
+    result.ns_min = per_call[0];
+    g_results.push_back(result);
+    fprintf(stderr, "%-9s %-16s %-14s %12.1f ns/call\n", kernel, variant, case_name.c_str(), result.ns_median);
+}
+
+std::vector<float> random_signal(size_t n, float amplitude, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-amplitude, amplitude);
+    std::vector<float> out(n);
+    for (float& v : out) v = dist(rng);
+    return out;
+}
+
+// ---- downmix ----
+
+// 与wasapi_capture.cpp原实现一致的下混循环
+void downmix_reference_loop(const float* in, float* out, size_t frames, int channels) {
+    for (size_t i = 0; i < frames; i++) {
+        float sum = 0.0f;
+        for (int ch = 0; ch < channels; ch++) {
+            sum += in[i * channels + ch];
+        }
+        out[i] = sum / channels;
+    }
+}
+
+void bench_downmix() {
+    const int channel_counts[] = { 2, 6, 8 };
+    const size_t sizes[] = { PACKET_FRAMES, WINDOW_FRAMES };
+    const DownmixIsa isas[] = { DOWNMIX_ISA_SCALAR, DOWNMIX_ISA_SSE2, DOWNMIX_ISA_AVX2, DOWNMIX_ISA_NEON };
+
+    for (int channels : channel_counts) {
+        for (size_t frames : sizes) {
+            const std::vector<float> in = random_signal(frames * channels, 1.0f, 1234);
+            std::vector<float> out(frames);
+            const std::string case_name = "ch" + std::to_string(channels) + "_" + std::to_string(frames);
+            const double audio_s = (double)frames / CAPTURE_RATE;
+
+            run("downmix", "reference", case_name, frames, audio_s, [&] {
+                downmix_reference_loop(in.data(), out.data(), frames, channels);
+                g_sink = out[frames - 1];
+            });
+            for (DownmixIsa isa : isas) {
+                Downmixer mixer;
+                if (!downmix_get_kernel(isa, channels) || !mixer.init(channels, nullptr, isa)) {
+                    continue;
+                }
+                const std::string variant = std::string("downmixer_") + downmix_isa_name(isa);
+                run("downmix", variant.c_str(), case_name, frames, audio_s, [&] {
+                    mixer.process(in.data(), out.data(), frames);
+                    g_sink = out[frames - 1];
+                });
+            }
+        }
+    }
+}
+
+// ---- silence ----
+
+// 原whisper_processing_thread中的静音判断：逐样本更新max|x|，超过0.01立即返回
+bool silence_reference(const float* data, size_t n) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        max_abs = std::max(max_abs, std::abs(data[i]));
+        if (max_abs > 0.01f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按256个样本分块求max|x|，块内用8路独立累加（无分支、无依赖链，可向量化），每块结束再判断
+bool silence_blocked(const float* data, size_t n) {
+    const size_t block = 256;
+    for (size_t start = 0; start < n; start += block) {
+        const size_t end = std::min(n, start + block);
+        float lanes[8] = {};
+        size_t i = start;
+        for (; i + 8 <= end; i += 8) {
+            for (int k = 0; k < 8; k++) {
+                const float v = std::fabs(data[i + k]);
+                lanes[k] = lanes[k] > v ? lanes[k] : v;
+            }
+        }
+        float max_abs = 0.0f;
+        for (int k = 0; k < 8; k++) {
+            max_abs = std::max(max_abs, lanes[k]);
+        }
+        for (; i < end; i++) {
+            max_abs = std::max(max_abs, std::fabs(data[i]));
+        }
+        if (max_abs > 0.01f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void bench_silence() {
+    // 低于阈值的噪声：原实现需要扫描整个窗口，是静音跳过时的最坏情况
+    const size_t sizes[] = { PACKET_FRAMES, WINDOW_FRAMES };
+    for (size_t n : sizes) {
+        const std::vector<float> in = random_signal(n, 0.008f, 42);
+        const std::string case_name = "48k_" + std::to_string(n);
+        const double audio_s = (double)n / CAPTURE_RATE;
+
+        run("silence", "reference", case_name, n, audio_s, [&] {
+            g_sink = silence_reference(in.data(), n) ? 1.0f : 0.0f;
+        });
+        run("silence", "blocked_max", case_name, n, audio_s, [&] {
+            g_sink = silence_blocked(in.data(), n) ? 1.0f : 0.0f;
+        });
+
+        // 替代方案：重采样后16kHz上的流式VAD，每个样本只分析一次（同样音频时长的输入）
+        const size_t n16 = n * WHISPER_RATE / CAPTURE_RATE;
+        const std::vector<float> in16 = random_signal(n16, 0.008f, 43);
+        StreamingVad vad;
+        VadParams params;
+        vad.init(params, WHISPER_RATE);
+        run("silence", "streaming_vad", case_name, n16, audio_s, [&] {
+            vad.process(in16.data(), n16);
+            vad.discard_before(UINT64_MAX);
+            g_sink = vad.last_score();
+        });
+    }
+}
+
+// ---- resample ----
+
+// 原whisper_processing_thread中的线性插值重采样（每个窗口从头计算）
+void resample_reference(const std::vector<float>& audio_data, std::vector<float>& processed_data, int sample_rate) {
+    processed_data.resize(audio_data.size() * WHISPER_RATE / sample_rate);
+    for (size_t i = 0; i < processed_data.size(); i++) {
+        float src_idx = i * sample_rate / (float)WHISPER_RATE;
+        size_t src_idx_floor = (size_t)src_idx;
+        float t = src_idx - src_idx_floor;
+
+        if (src_idx_floor >= audio_data.size() - 1) {
+            processed_data[i] = audio_data.back();
+        } else {
+            processed_data[i] = audio_data[src_idx_floor] * (1 - t) +
+                                audio_data[src_idx_floor + 1] * t;
+        }
+    }
+}
+
+void bench_resample() {
+    const int rates[] = { 48000, 44100 };
+    for (int rate : rates) {
+        const size_t sizes[] = { (size_t)rate / 100, (size_t)rate * 5 };
+        for (size_t n : sizes) {
+            const std::vector<float> in = random_signal(n, 0.5f, 7);
+            const std::string case_name = std::to_string(rate) + "_" + std::to_string(n);
+            const double audio_s = (double)n / rate;
+
+            std::vector<float> out;
+            run("resample", "reference", case_name, n, audio_s, [&] {
+                resample_reference(in, out, rate);
+                g_sink = out.back();
+            });
+
+            Resampler resampler;
+            resampler.init(rate, WHISPER_RATE);
+            std::vector<float> stream_out(resampler.max_output(n));
+            run("resample", "polyphase", case_name, n, audio_s, [&] {
+                const size_t n_out = resampler.process(in.data(), n, stream_out.data());
+                g_sink = stream_out[n_out > 0 ? n_out - 1 : 0];
+            });
+        }
+    }
+}
+
+// ---- handoff ----
+
+// 与stream/main.cpp原实现一致的队列
+struct QueueBuffer {
+    std::mutex mtx;
+    std::queue<std::vector<float>> queue;
+};
+
+void bench_handoff() {
+    // 每次调用：写入n_packets个480帧的包，再由消费者一次取出到处理缓冲
+    const size_t packet_counts[] = { 1, WINDOW_FRAMES / PACKET_FRAMES };
+    const std::vector<float> packet = random_signal(PACKET_FRAMES, 0.5f, 3);
+    for (size_t n_packets : packet_counts) {
+        const size_t n = n_packets * PACKET_FRAMES;
+        const std::string case_name = std::to_string(n_packets) + "x" + std::to_string(PACKET_FRAMES);
+        const double audio_s = (double)n / CAPTURE_RATE;
+        std::vector<float> audio_data;
+        audio_data.reserve(n);
+
+        QueueBuffer buffer;
+        run("handoff", "reference", case_name, n, audio_s, [&] {
+            for (size_t p = 0; p < n_packets; p++) {
+                std::vector<float> frame_data(packet.begin(), packet.end());
+                std::lock_guard<std::mutex> lock(buffer.mtx);
+                buffer.queue.push(std::move(frame_data));
+            }
+            audio_data.clear();
+            std::lock_guard<std::mutex> lock(buffer.mtx);
+            while (!buffer.queue.empty()) {
+                auto& chunk = buffer.queue.front();
+                audio_data.insert(audio_data.end(), chunk.begin(), chunk.end());
+                buffer.queue.pop();
+            }
+            g_sink = audio_data.back();
+        });
+
+        SpscRing<float> ring(n);
+        run("handoff", "spsc_ring", case_name, n, audio_s, [&] {
+            for (size_t p = 0; p < n_packets; p++) {
+                ring.write(packet.data(), packet.size());
+            }
+            audio_data.clear();
+            const float* first;
+            const float* second;
+            size_t first_n, second_n;
+            const size_t available = ring.peek(&first, &first_n, &second, &second_n);
+            audio_data.insert(audio_data.end(), first, first + first_n);
+            audio_data.insert(audio_data.end(), second, second + second_n);
+            ring.consume(available);
+            g_sink = audio_data.back();
+        });
+    }
+}
+
+// ---- utf8 ----
+
+// stream/main.cpp中的to_wide
+std::wstring to_wide_reference(const char* text) {
+#ifdef _WIN32
+    int len = MultiByteToWideChar(CP_UTF8, 0, text, -1, NULL, 0);
+    std::wstring wtext(len > 0 ? len - 1 : 0, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text, -1, &wtext[0], len);
+    return wtext;
+#else
+    std::wstring wtext;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    while (*p) {
+        uint32_t cp = *p;
+        int extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+        if (extra > 0) {
+            cp &= 0x3F >> extra;
+        }
+        p++;
+        for (; extra > 0 && (*p & 0xC0) == 0x80; extra--, p++) {
+            cp = (cp << 6) | (*p & 0x3F);
+        }
+        wtext.push_back((wchar_t)cp);
+    }
+    return wtext;
+#endif
+}
+
+// 替代方案：按字节数一次分配（宽字符数不超过字节数），8字节一组检查最高位走ASCII快速路径，
+// 只在遇到多字节序列时逐个解码。wchar_t为16位时超出BMP的码点输出代理对
+void to_wide_fast(const char* text, size_t len, std::wstring& out) {
+    out.resize(len);
+    wchar_t* dst = &out[0];
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    const unsigned char* end = p + len;
+    while (p < end) {
+        if (end - p >= 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p, 8);
+            if ((chunk & 0x8080808080808080ull) == 0) {
+                for (int i = 0; i < 8; i++) *dst++ = (wchar_t)p[i];
+                p += 8;
+                continue;
+            }
+        }
+        uint32_t cp = *p++;
+        if (cp >= 0x80) {
+            int extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+            if (extra > 0) {
+                cp &= 0x3F >> extra;
+            }
+            for (; extra > 0 && p < end && (*p & 0xC0) == 0x80; extra--, p++) {
+                cp = (cp << 6) | (*p & 0x3F);
+            }
+        }
+        if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+            cp -= 0x10000;
+            *dst++ = (wchar_t)(0xD800 + (cp >> 10));
+            *dst++ = (wchar_t)(0xDC00 + (cp & 0x3FF));
+        } else {
+            *dst++ = (wchar_t)cp;
+        }
+    }
+    out.resize(dst - &out[0]);
+}
+
+void bench_utf8() {
+    // 典型的whisper片段：英文、中文、长的中英混合转写
+    const std::string ascii = " And so my fellow Americans, ask not what your country can do for you.";
+    const std::string cjk = "今天的会议主要讨论下个季度的产品规划和人员安排。";
+    std::string mixed;
+    while (mixed.size() < 4096) {
+        mixed += cjk + ascii;
+    }
+    const std::pair<const char*, const std::string*> cases[] = { {"ascii", &ascii}, {"cjk", &cjk}, {"mixed_4k", &mixed} };
+
+    for (const auto& c : cases) {
+        const std::string& text = *c.second;
+        const std::string case_name = std::string(c.first) + "_" + std::to_string(text.size());
+        if (to_wide_reference(text.c_str()) != [&] { std::wstring w; to_wide_fast(text.data(), text.size(), w); return w; }()) {
+            fprintf(stderr, "utf8: fast decoder output differs on %s\n", case_name.c_str());
+        }
+
+        run("utf8", "reference", case_name, text.size(), 0.0, [&] {
+            const std::wstring wtext = to_wide_reference(text.c_str());
+            g_sink = (float)wtext.back();
+        });
+        std::wstring wtext;
+        run("utf8", "ascii_fast_path", case_name, text.size(), 0.0, [&] {
+            to_wide_fast(text.data(), text.size(), wtext);
+            g_sink = (float)wtext.back();
+        });
+    }
+}
+
+void write_json(FILE* out) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"schema\": \"bench_kernels/1\",\n");
+    fprintf(out, "  \"config\": {\"min_time_ms\": %.0f, \"rounds\": %d, \"downmix_isa\": \"%s\"},\n",
+        g_min_time_ms, N_ROUNDS, downmix_isa_name(downmix_detect_isa()));
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const Result& r = g_results[i];
+        double reference_ns = 0.0;
+        for (const Result& other : g_results) {
+            if (other.kernel == r.kernel && other.case_name == r.case_name && other.variant == "reference") {
+                reference_ns = other.ns_median;
+            }
+        }
+        fprintf(out, "    {\"kernel\": \"%s\", \"variant\": \"%s\", \"case\": \"%s\", \"items\": %zu, "
+            "\"ns_per_call\": %.1f, \"ns_per_call_min\": %.1f, \"ns_per_item\": %.4f, \"x_realtime\": %.1f, \"speedup\": %.3f}%s\n",
+            r.kernel.c_str(), r.variant.c_str(), r.case_name.c_str(), r.items,
+            r.ns_median, r.ns_min, r.ns_median / r.items,
+            r.audio_s > 0.0 ? r.audio_s * 1e9 / r.ns_median : 0.0,
+            reference_ns > 0.0 ? reference_ns / r.ns_median : 0.0,
+            i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* output_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--min-time-ms" && i + 1 < argc) g_min_time_ms = atof(argv[++i]);
+        else if (arg == "--kernel" && i + 1 < argc) g_filter = argv[++i];
+        else if ((arg == "-o" || arg == "--output") && i + 1 < argc) output_path = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--kernel downmix|silence|resample|handoff|utf8] [--min-time-ms n] [-o file.json]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_min_time_ms <= 0.0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    bench_downmix();
+    bench_silence();
+    bench_resample();
+    bench_handoff();
+    bench_utf8();
+
+    FILE* out = output_path ? fopen(output_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Failed to open output file: %s\n", output_path);
+        return 1;
+    }
+    write_json(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
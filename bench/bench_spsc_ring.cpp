@@ -0,0 +1,192 @@
+// 音频缓冲交接微基准：原 mutex + std::queue<std::vector<float>> 与 SpscRing 对比
+// 生产者模拟捕获回调按包写入，消费者模拟whisper线程批量取出。
+// 吞吐测试：缓冲满时生产者让出CPU重试（不丢数据），统计每秒交接的样本数；
+// 延迟测试：生产者按固定间隔写包，统计单次写入耗时（实时捕获线程上的开销）的尾延迟。
+#include "spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    double seconds = 0.0;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    std::vector<uint32_t> push_ns;
+};
+
+// 与stream/main.cpp原实现一致的队列
+struct QueueBuffer {
+    std::mutex mtx;
+    std::queue<std::vector<float>> queue;
+    static const int MAX_SIZE = 100;
+};
+
+static uint32_t elapsed_ns(bench_clock::time_point t0, bench_clock::time_point t1) {
+    return (uint32_t)std::min<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(), UINT32_MAX);
+}
+
+// 按间隔等待到下一个包的时刻；interval_us为0时不等待
+static void wait_until_packet(bench_clock::time_point t_start, int i, int interval_us) {
+    if (interval_us <= 0) return;
+    const auto t_due = t_start + std::chrono::microseconds((int64_t)i * interval_us);
+    while (bench_clock::now() < t_due) {
+        std::this_thread::yield();
+    }
+}
+
+static BenchResult run_queue(int packet_frames, int n_packets, int interval_us) {
+    QueueBuffer buffer;
+    std::atomic<bool> done{false};
+    BenchResult result;
+    result.push_ns.reserve(n_packets);
+
+    std::thread consumer([&] {
+        std::vector<float> audio_data;
+        audio_data.reserve(1 << 20);
+        while (true) {
+            const bool finished = done;
+            {
+                std::lock_guard<std::mutex> lock(buffer.mtx);
+                while (!buffer.queue.empty()) {
+                    auto& chunk = buffer.queue.front();
+                    audio_data.insert(audio_data.end(), chunk.begin(), chunk.end());
+                    buffer.queue.pop();
+                }
+            }
+            result.samples += audio_data.size();
+            audio_data.clear();
+            if (finished) break;
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<float> packet(packet_frames, 0.5f);
+    const auto t_start = bench_clock::now();
+    for (int i = 0; i < n_packets; i++) {
+        wait_until_packet(t_start, i, interval_us);
+        const auto t0 = bench_clock::now();
+        std::vector<float> frame_data(packet.begin(), packet.end());
+        bool pushed = false;
+        {
+            std::lock_guard<std::mutex> lock(buffer.mtx);
+            if (buffer.queue.size() < QueueBuffer::MAX_SIZE) {
+                buffer.queue.push(std::move(frame_data));
+                pushed = true;
+            }
+        }
+        result.push_ns.push_back(elapsed_ns(t0, bench_clock::now()));
+        if (!pushed) {
+            if (interval_us > 0) {
+                result.dropped += packet_frames;
+            } else {
+                std::this_thread::yield();
+                i--;
+            }
+        }
+    }
+    done = true;
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(bench_clock::now() - t_start).count();
+    return result;
+}
+
+static BenchResult run_ring(int packet_frames, int n_packets, int interval_us) {
+    SpscRing<float> ring(100 * (size_t)packet_frames);
+    std::atomic<bool> done{false};
+    BenchResult result;
+    result.push_ns.reserve(n_packets);
+
+    std::thread consumer([&] {
+        std::vector<float> audio_data;
+        audio_data.reserve(1 << 20);
+        while (true) {
+            const bool finished = done;
+            const float* first;
+            const float* second;
+            size_t first_n, second_n;
+            const size_t n = ring.peek(&first, &first_n, &second, &second_n);
+            audio_data.insert(audio_data.end(), first, first + first_n);
+            audio_data.insert(audio_data.end(), second, second + second_n);
+            ring.consume(n);
+            result.samples += audio_data.size();
+            audio_data.clear();
+            if (finished && n == 0) break;
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<float> packet(packet_frames, 0.5f);
+    const auto t_start = bench_clock::now();
+    for (int i = 0; i < n_packets; i++) {
+        wait_until_packet(t_start, i, interval_us);
+        const auto t0 = bench_clock::now();
+        size_t written = ring.write(packet.data(), packet.size());
+        result.push_ns.push_back(elapsed_ns(t0, bench_clock::now()));
+        while (interval_us <= 0 && written < packet.size()) {
+            std::this_thread::yield();
+            written += ring.write(packet.data() + written, packet.size() - written);
+        }
+        result.dropped += packet.size() - written;
+    }
+    done = true;
+    consumer.join();
+    result.seconds = std::chrono::duration<double>(bench_clock::now() - t_start).count();
+    return result;
+}
+
+static uint32_t percentile(std::vector<uint32_t>& v, double p) {
+    const size_t idx = std::min(v.size() - 1, (size_t)(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + idx, v.end());
+    return v[idx];
+}
+
+static void report(const char* name, BenchResult& r) {
+    const uint32_t max_ns = *std::max_element(r.push_ns.begin(), r.push_ns.end());
+    printf("%-14s %10.1f %10.3f %8u %8u %8u %10u\n",
+        name,
+        r.samples / r.seconds / 1e6,
+        100.0 * r.dropped / (r.samples + r.dropped),
+        percentile(r.push_ns, 0.50),
+        percentile(r.push_ns, 0.99),
+        percentile(r.push_ns, 0.999),
+        max_ns);
+}
+
+int main(int argc, char** argv) {
+    int packet_frames = 480;   // 48kHz下10ms一包
+    int n_packets = 200000;
+    int interval_us = 100;     // 延迟测试的写包间隔（100倍实时）
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames") packet_frames = atoi(argv[++i]);
+        else if (arg == "--packets") n_packets = atoi(argv[++i]);
+        else if (arg == "--interval-us") interval_us = atoi(argv[++i]);
+    }
+
+    printf("packet_frames=%d packets=%d\n", packet_frames, n_packets);
+    printf("%-14s %10s %10s %8s %8s %8s %10s\n",
+        "buffer", "Msamples/s", "drop%", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+
+    printf("-- throughput (lossless)\n");
+    BenchResult queue_result = run_queue(packet_frames, n_packets, 0);
+    report("mutex+queue", queue_result);
+    BenchResult ring_result = run_ring(packet_frames, n_packets, 0);
+    report("spsc_ring", ring_result);
+
+    printf("-- paced, interval %d us\n", interval_us);
+    const int n_paced = std::min(n_packets, 20000);
+    queue_result = run_queue(packet_frames, n_paced, interval_us);
+    report("mutex+queue", queue_result);
+    ring_result = run_ring(packet_frames, n_paced, interval_us);
+    report("spsc_ring", ring_result);
+    return 0;
+}
@@ -0,0 +1,279 @@
+// 计算线程池微基准：模拟一次whisper_full中由屏障隔开的大量小并行算子（ggml图计算的形态），
+// 比较每次调用创建线程、常驻线程池（立即休眠 / 先自旋再休眠）和OpenMP并行区的
+// 单次调用延迟分位数与进程CPU时间。调用之间按--interval-ms休眠，模拟两个推理步长之间的空闲。
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+static double process_cpu_s() {
+#ifdef _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time)) {
+        return 0.0;
+    }
+    const auto to_100ns = [](const FILETIME& t) { return ((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+    return (to_100ns(kernel_time) + to_100ns(user_time)) / 1e7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+// 先自旋spin_us微秒检查条件，仍不满足再在条件变量上休眠
+template <typename Pred>
+static void spin_then_wait(Pred pred, int spin_us, std::mutex& mtx, std::condition_variable& cv) {
+    if (spin_us > 0) {
+        const auto deadline = bench_clock::now() + std::chrono::microseconds(spin_us);
+        do {
+            for (int i = 0; i < 64; i++) {
+                if (pred()) return;
+            }
+            std::this_thread::yield();  // 线程数超过核数时让出CPU给还没到达的线程
+        } while (bench_clock::now() < deadline);
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, pred);
+}
+
+// 可重复使用的屏障，等待方式同spin_then_wait
+class Barrier {
+public:
+    Barrier(int n, int spin_us) : n_(n), spin_us_(spin_us) {}
+
+    void wait() {
+        const unsigned gen = generation_.load(std::memory_order_acquire);
+        if (arrived_.fetch_add(1, std::memory_order_acq_rel) + 1 == n_) {
+            arrived_.store(0, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                generation_.store(gen + 1, std::memory_order_release);
+            }
+            cv_.notify_all();
+            return;
+        }
+        spin_then_wait([&] { return generation_.load(std::memory_order_acquire) != gen; }, spin_us_, mtx_, cv_);
+    }
+
+private:
+    const int n_;
+    const int spin_us_;
+    std::atomic<int> arrived_{0};
+    std::atomic<unsigned> generation_{0};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+};
+
+// 模拟的计算图：ops个算子，每个算子把数据按线程数切片处理，算子之间需要屏障
+struct Graph {
+    std::vector<float> data;
+    int ops = 0;
+
+    // 第ith个线程（共nth个）执行第op个算子中自己的切片
+    void run_slice(int op, int ith, int nth) {
+        const size_t n = data.size();
+        const size_t begin = n * ith / nth;
+        const size_t end = n * (ith + 1) / nth;
+        const float a = 0.999f + op * 1e-6f;
+        for (size_t i = begin; i < end; i++) {
+            data[i] = data[i] * a + 0.001f;
+        }
+    }
+};
+
+// 每次调用创建threads-1个线程，调用线程作为第0个线程参与计算（ggml非OpenMP构建的方式）
+static void compute_spawn(Graph& graph, int threads) {
+    Barrier barrier(threads, 0);
+    auto body = [&](int ith) {
+        for (int op = 0; op < graph.ops; op++) {
+            graph.run_slice(op, ith, threads);
+            barrier.wait();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(body, i);
+    }
+    body(0);
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+// 常驻线程池：工作线程在调用之间按spin_us等待下一次调用
+class ThreadPool {
+public:
+    ThreadPool(Graph& graph, int threads, int spin_us)
+        : graph_(graph), threads_(threads), spin_us_(spin_us), barrier_(threads, spin_us) {
+        for (int i = 1; i < threads; i++) {
+            workers_.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+            call_.fetch_add(1, std::memory_order_release);
+        }
+        cv_.notify_all();
+        for (std::thread& t : workers_) {
+            t.join();
+        }
+    }
+
+    void compute() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            call_.fetch_add(1, std::memory_order_release);
+        }
+        cv_.notify_all();
+        run(0);
+    }
+
+private:
+    void run(int ith) {
+        for (int op = 0; op < graph_.ops; op++) {
+            graph_.run_slice(op, ith, threads_);
+            barrier_.wait();
+        }
+    }
+
+    void worker_loop(int ith) {
+        unsigned seen = 0;
+        for (;;) {
+            spin_then_wait([&] { return call_.load(std::memory_order_acquire) != seen; }, spin_us_, mtx_, cv_);
+            seen = call_.load(std::memory_order_acquire);
+            if (stop_) {
+                return;
+            }
+            run(ith);
+        }
+    }
+
+    Graph& graph_;
+    const int threads_;
+    const int spin_us_;
+    Barrier barrier_;
+    std::vector<std::thread> workers_;
+    std::atomic<unsigned> call_{0};
+    bool stop_ = false;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+};
+
+#ifdef _OPENMP
+// 与ggml的OpenMP构建相同：每次调用进入并行区，线程组由运行时常驻复用，
+// 等待方式由OMP_WAIT_POLICY / GOMP_SPINCOUNT / KMP_BLOCKTIME决定
+static void compute_openmp(Graph& graph, int threads) {
+    #pragma omp parallel num_threads(threads)
+    {
+        const int ith = omp_get_thread_num();
+        const int nth = omp_get_num_threads();
+        for (int op = 0; op < graph.ops; op++) {
+            graph.run_slice(op, ith, nth);
+            #pragma omp barrier
+        }
+    }
+}
+#endif
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+// 运行calls次调用，输出延迟分位数与期间的CPU时间
+static void measure(const char* name, int calls, int interval_ms, const std::function<void()>& fn) {
+    fn();   // 预热：创建线程组、触发页面分配
+    std::vector<double> latency_us;
+    latency_us.reserve(calls);
+    const double cpu0 = process_cpu_s();
+    const auto wall0 = bench_clock::now();
+    for (int i = 0; i < calls; i++) {
+        const auto t0 = bench_clock::now();
+        fn();
+        latency_us.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count());
+        if (interval_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        }
+    }
+    const double wall_s = std::chrono::duration<double>(bench_clock::now() - wall0).count();
+    const double cpu_s = process_cpu_s() - cpu0;
+    printf("%-14s %10.1f %10.1f %10.1f %9.3f %9.2f\n", name,
+        percentile(latency_us, 0.50), percentile(latency_us, 0.99),
+        *std::max_element(latency_us.begin(), latency_us.end()),
+        cpu_s, wall_s > 0.0 ? cpu_s / wall_s : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int threads = 8;
+    int ops = 200;                  // 每次调用的算子数
+    size_t elements = 16384;        // 每个算子处理的数据量
+    int calls = 200;
+    int interval_ms = 10;           // 两次调用之间的空闲
+    int spin_us = 200;              // 自旋线程池的自旋时长
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (arg == "--ops" && i + 1 < argc) ops = atoi(argv[++i]);
+        else if (arg == "--elements" && i + 1 < argc) elements = (size_t)atol(argv[++i]);
+        else if (arg == "--calls" && i + 1 < argc) calls = atoi(argv[++i]);
+        else if (arg == "--interval-ms" && i + 1 < argc) interval_ms = atoi(argv[++i]);
+        else if (arg == "--spin-us" && i + 1 < argc) spin_us = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--threads n] [--ops n] [--elements n] [--calls n] [--interval-ms n] [--spin-us n]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads <= 0 || ops <= 0 || elements == 0 || calls <= 0 || interval_ms < 0 || spin_us < 0) {
+        fprintf(stderr, "Invalid arguments\n");
+        return 1;
+    }
+
+    Graph graph;
+    graph.data.assign(elements, 1.0f);
+    graph.ops = ops;
+
+    printf("threads=%d ops=%d elements=%zu calls=%d interval=%dms spin=%dus cpus=%u\n",
+        threads, ops, elements, calls, interval_ms, spin_us, std::thread::hardware_concurrency());
+    printf("%-14s %10s %10s %10s %9s %9s\n", "mode", "p50_us", "p99_us", "max_us", "cpu_s", "cpu/wall");
+
+    measure("spawn", calls, interval_ms, [&] { compute_spawn(graph, threads); });
+    {
+        ThreadPool pool(graph, threads, 0);
+        measure("pool-passive", calls, interval_ms, [&] { pool.compute(); });
+    }
+    {
+        ThreadPool pool(graph, threads, spin_us);
+        const std::string name = "pool-spin" + std::to_string(spin_us);
+        measure(name.c_str(), calls, interval_ms, [&] { pool.compute(); });
+    }
+#ifdef _OPENMP
+    measure("openmp", calls, interval_ms, [&] { compute_openmp(graph, threads); });
+#else
+    printf("%-14s (未以OpenMP构建)\n", "openmp");
+#endif
+    return 0;
+}
@@ -0,0 +1,414 @@
+// 端到端回放测试：把WAV文件按虚拟时钟逐包送入与stream相同的流水线
+// (环形缓冲 → 重采样 → VAD门控 → whisper_full → 输出事件)，
+// 以JSON输出每个窗口的推理耗时、实时率、采集到出字的延迟分位数、丢弃的音频和峰值内存。
+//
+// --speed 0 (默认) 为步进模式：每送入一个包都等待引擎处理完毕再推进虚拟时钟，
+// 窗口划分与输出完全确定，运行速度只受推理速度限制；
+// --speed x 按x倍实时速度送入（不等待引擎），用于测量在该负载下的延迟与丢弃。
+#include "whisper.h"
+#include "audio_source.h"
+#include "stream_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+struct InputStream {
+    std::string path;
+    std::vector<float> pcm;             // 原始采样率的单声道数据
+    int sample_rate = 0;
+    int packet_frames = 0;
+    std::vector<int64_t> push_ns;       // 每个包送入的时刻
+    int stream_id = -1;
+};
+
+// 一次推理或一次输出的记录
+struct WindowRecord {
+    int stream_id;
+    StreamEventType type;
+    uint64_t window_end;
+    double inference_ms;
+    double latency_ms;                  // 窗口最后一个样本送入到输出的时间，未输出文本时为-1
+    std::string text;
+};
+
+static std::vector<InputStream> g_inputs;
+static std::vector<WindowRecord> g_records;
+static std::mutex g_records_mutex;
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count();
+}
+
+// 读取整个WAV文件（保持原始采样率，由流水线自己重采样）
+static bool load_wav(const char* path, std::vector<float>& pcm, int* sample_rate) {
+    AudioSourceConfig config;
+    audio_source_default_config(&config);
+    config.type = AUDIO_SOURCE_WAV;
+    config.path = path;
+    config.pace = 0.0f;
+
+    void* source = audio_source_create(&config);
+    AudioFormat format;
+    if (!source || !audio_source_get_format(source, &format)) {
+        if (source) audio_source_destroy(source);
+        return false;
+    }
+
+    pcm.clear();
+    audio_source_set_callback(source, [](void* user_data, float* buffer, int frames) {
+        auto* out = static_cast<std::vector<float>*>(user_data);
+        out->insert(out->end(), buffer, buffer + frames);
+    }, &pcm);
+
+    if (!audio_source_start(source)) {
+        audio_source_destroy(source);
+        return false;
+    }
+    while (!audio_source_is_finished(source)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    audio_source_stop(source);
+    audio_source_destroy(source);
+
+    *sample_rate = (int)format.sample_rate;
+    return true;
+}
+
+static void event_callback(void*, const StreamEvent* event) {
+    const int64_t t_now = now_ns();
+
+    WindowRecord record;
+    record.stream_id = event->stream_id;
+    record.type = event->type;
+    record.window_end = event->window_end;
+    record.inference_ms = event->inference_ms;
+    record.latency_ms = -1.0;
+
+    for (int i = 0; i < event->n_segments; i++) {
+        record.text += event->segments[i].text;
+    }
+
+    // 采集到出字延迟：以窗口最后一个样本所在包的送入时刻为起点
+    if (event->type == STREAM_EVENT_SEGMENTS || event->type == STREAM_EVENT_COMMIT) {
+        const InputStream& input = g_inputs[event->stream_id];
+        const uint64_t pos_in = (event->window_end * input.sample_rate + WHISPER_SAMPLE_RATE - 1) / WHISPER_SAMPLE_RATE;
+        const size_t n_packets = input.push_ns.size();
+        const size_t packet = std::min(n_packets - 1, (size_t)(pos_in > 0 ? (pos_in - 1) / input.packet_frames : 0));
+        record.latency_ms = (t_now - input.push_ns[packet]) / 1e6;
+    }
+
+    std::lock_guard<std::mutex> lock(g_records_mutex);
+    g_records.push_back(std::move(record));
+}
+
+static long long peak_rss_kb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return (long long)(pmc.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// 进程累计CPU时间（用户态+内核态，秒），用于比较计算线程不同等待方式的开销
+static double process_cpu_s() {
+#ifdef _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time)) {
+        return 0.0;
+    }
+    const auto to_100ns = [](const FILETIME& t) { return ((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+    return (to_100ns(kernel_time) + to_100ns(user_time)) / 1e7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+static std::string json_escape(const std::string& text) {
+    std::string out;
+    for (const unsigned char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += (char)c;
+            }
+        }
+    }
+    return out;
+}
+
+// 分位数统计，输出为JSON对象
+static std::string json_percentiles(std::vector<double> values) {
+    if (values.empty()) {
+        return "{\"count\": 0}";
+    }
+    std::sort(values.begin(), values.end());
+    auto pct = [&](double p) { return values[std::min(values.size() - 1, (size_t)(p * values.size()))]; };
+    double sum = 0.0;
+    for (double v : values) sum += v;
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+        "{\"count\": %zu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+        values.size(), sum / values.size(), pct(0.50), pct(0.90), pct(0.99), values.back());
+    return buf;
+}
+
+// 引擎记录的各阶段延迟（直方图分位数，桶中点）
+static std::string json_stages(const StreamEngine& engine) {
+    std::string out = "{";
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram hist;
+        engine.stage_timings().snapshot((PipelineStage)i, &hist);
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+            "%s\"%s\": {\"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+            i > 0 ? ", " : "", pipeline_stage_name((PipelineStage)i), (unsigned long long)hist.count(), hist.mean_ms(),
+            hist.percentile_ms(0.50), hist.percentile_ms(0.90), hist.percentile_ms(0.99), hist.max_ms());
+        out += buf;
+    }
+    return out + "}";
+}
+
+static const char* event_type_name(StreamEventType type) {
+    switch (type) {
+    case STREAM_EVENT_SEGMENTS: return "segments";
+    case STREAM_EVENT_SILENCE: return "silence";
+    case STREAM_EVENT_ERROR: return "error";
+    case STREAM_EVENT_COMMIT: return "commit";
+    case STREAM_EVENT_PARTIAL: return "partial";
+    case STREAM_EVENT_OVERFLOW: return "overflow";
+    case STREAM_EVENT_DEADLINE: return "deadline";
+    case STREAM_EVENT_LANGUAGE: return "language";
+    }
+    return "unknown";
+}
+
+static void show_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [options] <model_path> <file.wav> [file.wav ...]\n", program);
+    fprintf(stderr, "  每个WAV文件作为一路流，共享同一份模型\n");
+    fprintf(stderr, "  -t,  --threads <n>       每次推理的线程数 (默认: 8)\n");
+    fprintf(stderr, "  -w,  --workers <n>       推理工作线程数 (默认: 1)\n");
+    fprintf(stderr, "  -l,  --language <lang>   输入语言 (默认: auto)\n");
+    fprintf(stderr, "  -sm, --step-ms <n>       音频步长(ms) (默认: 500)\n");
+    fprintf(stderr, "  -lm, --length-ms <n>     音频长度(ms) (默认: 5000)\n");
+    fprintf(stderr, "  -ac, --audio-ctx <n|auto> 编码器上下文帧数 (默认: 0)\n");
+    fprintf(stderr, "  -vt, --vad-thold <n>     VAD阈值, 0表示关闭 (默认: 0.6)\n");
+    fprintf(stderr, "  -la, --local-agreement   稳定前缀模式\n");
+    fprintf(stderr, "       --mel-frontend      流式增量计算mel\n");
+    fprintf(stderr, "       --speed <x>         虚拟时钟速度, x倍实时; 0为步进模式 (默认: 0)\n");
+    fprintf(stderr, "       --packet-ms <n>     每个采集包的时长(ms) (默认: 10)\n");
+    fprintf(stderr, "       --compute-wait <m>  计算线程等待方式 active|passive (默认: 运行时默认)\n");
+    fprintf(stderr, "       --spin-us <n>       计算线程休眠前的自旋时长(us) (默认: 运行时默认)\n");
+    fprintf(stderr, "  -o,  --output <file>     JSON输出文件 (默认: stdout)\n");
+}
+
+int main(int argc, char** argv) {
+    StreamParams params;
+    ComputeParams compute;
+    int workers = 1;
+    double speed = 0.0;
+    int packet_ms = 10;
+    const char* output_path = nullptr;
+    std::vector<const char*> positional;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") { show_usage(argv[0]); return 0; }
+        else if ((arg == "-t" || arg == "--threads") && i + 1 < argc) params.threads = atoi(argv[++i]);
+        else if ((arg == "-w" || arg == "--workers") && i + 1 < argc) workers = atoi(argv[++i]);
+        else if ((arg == "-l" || arg == "--language") && i + 1 < argc) params.language = argv[++i];
+        else if ((arg == "-sm" || arg == "--step-ms") && i + 1 < argc) params.step_ms = atoi(argv[++i]);
+        else if ((arg == "-lm" || arg == "--length-ms") && i + 1 < argc) params.length_ms = atoi(argv[++i]);
+        else if ((arg == "-ac" || arg == "--audio-ctx") && i + 1 < argc) {
+            std::string value = argv[++i];
+            params.audio_ctx = value == "auto" ? -1 : atoi(value.c_str());
+        }
+        else if ((arg == "-vt" || arg == "--vad-thold") && i + 1 < argc) params.vad_thold = (float)atof(argv[++i]);
+        else if (arg == "-la" || arg == "--local-agreement") params.local_agreement = true;
+        else if (arg == "--mel-frontend") params.mel_frontend = true;
+        else if (arg == "--speed" && i + 1 < argc) speed = atof(argv[++i]);
+        else if (arg == "--packet-ms" && i + 1 < argc) packet_ms = std::max(1, atoi(argv[++i]));
+        else if (arg == "--compute-wait" && i + 1 < argc) {
+            std::string value = argv[++i];
+            compute.wait_policy = value == "active" ? COMPUTE_WAIT_ACTIVE : value == "passive" ? COMPUTE_WAIT_PASSIVE : COMPUTE_WAIT_DEFAULT;
+        }
+        else if (arg == "--spin-us" && i + 1 < argc) compute.spin_us = atoi(argv[++i]);
+        else if ((arg == "-o" || arg == "--output") && i + 1 < argc) output_path = argv[++i];
+        else positional.push_back(argv[i]);
+    }
+
+    if (positional.size() < 2) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    StreamEngine::configure_compute(compute);
+    StreamEngine engine;
+    whisper_context_params cparams = whisper_context_default_params();
+    if (!engine.load_model(positional[0], cparams)) {
+        fprintf(stderr, "Failed to load model: %s\n", positional[0]);
+        return 1;
+    }
+
+    // 读取所有输入，每个文件一路流
+    const bool lockstep = speed <= 0.0;
+    double audio_s = 0.0;
+    size_t max_packets = 0;
+    g_inputs.resize(positional.size() - 1);
+    for (size_t i = 1; i < positional.size(); i++) {
+        InputStream& input = g_inputs[i - 1];
+        input.path = positional[i];
+        if (!load_wav(positional[i], input.pcm, &input.sample_rate) || input.pcm.empty()) {
+            fprintf(stderr, "Failed to read WAV file: %s\n", positional[i]);
+            return 1;
+        }
+        input.packet_frames = std::max(1, input.sample_rate * packet_ms / 1000);
+        const size_t n_packets = (input.pcm.size() + input.packet_frames - 1) / input.packet_frames;
+        input.push_ns.assign(n_packets, 0);
+        max_packets = std::max(max_packets, n_packets);
+        audio_s += (double)input.pcm.size() / input.sample_rate;
+
+        input.stream_id = engine.add_stream(params, input.sample_rate, lockstep);
+        if (input.stream_id < 0) {
+            fprintf(stderr, "Failed to create whisper state\n");
+            return 1;
+        }
+    }
+
+    engine.set_event_callback(event_callback, nullptr);
+    engine.start(workers, true);
+
+    // 按虚拟时钟逐包送入，各路流同时开始
+    const auto t_start = bench_clock::now();
+    for (size_t k = 0; k < max_packets; k++) {
+        for (InputStream& input : g_inputs) {
+            const size_t begin = k * input.packet_frames;
+            if (begin >= input.pcm.size()) {
+                continue;
+            }
+            const size_t frames = std::min((size_t)input.packet_frames, input.pcm.size() - begin);
+            input.push_ns[k] = now_ns();
+            StreamEngine::audio_callback(engine.stream_input(input.stream_id), input.pcm.data() + begin, (int)frames);
+            if (begin + frames >= input.pcm.size()) {
+                engine.finish_stream(input.stream_id);
+            }
+        }
+
+        if (lockstep) {
+            engine.wait_idle();
+        } else {
+            std::this_thread::sleep_until(t_start + std::chrono::microseconds(
+                (int64_t)((k + 1) * packet_ms * 1000.0 / speed)));
+        }
+    }
+    engine.wait_finished();
+    engine.stop();
+    const double wall_s = std::chrono::duration<double>(bench_clock::now() - t_start).count();
+
+    // 汇总
+    std::vector<double> inference_ms, latency_ms;
+    double inference_total_ms = 0.0;
+    for (const WindowRecord& record : g_records) {
+        if (record.inference_ms > 0.0 && record.type != STREAM_EVENT_COMMIT) {
+            inference_ms.push_back(record.inference_ms);
+            inference_total_ms += record.inference_ms;
+        }
+        if (record.latency_ms >= 0.0) {
+            latency_ms.push_back(record.latency_ms);
+        }
+    }
+    uint64_t dropped = 0;
+    double dropped_s = 0.0;
+    for (const InputStream& input : g_inputs) {
+        const StreamStats st = engine.stats(input.stream_id);
+        dropped += st.dropped_samples;
+        dropped_s += (double)st.dropped_samples / input.sample_rate;
+    }
+
+    FILE* out = output_path ? fopen(output_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Failed to open output file: %s\n", output_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"model\": \"%s\",\n", json_escape(positional[0]).c_str());
+    fprintf(out, "  \"inputs\": [");
+    for (size_t i = 0; i < g_inputs.size(); i++) {
+        fprintf(out, "%s{\"path\": \"%s\", \"sample_rate\": %d, \"duration_s\": %.3f}", i > 0 ? ", " : "",
+            json_escape(g_inputs[i].path).c_str(), g_inputs[i].sample_rate,
+            (double)g_inputs[i].pcm.size() / g_inputs[i].sample_rate);
+    }
+    fprintf(out, "],\n");
+    fprintf(out, "  \"config\": {\"speed\": %.3f, \"lockstep\": %s, \"packet_ms\": %d, \"threads\": %d, \"workers\": %d, "
+        "\"step_ms\": %d, \"length_ms\": %d, \"audio_ctx\": %d, \"vad_thold\": %.3f, \"mel_frontend\": %s, \"local_agreement\": %s, "
+        "\"compute_wait\": \"%s\", \"spin_us\": %d, \"persistent_threads\": %s},\n",
+        speed, lockstep ? "true" : "false", packet_ms, params.threads, workers, params.step_ms, params.length_ms,
+        params.audio_ctx, params.vad_thold, params.mel_frontend ? "true" : "false", params.local_agreement ? "true" : "false",
+        compute.wait_policy == COMPUTE_WAIT_ACTIVE ? "active" : compute.wait_policy == COMPUTE_WAIT_PASSIVE ? "passive" : "default",
+        compute.spin_us, StreamEngine::compute_threads_persistent() ? "true" : "false");
+    fprintf(out, "  \"audio_s\": %.3f,\n", audio_s);
+    fprintf(out, "  \"wall_s\": %.3f,\n", wall_s);
+    fprintf(out, "  \"rtf\": %.4f,\n", audio_s > 0.0 ? inference_total_ms / 1000.0 / audio_s : 0.0);
+    fprintf(out, "  \"wall_rtf\": %.4f,\n", audio_s > 0.0 ? wall_s / audio_s : 0.0);
+    fprintf(out, "  \"inference_ms\": %s,\n", json_percentiles(inference_ms).c_str());
+    fprintf(out, "  \"latency_ms\": %s,\n", json_percentiles(latency_ms).c_str());
+    fprintf(out, "  \"stages_ms\": %s,\n", json_stages(engine).c_str());
+    fprintf(out, "  \"dropped_samples\": %llu,\n", (unsigned long long)dropped);
+    fprintf(out, "  \"dropped_s\": %.3f,\n", dropped_s);
+    fprintf(out, "  \"cpu_s\": %.3f,\n", process_cpu_s());
+    fprintf(out, "  \"peak_rss_kb\": %lld,\n", peak_rss_kb());
+    fprintf(out, "  \"windows\": [\n");
+    for (size_t i = 0; i < g_records.size(); i++) {
+        const WindowRecord& record = g_records[i];
+        fprintf(out, "    {\"stream\": %d, \"type\": \"%s\", \"end_ms\": %.1f, \"inference_ms\": %.3f, \"latency_ms\": %.3f, \"text\": \"%s\"}%s\n",
+            record.stream_id, event_type_name(record.type), record.window_end * 1000.0 / WHISPER_SAMPLE_RATE,
+            record.inference_ms, record.latency_ms, json_escape(record.text).c_str(),
+            i + 1 < g_records.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    fprintf(stderr, "audio %.1f s, wall %.2f s, rtf %.3f, windows %zu, dropped %llu samples\n",
+        audio_s, wall_s, audio_s > 0.0 ? inference_total_ms / 1000.0 / audio_s : 0.0,
+        inference_ms.size(), (unsigned long long)dropped);
+    return 0;
+}
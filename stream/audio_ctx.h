@@ -0,0 +1,21 @@
+#ifndef AUDIO_CTX_H
+#define AUDIO_CTX_H
+
+#include <algorithm>
+#include <cmath>
+
+// 编码器每帧对应20ms音频（mel帧移10ms，卷积步长2），30秒对应1500帧
+constexpr int AUDIO_CTX_MS_PER_FRAME = 20;
+
+// 按实际窗口长度推导whisper_full_params.audio_ctx
+// margin为安全余量比例；结果向上取整到granularity的倍数（便于编码器内核对齐），
+// 且不小于min_ctx、不大于模型的n_audio_ctx
+inline int adaptive_audio_ctx(int window_ms, int model_n_audio_ctx,
+                              float margin = 0.1f, int granularity = 64, int min_ctx = 128) {
+    int ctx = (int)std::ceil(window_ms * (1.0f + margin) / AUDIO_CTX_MS_PER_FRAME);
+    ctx = (ctx + granularity - 1) / granularity * granularity;
+    ctx = std::max(ctx, min_ctx);
+    return std::min(ctx, model_n_audio_ctx);
+}
+
+#endif // AUDIO_CTX_H
@@ -0,0 +1,106 @@
+#include "fft.h"
+#include <cmath>
+
+void Fft::init(int n) {
+    n_ = n;
+    factors_.clear();
+    twiddles_.clear();
+    if (n <= 0) return;
+
+    twiddles_.resize(n);
+    for (int i = 0; i < n; i++) {
+        const double phase = -2.0 * 3.14159265358979323846 * i / n;
+        twiddles_[i] = std::complex<float>((float)std::cos(phase), (float)std::sin(phase));
+    }
+
+    // 优先分解出4，其次2、3、5，最后是其它质因子
+    int p = 4;
+    int m = n;
+    while (m > 1) {
+        while (m % p != 0) {
+            switch (p) {
+            case 4: p = 2; break;
+            case 2: p = 3; break;
+            default: p += 2; break;
+            }
+            if (p * p > m) p = m;
+        }
+        m /= p;
+        factors_.push_back(p);
+        factors_.push_back(m);
+    }
+
+    int max_radix = 1;
+    for (size_t i = 0; i < factors_.size(); i += 2) {
+        max_radix = std::max(max_radix, factors_[i]);
+    }
+    scratch_.resize(max_radix);
+    cin_.resize(n);
+    cout_.resize(n);
+}
+
+void Fft::forward(const std::complex<float>* in, std::complex<float>* out) {
+    if (n_ == 1) {
+        out[0] = in[0];
+        return;
+    }
+    work(out, in, 1, factors_.data());
+}
+
+void Fft::forward_real(const float* in, std::complex<float>* out) {
+    for (int i = 0; i < n_; i++) {
+        cin_[i] = std::complex<float>(in[i], 0.0f);
+    }
+    forward(cin_.data(), cout_.data());
+    for (int i = 0; i <= n_ / 2; i++) {
+        out[i] = cout_[i];
+    }
+}
+
+// 递归按时间抽取：先对p个子序列做长度m的变换，再做基p蝶形
+void Fft::work(std::complex<float>* out, const std::complex<float>* in, int fstride, const int* factors) {
+    const int p = factors[0];
+    const int m = factors[1];
+    std::complex<float>* out_begin = out;
+    const std::complex<float>* out_end = out + p * m;
+
+    if (m == 1) {
+        for (; out != out_end; out++, in += fstride) {
+            *out = *in;
+        }
+    } else {
+        for (; out != out_end; out += m, in += fstride) {
+            work(out, in, fstride * p, factors + 2);
+        }
+    }
+
+    butterfly(out_begin, fstride, m, p);
+}
+
+void Fft::butterfly(std::complex<float>* out, int fstride, int m, int p) {
+    if (p == 2) {
+        for (int k = 0; k < m; k++) {
+            const std::complex<float> t = out[k + m] * twiddles_[k * fstride];
+            out[k + m] = out[k] - t;
+            out[k] += t;
+        }
+        return;
+    }
+
+    // 通用基p蝶形
+    for (int u = 0; u < m; u++) {
+        for (int q1 = 0, k = u; q1 < p; q1++, k += m) {
+            scratch_[q1] = out[k];
+        }
+        for (int q1 = 0, k = u; q1 < p; q1++, k += m) {
+            int twidx = 0;
+            std::complex<float> sum = scratch_[0];
+            for (int q = 1; q < p; q++) {
+                twidx += fstride * k;
+                if (twidx >= n_) twidx -= n_;
+                sum += scratch_[q] * twiddles_[twidx];
+            }
+            out[k] = sum;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// 任意长度的混合基FFT（按2/3/4/5及其它质因子分解），
+// 用于VAD的频谱特征和log-mel前端（whisper的n_fft=400不是2的幂）
+class Fft {
+public:
+    explicit Fft(int n = 0) { init(n); }
+
+    void init(int n);
+    int size() const { return n_; }
+
+    // 复数正变换，in与out不能重叠
+    void forward(const std::complex<float>* in, std::complex<float>* out);
+
+    // 实数输入正变换，输出前n/2+1个频点
+    void forward_real(const float* in, std::complex<float>* out);
+
+private:
+    void work(std::complex<float>* out, const std::complex<float>* in, int fstride, const int* factors);
+    void butterfly(std::complex<float>* out, int fstride, int m, int p);
+
+    int n_ = 0;
+    std::vector<int> factors_;                  // (p, m)对：当前基p与剩余长度m
+    std::vector<std::complex<float>> twiddles_;
+    std::vector<std::complex<float>> scratch_;
+    std::vector<std::complex<float>> cin_;
+    std::vector<std::complex<float>> cout_;
+};
+
+#endif // FFT_H
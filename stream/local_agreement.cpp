@@ -0,0 +1,102 @@
+#include "local_agreement.h"
+#include <algorithm>
+
+namespace {
+
+// 保留的已提交token历史（whisper的文本上下文为448，prompt最多使用一半）
+constexpr size_t HISTORY_TOKENS = 224;
+
+// 新假设开头与已提交末尾最多比较的n-gram长度
+constexpr size_t MAX_NGRAM = 5;
+
+// 新假设开头距已提交末尾在1秒以内时才做去重
+constexpr uint64_t DEDUP_RANGE = 16000;
+
+// tokens[0, n)拼接后的文本末尾是否停在UTF-8字符中间；只需看最后最多4个字节
+bool ends_mid_character(const std::vector<AgreementToken>& tokens, size_t n) {
+    char tail[4];
+    size_t len = 0;
+    for (size_t i = n; i > 0 && len < sizeof(tail); i--) {
+        const std::string& text = tokens[i - 1].text;
+        for (size_t j = text.size(); j > 0 && len < sizeof(tail); j--) {
+            tail[sizeof(tail) - 1 - len++] = text[j - 1];
+        }
+    }
+    return utf8_incomplete_tail(tail + sizeof(tail) - len, len) > 0;
+}
+
+} // namespace
+
+size_t utf8_incomplete_tail(const char* text, size_t len) {
+    // 从末尾向前找最近的首字节，最多看3个后续字节
+    for (size_t n = 1; n <= std::min<size_t>(len, 4); n++) {
+        const unsigned char c = (unsigned char)text[len - n];
+        if ((c & 0xC0) == 0x80) {
+            continue;   // 后续字节
+        }
+        const size_t need = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+        return need > n ? n : 0;
+    }
+    return 0;   // 没有首字节：不是合法的UTF-8，不再等待
+}
+
+void LocalAgreement::reset() {
+    pending_.clear();
+    history_.clear();
+    committed_end_ = 0;
+}
+
+void LocalAgreement::commit(const AgreementToken& token, std::vector<AgreementToken>& committed) {
+    committed.push_back(token);
+    history_.push_back(token.id);
+    committed_end_ = std::max(committed_end_, token.t1);
+}
+
+void LocalAgreement::insert(std::vector<AgreementToken>&& hyp, std::vector<AgreementToken>& committed) {
+    // 窗口从已提交位置之前开始时，模型可能重复输出已提交的末尾几个token，按n-gram去掉
+    if (!hyp.empty() && hyp.front().t0 < committed_end_ + DEDUP_RANGE) {
+        const size_t max_n = std::min({ MAX_NGRAM, history_.size(), hyp.size() });
+        for (size_t n = max_n; n > 0; n--) {
+            if (std::equal(history_.end() - n, history_.end(), hyp.begin(),
+                    [](whisper_token a, const AgreementToken& b) { return a == b.id; })) {
+                hyp.erase(hyp.begin(), hyp.begin() + n);
+                break;
+            }
+        }
+    }
+
+    // 与上一次假设的最长公共前缀视为稳定（使用新假设的时间戳），退回到完整的UTF-8字符边界
+    size_t n_agree = 0;
+    while (n_agree < pending_.size() && n_agree < hyp.size() && pending_[n_agree].id == hyp[n_agree].id) {
+        n_agree++;
+    }
+    while (n_agree > 0 && ends_mid_character(hyp, n_agree)) {
+        n_agree--;
+    }
+    for (size_t i = 0; i < n_agree; i++) {
+        commit(hyp[i], committed);
+    }
+
+    hyp.erase(hyp.begin(), hyp.begin() + n_agree);
+    pending_ = std::move(hyp);
+
+    if (history_.size() > HISTORY_TOKENS) {
+        history_.erase(history_.begin(), history_.end() - HISTORY_TOKENS);
+    }
+}
+
+void LocalAgreement::flush(std::vector<AgreementToken>& committed) {
+    for (const AgreementToken& token : pending_) {
+        commit(token, committed);
+    }
+    pending_.clear();
+
+    if (history_.size() > HISTORY_TOKENS) {
+        history_.erase(history_.begin(), history_.end() - HISTORY_TOKENS);
+    }
+}
+
+void LocalAgreement::prompt(std::vector<whisper_token>& out, size_t max_tokens) const {
+    const size_t n = std::min(max_tokens, history_.size());
+    out.assign(history_.end() - n, history_.end());
+}
@@ -0,0 +1,52 @@
+#ifndef LOCAL_AGREEMENT_H
+#define LOCAL_AGREEMENT_H
+
+#include "whisper.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 假设中的一个token
+struct AgreementToken {
+    whisper_token id;
+    std::string text;
+    uint64_t t0;    // 绝对样本位置(16kHz)
+    uint64_t t1;
+};
+
+// text末尾未完整的UTF-8多字节序列的字节数（whisper的字节级BPE可能把一个汉字拆成几个token）；
+// 末尾完整时返回0
+size_t utf8_incomplete_tail(const char* text, size_t len);
+
+// LocalAgreement-2流式稳定化：相邻两次推理结果的最长公共前缀视为稳定并提交，
+// 其余部分作为未稳定的尾部等待下一次推理确认。提交总是停在完整的UTF-8字符之后，
+// 被拆开的字符的前几个字节token留在未稳定部分，直到整个字符都得到确认。
+// 已提交的token作为下一次推理的prompt，对应音频可从窗口中裁掉，每步只需解码未稳定的部分。
+class LocalAgreement {
+public:
+    void reset();
+
+    // 插入新一次推理的假设（按时间顺序），新提交的token追加到committed
+    void insert(std::vector<AgreementToken>&& hyp, std::vector<AgreementToken>& committed);
+
+    // 强制提交尚未稳定的全部token（静音、窗口已满、输入结束时），不再等待字符补全
+    void flush(std::vector<AgreementToken>& committed);
+
+    // 最近提交的最多max_tokens个token，用作prompt_tokens
+    void prompt(std::vector<whisper_token>& out, size_t max_tokens) const;
+
+    // 已提交部分的结束位置，窗口可从这里开始；没有提交过时返回0
+    uint64_t committed_end() const { return committed_end_; }
+
+    const std::vector<AgreementToken>& pending() const { return pending_; }
+
+private:
+    void commit(const AgreementToken& token, std::vector<AgreementToken>& committed);
+
+    std::vector<AgreementToken> pending_;       // 上一次假设中尚未稳定的部分
+    std::vector<whisper_token> history_;        // 最近提交的token，用于prompt和去重
+    uint64_t committed_end_ = 0;
+};
+
+#endif // LOCAL_AGREEMENT_H
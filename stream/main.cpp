@@ -1,15 +1,34 @@
 #include "whisper.h"
+#include "stream_engine.h"
+#include "audio_ctx.h"
+#include "thread_placement.h"
+#include "metrics_exporter.h"
+#include "trace_recorder.h"
+#include "transcript_sink.h"
+#include "../audio_capture/audio_source.h"
+#ifdef _WIN32
 #include "../audio_capture/windows/wasapi_capture.h"
+#endif
 #include <iostream>
 #include <string>
 #include <thread>
 #include <vector>
 #include <atomic>
-#include <mutex>
-#include <queue>
 #include <map>
+#include <deque>
+#include <sstream>
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
+#include <csignal>
+#include <clocale>
+#include <algorithm>
 #include <fcntl.h>
+#ifdef _WIN32
 #include <io.h>
+#endif
 
 // 设置控制台UTF-8输出
 void set_console_utf8() {
@@ -27,16 +46,40 @@ void set_console_utf8() {
     // 设置标准输出为UTF-8
     _setmode(_fileno(stdout), _O_U8TEXT);
     _setmode(_fileno(stderr), _O_U8TEXT);
+#else
+    // wprintf按当前locale编码输出，确保使用UTF-8
+    const char* locale = setlocale(LC_ALL, "");
+    if (!locale || !strstr(locale, "UTF-8")) {
+        setlocale(LC_ALL, "C.UTF-8");
+    }
 #endif
 }
 
-// 音频缓冲队列
-struct AudioBuffer {
-    std::mutex mtx;
-    std::queue<std::vector<float>> queue;
-    static const int MAX_SIZE = 100;  // 最大缓冲数量
-    int sample_rate = 48000;          // 默认采样率，将在初始化时更新
-};
+// UTF-8字符串转换为宽字符
+std::wstring to_wide(const char* text) {
+#ifdef _WIN32
+    int len = MultiByteToWideChar(CP_UTF8, 0, text, -1, NULL, 0);
+    std::wstring wtext(len > 0 ? len - 1 : 0, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text, -1, &wtext[0], len);
+    return wtext;
+#else
+    std::wstring wtext;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text);
+    while (*p) {
+        uint32_t cp = *p;
+        int extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+        if (extra > 0) {
+            cp &= 0x3F >> extra;
+        }
+        p++;
+        for (; extra > 0 && (*p & 0xC0) == 0x80; extra--, p++) {
+            cp = (cp << 6) | (*p & 0x3F);
+        }
+        wtext.push_back((wchar_t)cp);
+    }
+    return wtext;
+#endif
+}
 
 // whisper参数结构体
 struct WhisperParams {
@@ -51,6 +94,42 @@ struct WhisperParams {
     bool print_special = false;       // 是否打印特殊标记
     int step_ms = 500;               // 音频步长(ms)
     int length_ms = 5000;            // 音频长度(ms)
+    bool event_driven = true;        // 事件驱动唤醒(false时每10ms轮询)
+    int audio_ctx = 0;               // 编码器上下文帧数：0为模型默认(30秒)，-1为按窗口长度自适应
+    float audio_ctx_margin = 0.1f;   // 自适应audio_ctx的安全余量
+    bool mel_frontend = false;       // 流式计算log-mel并通过whisper_set_mel送入(false时由whisper_full对整个窗口重算)
+    int workers = 1;                 // 推理工作线程数（多路流共享）
+    bool local_agreement = false;    // 稳定前缀模式：只输出相邻两次推理一致的文本
+    OverflowPolicy overflow = OVERFLOW_DROP_NEWEST;  // 推理跟不上时的积压处理策略
+    int max_backlog_ms = 1000;       // 允许积压的音频时长(ms)
+    int deadline_ms = 0;             // 每次推理的时间预算(ms)：0为不限，-1为按步长和积压自动计算
+    bool partial_fallback = true;    // 稳定前缀模式下非最终结果也做温度回退
+    bool deadline_retry = false;     // 超时后有余量时放宽设置重试
+    int lang_detect_ms = 0;          // 自动语言：累计这么多语音后检测并锁定(ms)，0为每个窗口重新检测
+    int lang_recheck_ms = 30000;     // 锁定后重新检测的间隔(ms)
+    ComputeWaitPolicy compute_wait = COMPUTE_WAIT_DEFAULT;  // 计算线程在两次并行计算之间的等待方式
+    int spin_us = -1;                // 计算线程休眠前的自旋时长(us)，-1为运行时默认
+    bool pin_threads = false;        // 按CPU拓扑固定采集线程与推理线程
+    bool realtime_capture = false;   // 采集线程使用实时优先级（MMCSS / SCHED_FIFO）
+    int metrics_port = 0;            // 监控指标的HTTP端口（只监听127.0.0.1），0为不开启
+    std::string metrics_file;        // 定期重写的监控指标文件，空为不写
+    int metrics_interval_ms = 1000;  // 重写指标文件的间隔(ms)
+    std::string trace_path;          // 退出时写入Chrome trace-event JSON，空为不记录
+    TranscriptFormat output_format = TRANSCRIPT_CONSOLE;  // 识别文本的输出格式
+    std::string output_path;         // 识别文本的输出文件，空为标准输出
+    int flush_ms = 50;               // 识别文本合并写出的间隔(ms)
+};
+
+// 输出格式名
+const std::map<std::string, TranscriptFormat> OUTPUT_FORMATS = {
+    {"console", TRANSCRIPT_CONSOLE}, {"jsonl", TRANSCRIPT_JSONL},
+    {"srt", TRANSCRIPT_SRT}, {"vtt", TRANSCRIPT_VTT}
+};
+
+// 积压处理策略名
+const std::map<std::string, OverflowPolicy> OVERFLOW_POLICIES = {
+    {"drop-newest", OVERFLOW_DROP_NEWEST}, {"drop-oldest", OVERFLOW_DROP_OLDEST},
+    {"skip-to-live", OVERFLOW_SKIP_TO_LIVE}, {"spill", OVERFLOW_SPILL_TO_DISK}
 };
 
 // 语言代码映射
@@ -61,22 +140,48 @@ const std::map<std::string, std::string> LANGUAGE_CODES = {
 };
 
 // 全局变量
-AudioBuffer g_audio_buffer;
 std::atomic<bool> g_is_running{true};
 WhisperParams g_params;
+std::mutex g_output_mutex;          // 多路流的结果可能在不同工作线程上同时输出
+int g_stream_count = 1;
+TranscriptSink g_sink;              // 识别文本由输出线程写出，事件回调只入队
+
+std::atomic<bool> g_dump_stages{false};
+
+// Ctrl+C：停止处理并输出统计
+static void signal_handler(int) {
+    g_is_running = false;
+}
+
+// SIGUSR1（Windows: Ctrl+Break）：输出当前的各阶段延迟，不停止处理
+static void dump_signal_handler(int) {
+    g_dump_stages = true;
+}
 
 // 显示帮助信息
 void show_usage(const char* program) {
     // 转换程序名为宽字符
-    int len = MultiByteToWideChar(CP_UTF8, 0, program, -1, NULL, 0);
-    std::vector<wchar_t> wprogram(len);
-    MultiByteToWideChar(CP_UTF8, 0, program, -1, wprogram.data(), len);
+    std::wstring wprogram = to_wide(program);
 
-    fwprintf(stderr, L"Usage: %ls [options] <model_path>\n", wprogram.data());
+    fwprintf(stderr, L"Usage: %ls [options] <model_path>\n", wprogram.c_str());
     fwprintf(stderr, L"\n音频捕获选项:\n");
     fwprintf(stderr, L"  -h,  --help                显示帮助信息\n");
     fwprintf(stderr, L"  -l,  --list                列出可用的音频程序\n");
     fwprintf(stderr, L"  -p,  --pid <pid>           捕获指定PID的程序音频\n");
+    fwprintf(stderr, L"\n音频源选项:\n");
+    fwprintf(stderr, L"  -i,  --input <file.wav>    从WAV文件读取音频\n");
+    fwprintf(stderr, L"       --pcm <path|->        从命名管道或stdin(-)读取原始PCM\n");
+    fwprintf(stderr, L"       --pcm-rate <hz>       原始PCM采样率 (默认: 16000)\n");
+    fwprintf(stderr, L"       --pcm-channels <n>    原始PCM声道数 (默认: 1)\n");
+    fwprintf(stderr, L"       --pcm-format <fmt>    原始PCM格式 s16|f32 (默认: s16)\n");
+    fwprintf(stderr, L"       --synth <signal>      合成信号 sine|noise|silence|bursts\n");
+    fwprintf(stderr, L"       --duration <s>        合成信号时长(秒) (默认: 无限)\n");
+    fwprintf(stderr, L"       --pace <x>            投递速度, 1=实时, 0=尽可能快 (默认: 1)\n");
+    fwprintf(stderr, L"       --gap-every <s>       合成信号每隔s秒模拟一次数据丢失 (默认: 0, 不丢失)\n");
+    fwprintf(stderr, L"       --gap-ms <n>          每次模拟丢失的时长(ms) (默认: 200)\n");
+    fwprintf(stderr, L"       --channel-weights <w0,w1,...> 系统/程序音频下混为单声道时各声道的权重 (默认: 平均)\n");
+    fwprintf(stderr, L"  每个 -i/--pcm/--synth/-p 添加一路音频流，共享同一份模型；\n");
+    fwprintf(stderr, L"  音频源选项作用于前面最近的音频源，写在所有音频源之前时作为默认值\n");
     fwprintf(stderr, L"\nWhisper选项:\n");
     fwprintf(stderr, L"  -t,  --threads <n>         使用的线程数 (默认: 8)\n");
     fwprintf(stderr, L"  -mt, --max-tokens <n>      最大token数 (默认: 32)\n");
@@ -86,25 +191,47 @@ void show_usage(const char* program) {
     fwprintf(stderr, L"  -tt, --translate-to <lang> 翻译目标语言 (默认: en)\n");
     fwprintf(stderr, L"  -ts, --timestamps          显示时间戳\n");
     fwprintf(stderr, L"  -ps, --print-special       显示特殊标记\n");
-    fwprintf(stderr, L"  -vt, --vad-thold <n>       VAD阈值 [0-1] (默认: 0.6)\n");
+    fwprintf(stderr, L"  -vt, --vad-thold <n>       VAD阈值 [0-1], 0表示关闭 (默认: 0.6)\n");
     fwprintf(stderr, L"  -sm, --step-ms <n>         音频步长(ms) (默认: 500)\n");
     fwprintf(stderr, L"  -lm, --length-ms <n>       音频长度(ms) (默认: 5000)\n");
+    fwprintf(stderr, L"  -ac, --audio-ctx <n|auto>  编码器上下文帧数, auto按窗口长度自适应 (默认: 0, 即30秒)\n");
+    fwprintf(stderr, L"       --audio-ctx-margin <x> 自适应audio_ctx的安全余量比例 (默认: 0.1)\n");
+    fwprintf(stderr, L"  -w,  --workers <n>         推理工作线程数, 多路流共享 (默认: 1)\n");
+    fwprintf(stderr, L"  -la, --local-agreement     稳定前缀模式: 每个步长只解码未提交的音频, 只输出已稳定的文本\n");
+    fwprintf(stderr, L"       --overflow <policy>   推理跟不上时的积压处理: drop-newest, drop-oldest, skip-to-live, spill (默认: drop-newest)\n");
+    fwprintf(stderr, L"       --max-backlog-ms <n>  允许积压的音频时长(ms), 超过后按--overflow处理 (默认: 1000)\n");
+    fwprintf(stderr, L"       --lang-detect-ms <n>  自动语言时累计n ms语音后检测一次并锁定, 之后不再每个窗口检测 (默认: 0)\n");
+    fwprintf(stderr, L"       --lang-recheck-ms <n> 锁定语言后重新检测的间隔, 0为不定期检测 (默认: 30000)\n");
+    fwprintf(stderr, L"       --deadline-ms <n|auto> 每次推理的时间预算, 超时中止该窗口; auto为步长减去当前积压 (默认: 0, 不限)\n");
+    fwprintf(stderr, L"       --deadline-retry      超时后仍有余量时以贪心解码和自适应audio_ctx重试一次\n");
+    fwprintf(stderr, L"       --no-partial-fallback 稳定前缀模式下非最终结果不做温度回退\n");
+    fwprintf(stderr, L"       --compute-wait <mode> 计算线程在两次并行计算之间的等待方式: active(自旋), passive(休眠) (默认: 运行时默认)\n");
+    fwprintf(stderr, L"       --spin-us <n>         计算线程休眠前的自旋时长(us) (默认: 运行时默认)\n");
+    fwprintf(stderr, L"       --pin                 按CPU拓扑固定线程: 采集线程独占一个核, 推理线程分占其余物理核\n");
+    fwprintf(stderr, L"       --rt-capture          采集线程使用实时优先级 (Windows: MMCSS Pro Audio, Linux: SCHED_FIFO)\n");
+    fwprintf(stderr, L"       --metrics-port <n>    在127.0.0.1:n上以Prometheus格式提供监控指标 (GET /metrics)\n");
+    fwprintf(stderr, L"       --metrics-file <path> 定期以Prometheus格式重写监控指标文件\n");
+    fwprintf(stderr, L"       --metrics-interval-ms <n> 重写指标文件的间隔(ms) (默认: 1000)\n");
+    fwprintf(stderr, L"       --output <file|->     识别文本写入文件, -为标准输出 (默认: 标准输出)\n");
+    fwprintf(stderr, L"       --output-format <fmt> 识别文本格式: console, jsonl, srt, vtt (默认: console; srt, vtt 需要 -la)\n");
+    fwprintf(stderr, L"       --flush-ms <n>        识别文本合并写出的间隔(ms) (默认: 50)\n");
+    fwprintf(stderr, L"       --trace <file>        记录采集、推理各阶段的时间线, 退出时写入Chrome trace JSON (用Perfetto打开)\n");
+    fwprintf(stderr, L"       --mel-frontend        流式增量计算mel频谱, 代替whisper对每个窗口重新计算\n");
+    fwprintf(stderr, L"       --poll                轮询音频设备和缓冲而不是事件唤醒\n");
+    fwprintf(stderr, L"\n运行中输入 s 并回车，或发送SIGUSR1 (Windows: Ctrl+Break)，在标准错误输出当前各阶段延迟的分布\n");
     fwprintf(stderr, L"\n支持的语言:\n");
     
     for (const auto& lang : LANGUAGE_CODES) {
-        // 转换语言名称为宽字符
-        len = MultiByteToWideChar(CP_UTF8, 0, lang.second.c_str(), -1, NULL, 0);
-        std::vector<wchar_t> wlang(len);
-        MultiByteToWideChar(CP_UTF8, 0, lang.second.c_str(), -1, wlang.data(), len);
-        
-        fwprintf(stderr, L"  %-6hs : %ls\n", lang.first.c_str(), wlang.data());
+        fwprintf(stderr, L"  %-6ls : %ls\n", to_wide(lang.first.c_str()).c_str(), to_wide(lang.second.c_str()).c_str());
     }
     
     fwprintf(stderr, L"\nExample:\n");
-    fwprintf(stderr, L"  %ls --list                                    # 列出可用音频程序\n", wprogram.data());
-    fwprintf(stderr, L"  %ls models/ggml-base.bin                      # 捕获系统音频\n", wprogram.data());
-    fwprintf(stderr, L"  %ls -p 1234 --language en models/ggml-base.bin # 捕获PID为1234的英语音频\n", wprogram.data());
-    fwprintf(stderr, L"  %ls --translate --translate-to ja models/ggml-base.bin # 翻译成日语\n", wprogram.data());
+    fwprintf(stderr, L"  %ls --list                                    # 列出可用音频程序\n", wprogram.c_str());
+    fwprintf(stderr, L"  %ls models/ggml-base.bin                      # 捕获系统音频\n", wprogram.c_str());
+    fwprintf(stderr, L"  %ls -p 1234 --language en models/ggml-base.bin # 捕获PID为1234的英语音频\n", wprogram.c_str());
+    fwprintf(stderr, L"  %ls --translate --translate-to ja models/ggml-base.bin # 翻译成日语\n", wprogram.c_str());
+    fwprintf(stderr, L"  %ls -i talk.wav --pace 0 models/ggml-base.bin  # 尽可能快地转写WAV文件\n", wprogram.c_str());
+    fwprintf(stderr, L"  %ls --pace 0 -i a.wav -i b.wav -w 2 models/ggml-base.bin # 两路流共享模型\n", wprogram.c_str());
 }
 
 // 验证语言代码
@@ -112,6 +239,7 @@ bool is_valid_language(const std::string& lang) {
     return LANGUAGE_CODES.find(lang) != LANGUAGE_CODES.end();
 }
 
+#ifdef _WIN32
 // 列出可用的音频程序
 void list_audio_applications(void* capture) {
     const int MAX_APPS = 100;
@@ -134,145 +262,122 @@ void list_audio_applications(void* capture) {
     }
     wprintf(L"----------------------------------------\n");
 }
+#endif
 
-// 音频回调函数 - 使用static避免命名冲突
-static void audio_data_callback(void* user_data, float* buffer, int frames) {
-    auto& audio_buffer = *static_cast<AudioBuffer*>(user_data);
-    std::vector<float> frame_data(buffer, buffer + frames);
-    
-    std::lock_guard<std::mutex> lock(audio_buffer.mtx);
-    if (audio_buffer.queue.size() < AudioBuffer::MAX_SIZE) {
-        audio_buffer.queue.push(std::move(frame_data));
+// 引擎事件回调（可能在任意工作线程上调用）：识别文本交给输出线程，只有错误与告警直接输出
+static void stream_event_callback_fn(void*, const StreamEvent* event) {
+    switch (event->type) {
+    case STREAM_EVENT_ERROR:
+    case STREAM_EVENT_OVERFLOW:
+    case STREAM_EVENT_DEADLINE:
+        break;
+    default:
+        g_sink.push(*event);
+        return;
     }
-}
-
-// whisper处理线程
-void whisper_processing_thread(struct whisper_context* ctx) {
-    // whisper参数设置
-    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-    wparams.print_progress = false;
-    wparams.print_special = g_params.print_special;
-    wparams.print_realtime = true;
-    wparams.print_timestamps = !g_params.no_timestamps;
-    wparams.translate = g_params.translate;
-    wparams.language = g_params.language.c_str();
-    wparams.n_threads = g_params.threads;
-    wparams.max_tokens = g_params.max_tokens;
-    wparams.single_segment = true;
-    wparams.no_context = true;
-    wparams.duration_ms = g_params.length_ms;
-
-    // 如果指定了翻译目标语言
-    if (!g_params.translate_to.empty()) {
-        wparams.translate = true;
-        wparams.language = g_params.translate_to.c_str();
-    }
-
-    std::vector<float> audio_data;
-    std::vector<float> processed_data;  // 用于重采样后的数据
-    const int n_samples_step = g_audio_buffer.sample_rate * g_params.step_ms / 1000;
-    const int n_samples_len = g_audio_buffer.sample_rate * g_params.length_ms / 1000;
-    audio_data.reserve(n_samples_len);
-
-    // 添加调试信息
-    wprintf(L"音频配置:\n");
-    wprintf(L"采样率: %d Hz\n", g_audio_buffer.sample_rate);
-    wprintf(L"步长样本数: %d\n", n_samples_step);
-    wprintf(L"长度样本数: %d\n", n_samples_len);
-
-    while (g_is_running) {
-        {
-            std::lock_guard<std::mutex> lock(g_audio_buffer.mtx);
-            while (!g_audio_buffer.queue.empty()) {
-                auto& chunk = g_audio_buffer.queue.front();
-                audio_data.insert(audio_data.end(), chunk.begin(), chunk.end());
-                g_audio_buffer.queue.pop();
-            }
-        }
 
-        // 当累积足够的音频数据时进行处理
-        if (audio_data.size() >= n_samples_len) {
-            // 检查音频数据是否有效
-            bool is_valid = false;
-            float max_abs = 0.0f;
-            for (float sample : audio_data) {
-                max_abs = std::max(max_abs, std::abs(sample));
-                if (max_abs > 0.01f) {  // 检查是否有有效的音频信号
-                    is_valid = true;
-                    break;
-                }
-            }
+    std::lock_guard<std::mutex> lock(g_output_mutex);
 
-            if (!is_valid) {
-                wprintf(L"跳过静音音频段\n");
-                audio_data.clear();
-                audio_data.reserve(n_samples_len);
-                continue;
-            }
+    // 多路流时在每行前标注流ID
+    wchar_t prefix[16] = L"";
+    if (g_stream_count > 1) {
+        swprintf(prefix, 16, L"[%d] ", event->stream_id);
+    }
 
-            // 重采样到16kHz
-            processed_data.resize(audio_data.size() * WHISPER_SAMPLE_RATE / g_audio_buffer.sample_rate);
-            for (size_t i = 0; i < processed_data.size(); i++) {
-                float src_idx = i * g_audio_buffer.sample_rate / (float)WHISPER_SAMPLE_RATE;
-                size_t src_idx_floor = (size_t)src_idx;
-                float t = src_idx - src_idx_floor;
-                
-                if (src_idx_floor >= audio_data.size() - 1) {
-                    processed_data[i] = audio_data.back();
-                } else {
-                    processed_data[i] = audio_data[src_idx_floor] * (1 - t) + 
-                                      audio_data[src_idx_floor + 1] * t;
-                }
-            }
+    switch (event->type) {
+    case STREAM_EVENT_ERROR:
+        fwprintf(stderr, L"%lsFailed to process audio (samples: %zu, vad score: %.2f)\n",
+            prefix, event->n_samples, event->vad_score);
+        break;
+    case STREAM_EVENT_OVERFLOW:
+        fwprintf(stderr, L"%ls推理跟不上实时, 丢弃 %.2f s 音频\n", prefix, (double)event->n_samples / WHISPER_SAMPLE_RATE);
+        break;
+    case STREAM_EVENT_DEADLINE:
+        fwprintf(stderr, L"%ls推理超出时间预算 (%.0f ms), 放弃该窗口\n", prefix, event->inference_ms);
+        break;
+    default:
+        break;
+    }
+}
 
-            // 处理音频
-            if (whisper_full(ctx, wparams, processed_data.data(), processed_data.size()) != 0) {
-                fwprintf(stderr, L"Failed to process audio (samples: %zu, max amplitude: %.3f)\n", 
-                    processed_data.size(), max_abs);
-                continue;
-            }
+// 输出延迟分布
+static void print_latency(const wchar_t* label, const LatencyHistogram& lat) {
+    if (lat.count() == 0) return;
+    wprintf(L"%ls: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+        label, lat.percentile_ms(0.50), lat.percentile_ms(0.90), lat.percentile_ms(0.99), lat.max_ms());
+}
 
-            // 输出识别结果
-            const int n_segments = whisper_full_n_segments(ctx);
-            if (n_segments > 0) {
-                for (int i = 0; i < n_segments; ++i) {
-                    const char* text = whisper_full_get_segment_text(ctx, i);
-                    if (text == nullptr || strlen(text) == 0) {
-                        continue;
-                    }
-                    
-                    // 将UTF-8文本转换为宽字符
-                    int len = MultiByteToWideChar(CP_UTF8, 0, text, -1, NULL, 0);
-                    std::vector<wchar_t> wtext(len);
-                    MultiByteToWideChar(CP_UTF8, 0, text, -1, wtext.data(), len);
-
-                    if (g_params.no_timestamps) {
-                        wprintf(L"%ls", wtext.data());
-                    } else {
-                        const int64_t t0 = whisper_full_get_segment_t0(ctx, i);
-                        const int64_t t1 = whisper_full_get_segment_t1(ctx, i);
-                        wprintf(L"[%d:%02d.%03d -> %d:%02d.%03d] %ls\n",
-                            (int)(t0 / 60000), (int)((t0 / 1000) % 60), (int)(t0 % 1000),
-                            (int)(t1 / 60000), (int)((t1 / 1000) % 60), (int)(t1 % 1000),
-                            wtext.data());
-                    }
-                    fflush(stdout);
-                }
-                wprintf(L"\n");
-            }
+// 输出一路流的吞吐统计
+static void print_stream_stats(int stream_id, const StreamStats& st) {
+    const double audio_s = st.sample_rate > 0 ? (double)st.samples_in / st.sample_rate : 0.0;
+    if (g_stream_count > 1) {
+        wprintf(L"\n处理统计 [%d]:\n", stream_id);
+    } else {
+        wprintf(L"\n处理统计:\n");
+    }
+    wprintf(L"音频时长: %.1f s, 耗时: %.1f s, 速度: %.2fx 实时\n",
+        audio_s, st.wall_s, st.wall_s > 0.0 ? audio_s / st.wall_s : 0.0);
+    wprintf(L"whisper调用: %d 次, 平均推理: %.1f ms\n",
+        st.n_inferences, st.n_inferences > 0 ? st.inference_ms / st.n_inferences : 0.0);
+    wprintf(L"丢弃样本: %llu\n", (unsigned long long)st.dropped_samples);
+    if (st.discarded_samples > 0) {
+        wprintf(L"丢弃积压: %.2f s (跳过 %llu 次)\n", st.sample_rate > 0 ? (double)st.discarded_samples / st.sample_rate : 0.0,
+            (unsigned long long)st.n_skips);
+    }
+    if (st.spilled_samples > 0) {
+        wprintf(L"写入临时文件: %.2f s, 最大积压 %.2f s\n", (double)st.spilled_samples / st.sample_rate,
+            (double)st.max_spill_samples / st.sample_rate);
+    }
+    wprintf(L"最大积压: %.0f ms, 落后实时: %.1f s\n", st.max_lag_ms, st.behind_live_s);
+    if (st.lang_detections > 0) {
+        wprintf(L"语言检测: %ls (p=%.2f), 检测 %llu 次, 切换 %llu 次, 耗时 %.1f ms\n",
+            st.language.empty() ? L"未锁定" : to_wide(st.language.c_str()).c_str(), st.language_prob,
+            (unsigned long long)st.lang_detections, (unsigned long long)st.lang_changes, st.lang_detect_ms);
+    }
+    if (g_params.deadline_ms != 0) {
+        wprintf(L"时间预算: 超时 %llu 个窗口 (中止 %llu 次, 重试 %llu 次)\n", (unsigned long long)st.deadline_misses,
+            (unsigned long long)st.deadline_aborts, (unsigned long long)st.deadline_retries);
+    }
+    if (st.discontinuities > 0) {
+        wprintf(L"采集不连续: %llu 次, 补入静音 %.2f s\n", (unsigned long long)st.discontinuities,
+            (double)st.gap_samples / WHISPER_SAMPLE_RATE);
+    }
+    if (st.silent_windows > 0) {
+        wprintf(L"已知静音: 跳过 %llu 个窗口\n", (unsigned long long)st.silent_windows);
+    }
+    if (g_params.mel_frontend) {
+        wprintf(L"mel帧: 计算 %llu 帧 (逐窗口重算约需 %llu 帧)\n",
+            (unsigned long long)st.mel_frames, (unsigned long long)st.mel_frames_naive);
+    }
+    if (g_params.local_agreement) {
+        wprintf(L"稳定前缀: 提交 %llu 个token, 平均推理窗口 %.2f s\n", (unsigned long long)st.tokens_committed,
+            st.n_inferences > 0 ? (double)st.window_samples / st.n_inferences / WHISPER_SAMPLE_RATE : 0.0);
+    }
+    if (st.vad_enabled) {
+        const VadStats& vs = st.vad;
+        wprintf(L"VAD: 语音帧 %.1f%%, 跳过 %llu/%llu 个窗口 (节省 %llu 次推理)\n",
+            vs.frames_total > 0 ? 100.0 * vs.frames_speech / vs.frames_total : 0.0,
+            (unsigned long long)vs.windows_skipped, (unsigned long long)vs.windows_total,
+            (unsigned long long)vs.windows_skipped);
+    }
+    wprintf(L"唤醒次数: %llu (%.1f 次/秒, %ls)\n", (unsigned long long)st.n_wakeups,
+        st.wall_s > 0.0 ? st.n_wakeups / st.wall_s : 0.0, g_params.event_driven ? L"事件驱动" : L"轮询");
+    print_latency(L"唤醒到处理延迟", st.wake_latency);
+}
 
-            // 保留最后一部分音频用于下一次处理
-            const int n_samples_keep = n_samples_len - n_samples_step;
-            if (n_samples_keep > 0 && audio_data.size() > n_samples_keep) {
-                std::vector<float> new_audio(audio_data.end() - n_samples_keep, audio_data.end());
-                audio_data = std::move(new_audio);
-            } else {
-                audio_data.clear();
-            }
-            audio_data.reserve(n_samples_len);
+// 输出各阶段延迟的分布（所有流合并）到out
+static void print_stage_latency(const StreamEngine& engine, FILE* out) {
+    fwprintf(out, L"\n各阶段延迟 (ms):\n");
+    fwprintf(out, L"  %-12ls %8ls %9ls %9ls %9ls %9ls\n", L"stage", L"count", L"p50", L"p90", L"p99", L"max");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram hist;
+        engine.stage_timings().snapshot((PipelineStage)i, &hist);
+        if (hist.count() == 0) {
+            continue;
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        fwprintf(out, L"  %-12ls %8llu %9.3f %9.3f %9.3f %9.3f\n", to_wide(pipeline_stage_name((PipelineStage)i)).c_str(),
+            (unsigned long long)hist.count(), hist.percentile_ms(0.50), hist.percentile_ms(0.90),
+            hist.percentile_ms(0.99), hist.max_ms());
     }
 }
 
@@ -281,9 +386,24 @@ int main(int argc, char** argv) {
     set_console_utf8();
 
     bool list_mode = false;
-    unsigned int target_pid = 0;
     const char* model_path = nullptr;
 
+    // 音频源配置：每个-i/--pcm/--synth/-p添加一路流；
+    // 音频源选项作用于最近添加的音频源，出现在所有音频源之前时作为默认值
+    AudioSourceConfig default_config;
+    audio_source_default_config(&default_config);
+    default_config.sample_rate = WHISPER_SAMPLE_RATE;
+    std::vector<AudioSourceConfig> source_configs;
+    auto add_source = [&](AudioSourceType type, const char* path) {
+        source_configs.push_back(default_config);
+        source_configs.back().type = type;
+        source_configs.back().path = path;
+    };
+    auto current_source = [&]() -> AudioSourceConfig& {
+        return source_configs.empty() ? default_config : source_configs.back();
+    };
+    std::deque<std::vector<float>> channel_weights;  // --channel-weights的存储，地址在源创建前保持不变
+
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -296,7 +416,8 @@ int main(int argc, char** argv) {
         }
         else if (arg == "-p" || arg == "--pid") {
             if (i + 1 < argc) {
-                target_pid = std::stoul(argv[++i]);
+                add_source(AUDIO_SOURCE_WASAPI, nullptr);
+                source_configs.back().pid = std::stoul(argv[++i]);
             } else {
                 fprintf(stderr, "Error: --pid 选项需要一个PID参数\n");
                 return 1;
@@ -349,109 +470,552 @@ int main(int argc, char** argv) {
         else if (arg == "-lm" || arg == "--length-ms") {
             if (i + 1 < argc) g_params.length_ms = std::stoi(argv[++i]);
         }
+        else if (arg == "-ac" || arg == "--audio-ctx") {
+            if (i + 1 < argc) {
+                std::string value = argv[++i];
+                g_params.audio_ctx = value == "auto" ? -1 : std::stoi(value);
+            }
+        }
+        else if (arg == "--audio-ctx-margin") {
+            if (i + 1 < argc) g_params.audio_ctx_margin = std::stof(argv[++i]);
+        }
+        else if (arg == "--poll") {
+            g_params.event_driven = false;
+        }
+        else if (arg == "--mel-frontend") {
+            g_params.mel_frontend = true;
+        }
+        else if (arg == "-la" || arg == "--local-agreement") {
+            g_params.local_agreement = true;
+        }
+        else if (arg == "--overflow") {
+            if (i + 1 < argc) {
+                std::string policy = argv[++i];
+                auto it = OVERFLOW_POLICIES.find(policy);
+                if (it == OVERFLOW_POLICIES.end()) {
+                    fprintf(stderr, "Error: 不支持的积压处理策略: %s\n", policy.c_str());
+                    return 1;
+                }
+                g_params.overflow = it->second;
+            }
+        }
+        else if (arg == "--max-backlog-ms") {
+            if (i + 1 < argc) g_params.max_backlog_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "--deadline-ms") {
+            if (i + 1 < argc) {
+                std::string value = argv[++i];
+                g_params.deadline_ms = value == "auto" ? -1 : std::stoi(value);
+            }
+        }
+        else if (arg == "--lang-detect-ms") {
+            if (i + 1 < argc) g_params.lang_detect_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "--lang-recheck-ms") {
+            if (i + 1 < argc) g_params.lang_recheck_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "--compute-wait") {
+            if (i + 1 < argc) {
+                std::string mode = argv[++i];
+                if (mode == "active") {
+                    g_params.compute_wait = COMPUTE_WAIT_ACTIVE;
+                } else if (mode == "passive") {
+                    g_params.compute_wait = COMPUTE_WAIT_PASSIVE;
+                } else {
+                    fprintf(stderr, "Error: 不支持的等待方式: %s\n", mode.c_str());
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--spin-us") {
+            if (i + 1 < argc) g_params.spin_us = std::stoi(argv[++i]);
+        }
+        else if (arg == "--pin") {
+            g_params.pin_threads = true;
+        }
+        else if (arg == "--rt-capture") {
+            g_params.realtime_capture = true;
+        }
+        else if (arg == "--metrics-port") {
+            if (i + 1 < argc) g_params.metrics_port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--metrics-file") {
+            if (i + 1 < argc) g_params.metrics_file = argv[++i];
+        }
+        else if (arg == "--metrics-interval-ms") {
+            if (i + 1 < argc) g_params.metrics_interval_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "--trace") {
+            if (i + 1 < argc) g_params.trace_path = argv[++i];
+        }
+        else if (arg == "--output") {
+            if (i + 1 < argc) g_params.output_path = argv[++i];
+        }
+        else if (arg == "--output-format") {
+            if (i + 1 < argc) {
+                const std::string name = argv[++i];
+                const auto it = OUTPUT_FORMATS.find(name);
+                if (it == OUTPUT_FORMATS.end()) {
+                    fprintf(stderr, "Error: 不支持的输出格式: %s\n", name.c_str());
+                    return 1;
+                }
+                g_params.output_format = it->second;
+            }
+        }
+        else if (arg == "--flush-ms") {
+            if (i + 1 < argc) g_params.flush_ms = std::stoi(argv[++i]);
+        }
+        else if (arg == "--deadline-retry") {
+            g_params.deadline_retry = true;
+        }
+        else if (arg == "--no-partial-fallback") {
+            g_params.partial_fallback = false;
+        }
+        else if (arg == "-w" || arg == "--workers") {
+            if (i + 1 < argc) g_params.workers = std::stoi(argv[++i]);
+        }
+        else if (arg == "-i" || arg == "--input") {
+            if (i + 1 < argc) {
+                add_source(AUDIO_SOURCE_WAV, argv[++i]);
+            }
+        }
+        else if (arg == "--pcm") {
+            if (i + 1 < argc) {
+                add_source(AUDIO_SOURCE_PCM_PIPE, argv[++i]);
+            }
+        }
+        else if (arg == "--pcm-rate") {
+            if (i + 1 < argc) current_source().sample_rate = std::stoul(argv[++i]);
+        }
+        else if (arg == "--pcm-channels") {
+            if (i + 1 < argc) current_source().channels = std::stoul(argv[++i]);
+        }
+        else if (arg == "--pcm-format") {
+            if (i + 1 < argc) {
+                std::string fmt = argv[++i];
+                if (fmt == "s16") {
+                    current_source().pcm_format = AUDIO_PCM_S16;
+                } else if (fmt == "f32") {
+                    current_source().pcm_format = AUDIO_PCM_F32;
+                } else {
+                    fprintf(stderr, "Error: 不支持的PCM格式: %s\n", fmt.c_str());
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--synth") {
+            if (i + 1 < argc) {
+                std::string signal = argv[++i];
+                add_source(AUDIO_SOURCE_SYNTH, nullptr);
+                AudioSourceConfig& source_config = source_configs.back();
+                if (signal == "sine") {
+                    source_config.synth_signal = AUDIO_SYNTH_SINE;
+                } else if (signal == "noise") {
+                    source_config.synth_signal = AUDIO_SYNTH_NOISE;
+                } else if (signal == "silence") {
+                    source_config.synth_signal = AUDIO_SYNTH_SILENCE;
+                } else if (signal == "bursts") {
+                    source_config.synth_signal = AUDIO_SYNTH_BURSTS;
+                } else {
+                    fprintf(stderr, "Error: 不支持的合成信号: %s\n", signal.c_str());
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--duration") {
+            if (i + 1 < argc) current_source().duration_s = std::stod(argv[++i]);
+        }
+        else if (arg == "--pace") {
+            if (i + 1 < argc) current_source().pace = std::stof(argv[++i]);
+        }
+        else if (arg == "--gap-every") {
+            if (i + 1 < argc) current_source().synth_gap_interval_s = std::stod(argv[++i]);
+        }
+        else if (arg == "--gap-ms") {
+            if (i + 1 < argc) current_source().synth_gap_ms = std::stod(argv[++i]);
+        }
+        else if (arg == "--channel-weights") {
+            if (i + 1 < argc) {
+                std::vector<float> weights;
+                std::stringstream ss(argv[++i]);
+                std::string item;
+                while (std::getline(ss, item, ',')) {
+                    weights.push_back(std::stof(item));
+                }
+                if (weights.empty()) {
+                    fprintf(stderr, "Error: --channel-weights 需要至少一个权重\n");
+                    return 1;
+                }
+                channel_weights.push_back(std::move(weights));
+                current_source().channel_weights = channel_weights.back().data();
+                current_source().n_channel_weights = (unsigned int)channel_weights.back().size();
+            }
+        }
         else if (!model_path && arg[0] != '-') {
             model_path = argv[i];
         }
     }
 
-    // 初始化音频捕获
-    void* capture = wasapi_capture_create();
-    if (!capture) {
-        fprintf(stderr, "Failed to create audio capture\n");
-        return 1;
-    }
-
-    // 获取音频格式
-    AudioFormat format;
-    if (!wasapi_capture_get_format(capture, &format)) {
-        fprintf(stderr, "Failed to get audio format\n");
+#ifdef _WIN32
+    // 如果是列表模式，显示程序列表后退出
+    if (list_mode) {
+        void* capture = wasapi_capture_create();
+        AudioFormat format;
+        if (!capture || !wasapi_capture_get_format(capture, &format) || !wasapi_capture_initialize(capture)) {
+            fprintf(stderr, "Failed to initialize audio capture\n");
+            if (capture) wasapi_capture_destroy(capture);
+            return 1;
+        }
+        list_audio_applications(capture);
         wasapi_capture_destroy(capture);
+        return 0;
+    }
+#else
+    if (list_mode) {
+        fprintf(stderr, "Error: --list 仅在Windows上可用\n");
         return 1;
     }
-    g_audio_buffer.sample_rate = format.sample_rate;
+#endif
 
-    if (!wasapi_capture_initialize(capture)) {
-        fprintf(stderr, "Failed to initialize audio capture\n");
-        wasapi_capture_destroy(capture);
-        return 1;
+    // 没有指定音频源时使用默认音频源（Windows上为系统音频）
+    if (source_configs.empty()) {
+        source_configs.push_back(default_config);
     }
 
-    // 如果是列表模式，显示程序列表后退出
-    if (list_mode) {
-        list_audio_applications(capture);
-        wasapi_capture_destroy(capture);
-        return 0;
+    // 逐窗口模式的窗口相互重叠，字幕会重复且时间交叠；字幕只由稳定前缀模式提交的文本生成
+    if ((g_params.output_format == TRANSCRIPT_SRT || g_params.output_format == TRANSCRIPT_VTT) && !g_params.local_agreement) {
+        fprintf(stderr, "Error: 字幕格式 (srt, vtt) 需要 -la\n");
+        return 1;
     }
 
     // 检查是否提供了模型路径
     if (!model_path) {
         fprintf(stderr, "Error: 需要提供模型路径\n");
         show_usage(argv[0]);
-        wasapi_capture_destroy(capture);
         return 1;
     }
 
-    // 初始化whisper
+    // 初始化whisper：模型权重只加载一次，每路流创建独立的whisper_state
     struct whisper_context_params cparams = whisper_context_default_params();
     cparams.use_gpu = g_params.use_gpu;
-    struct whisper_context* ctx = whisper_init_from_file_with_params(model_path, cparams);
-    if (ctx == nullptr) {
+    ComputeParams compute_params;
+    compute_params.wait_policy = g_params.compute_wait;
+    compute_params.spin_us = g_params.spin_us;
+    StreamEngine::configure_compute(compute_params);
+    StreamEngine engine;
+
+    // 线程放置：所有音频源的采集线程共用一个核（每个包只做解码和下混），推理工作线程分占其余物理核
+    CpuTopology topology;
+    const bool have_topology = cpu_topology_detect(&topology);
+    ThreadPlacement placement;
+    if (g_params.pin_threads && have_topology) {
+        placement = plan_thread_placement(topology);
+        engine.set_worker_cpus(placement.inference_cpus);
+        if (!placement.inference_cpus.empty() && !set_default_thread_cpus(placement.inference_cpus)) {
+            fprintf(stderr, "Warning: 无法设置计算线程的默认CPU\n");
+        }
+    }
+    for (AudioSourceConfig& source_config : source_configs) {
+        source_config.capture_cpu = placement.capture_cpu;
+        source_config.realtime_priority = g_params.realtime_capture ? 1 : 0;
+    }
+    if (!engine.load_model(model_path, cparams)) {
         fprintf(stderr, "Failed to initialize whisper\n");
-        wasapi_capture_destroy(capture);
         return 1;
     }
+    struct whisper_context* ctx = engine.context();
+
+    StreamParams stream_params;
+    stream_params.language = g_params.language;
+    stream_params.translate = g_params.translate;
+    stream_params.print_special = g_params.print_special;
+    stream_params.no_timestamps = g_params.no_timestamps;
+    stream_params.threads = g_params.threads;
+    stream_params.max_tokens = g_params.max_tokens;
+    stream_params.vad_thold = g_params.vad_thold;
+    stream_params.step_ms = g_params.step_ms;
+    stream_params.length_ms = g_params.length_ms;
+    stream_params.audio_ctx = g_params.audio_ctx;
+    stream_params.audio_ctx_margin = g_params.audio_ctx_margin;
+    stream_params.mel_frontend = g_params.mel_frontend;
+    stream_params.local_agreement = g_params.local_agreement;
+    stream_params.overflow = g_params.overflow;
+    stream_params.max_backlog_ms = g_params.max_backlog_ms;
+    stream_params.deadline_ms = g_params.deadline_ms;
+    stream_params.partial_fallback = g_params.partial_fallback;
+    stream_params.deadline_retry = g_params.deadline_retry;
+    stream_params.lang_detect_ms = g_params.lang_detect_ms;
+    stream_params.lang_recheck_ms = g_params.lang_recheck_ms;
+
+    // 如果指定了翻译目标语言
+    if (!g_params.translate_to.empty()) {
+        stream_params.translate = true;
+        stream_params.language = g_params.translate_to;
+    }
+
+    // 初始化音频源，每个音频源对应引擎中的一路流
+    std::vector<void*> sources;
+    auto destroy_sources = [&]() {
+        for (void* source : sources) {
+            audio_source_destroy(source);
+        }
+    };
+    bool any_live = false;
+    for (AudioSourceConfig& source_config : source_configs) {
+        source_config.event_driven = g_params.event_driven ? 1 : 0;
+        void* source = audio_source_create(&source_config);
+        if (!source) {
+            fprintf(stderr, "Failed to create audio source\n");
+            destroy_sources();
+            return 1;
+        }
+        sources.push_back(source);
+
+        // 获取音频格式
+        AudioFormat format;
+        if (!audio_source_get_format(source, &format)) {
+            fprintf(stderr, "Failed to get audio format\n");
+            destroy_sources();
+            return 1;
+        }
+
+        if (!audio_source_initialize(source)) {
+            fprintf(stderr, "Failed to initialize audio source\n");
+            destroy_sources();
+            return 1;
+        }
+
+        // 尽可能快地回放时不丢弃数据，由推理速度决定投递速度
+        const bool live = audio_source_is_live(source) != 0;
+        any_live = any_live || live;
+        const int stream_id = engine.add_stream(stream_params, format.sample_rate, !live && source_config.pace <= 0.0f);
+        if (stream_id < 0) {
+            fprintf(stderr, "Failed to add stream (whisper state or spill file)\n");
+            destroy_sources();
+            return 1;
+        }
+        audio_source_set_chunk_callback(source, StreamEngine::chunk_callback, engine.stream_input(stream_id));
+    }
+    g_stream_count = engine.stream_count();
 
     // 打印当前设置
     wprintf(L"\n当前设置:\n");
     wprintf(L"----------------------------------------\n");
-    wprintf(L"输入语言: %hs\n", LANGUAGE_CODES.at(g_params.language).c_str());
+    wprintf(L"输入语言: %ls\n", to_wide(LANGUAGE_CODES.at(g_params.language).c_str()).c_str());
     if (g_params.translate) {
         wprintf(L"翻译: 开启\n");
         if (!g_params.translate_to.empty()) {
-            wprintf(L"翻译目标语言: %hs\n", LANGUAGE_CODES.at(g_params.translate_to).c_str());
+            wprintf(L"翻译目标语言: %ls\n", to_wide(LANGUAGE_CODES.at(g_params.translate_to).c_str()).c_str());
         }
     }
-    wprintf(L"线程数: %d\n", g_params.threads);
+    wprintf(L"线程数: %d (%ls)\n", g_params.threads,
+        StreamEngine::compute_threads_persistent() ? L"OpenMP常驻线程组" : L"每次图计算创建线程");
     wprintf(L"GPU加速: %ls\n", g_params.use_gpu ? L"开启" : L"关闭");
     wprintf(L"时间戳: %ls\n", g_params.no_timestamps ? L"关闭" : L"开启");
     wprintf(L"音频步长: %d ms\n", g_params.step_ms);
     wprintf(L"音频长度: %d ms\n", g_params.length_ms);
+    if (g_params.audio_ctx < 0) {
+        wprintf(L"audio_ctx: 自适应 (%d 帧, 余量 %.0f%%)\n",
+            adaptive_audio_ctx(g_params.length_ms, whisper_model_n_audio_ctx(ctx), g_params.audio_ctx_margin),
+            g_params.audio_ctx_margin * 100.0f);
+    } else if (g_params.audio_ctx > 0) {
+        wprintf(L"audio_ctx: %d 帧\n", g_params.audio_ctx);
+    }
+    wprintf(L"mel频谱: %ls\n", g_params.mel_frontend ? L"流式增量计算" : L"whisper逐窗口计算");
+    wprintf(L"输出模式: %ls\n", g_params.local_agreement ? L"稳定前缀 (LocalAgreement)" : L"逐窗口");
+    wprintf(L"音频流: %d 路, 工作线程: %d\n", engine.stream_count(), g_params.workers);
+    for (const auto& policy : OVERFLOW_POLICIES) {
+        if (policy.second == g_params.overflow) {
+            wprintf(L"积压处理: %ls (上限 %d ms)\n", to_wide(policy.first.c_str()).c_str(), g_params.max_backlog_ms);
+        }
+    }
+    if (have_topology) {
+        wprintf(L"CPU: %ls\n", to_wide(topology.describe().c_str()).c_str());
+    }
+    if (placement.capture_cpu >= 0) {
+        wprintf(L"线程放置: 采集 CPU %d, 推理 CPU %ls\n", placement.capture_cpu,
+            to_wide(format_cpu_list(placement.inference_cpus).c_str()).c_str());
+    } else if (g_params.pin_threads) {
+        wprintf(L"线程放置: 物理核少于2个, 不固定\n");
+    }
+    if (g_params.compute_wait != COMPUTE_WAIT_DEFAULT || g_params.spin_us >= 0) {
+        wprintf(L"计算线程等待: %ls", g_params.compute_wait == COMPUTE_WAIT_ACTIVE ? L"自旋"
+            : g_params.compute_wait == COMPUTE_WAIT_PASSIVE ? L"休眠" : L"默认");
+        if (g_params.spin_us >= 0) {
+            wprintf(L", 自旋 %d us", g_params.spin_us);
+        }
+        wprintf(L"\n");
+    }
+    const unsigned n_cpus = std::thread::hardware_concurrency();
+    if (g_params.compute_wait == COMPUTE_WAIT_ACTIVE && n_cpus > 0 &&
+        (unsigned)(std::min(g_params.workers, engine.stream_count()) * g_params.threads) > n_cpus) {
+        wprintf(L"警告: 工作线程数 x 线程数超过CPU核数 (%u)，自旋等待的线程会互相抢占\n", n_cpus);
+    }
     wprintf(L"----------------------------------------\n\n");
 
-    // 设置音频回调
-    wasapi_capture_set_callback(capture, (audio_callback)audio_data_callback, &g_audio_buffer);
-
-    // 启动whisper处理线程
-    std::thread whisper_thread(whisper_processing_thread, ctx);
+    // 时间线从工作线程和采集线程启动前开始记录
+    if (!g_params.trace_path.empty()) {
+        trace_start();
+        wprintf(L"时间线记录: %ls\n", to_wide(g_params.trace_path.c_str()).c_str());
+    }
 
-    // 启动音频捕获
-    bool capture_success;
-    if (target_pid > 0) {
-        wprintf(L"正在捕获PID %u 的音频...\n", target_pid);
-        capture_success = wasapi_capture_start_process(capture, target_pid);
-    } else {
-        wprintf(L"正在捕获系统音频...\n");
-        capture_success = wasapi_capture_start(capture);
+    // 识别文本的输出线程
+    TranscriptSinkParams sink_params;
+    sink_params.format = g_params.output_format;
+    sink_params.path = g_params.output_path;
+    sink_params.flush_ms = g_params.flush_ms;
+    sink_params.timestamps = !g_params.no_timestamps;
+    sink_params.stream_prefix = g_stream_count > 1;
+    if (!g_sink.open(sink_params, engine.stream_count())) {
+        fwprintf(stderr, L"无法打开输出文件 %ls\n", to_wide(g_params.output_path.c_str()).c_str());
+        destroy_sources();
+        return 1;
     }
 
-    if (!capture_success) {
-        fwprintf(stderr, L"Failed to start audio capture\n");
-        g_is_running = false;
-        whisper_thread.join();
-        wasapi_capture_destroy(capture);
-        whisper_free(ctx);
+    // 启动工作线程
+    engine.set_event_callback(stream_event_callback_fn, nullptr);
+    if (!engine.start(g_params.workers, g_params.event_driven)) {
+        fprintf(stderr, "Failed to start stream engine\n");
+        g_sink.close();
+        destroy_sources();
         return 1;
     }
 
-    wprintf(L"Started capturing. Press Enter to stop...\n");
-    getchar();
+    // 监控指标：只读取引擎的原子计数，不影响采集与推理
+    MetricsExporter metrics_http(engine);
+    MetricsExporter metrics_file(engine);
+    if (g_params.metrics_port > 0) {
+        if (metrics_http.serve_http("127.0.0.1", g_params.metrics_port)) {
+            wprintf(L"监控指标: http://127.0.0.1:%d/metrics\n", g_params.metrics_port);
+        } else {
+            fwprintf(stderr, L"无法在端口 %d 上提供监控指标\n", g_params.metrics_port);
+        }
+    }
+    if (!g_params.metrics_file.empty()) {
+        if (metrics_file.write_file(g_params.metrics_file, g_params.metrics_interval_ms)) {
+            wprintf(L"监控指标文件: %ls (每 %d ms)\n", to_wide(g_params.metrics_file.c_str()).c_str(),
+                g_params.metrics_interval_ms);
+        } else {
+            fwprintf(stderr, L"无法写入监控指标文件 %ls\n", to_wide(g_params.metrics_file.c_str()).c_str());
+        }
+    }
+
+    // 启动音频捕获
+    for (size_t i = 0; i < sources.size(); i++) {
+        const AudioSourceConfig& source_config = source_configs[i];
+        const wchar_t* prefix = sources.size() > 1 ? L"  " : L"";
+        switch (source_config.type) {
+        case AUDIO_SOURCE_WASAPI:
+            if (source_config.pid > 0) {
+                wprintf(L"%ls正在捕获PID %u 的音频...\n", prefix, source_config.pid);
+            } else {
+                wprintf(L"%ls正在捕获系统音频...\n", prefix);
+            }
+            break;
+        case AUDIO_SOURCE_WAV:
+            wprintf(L"%ls正在读取WAV文件 %ls ...\n", prefix, to_wide(source_config.path).c_str());
+            break;
+        case AUDIO_SOURCE_PCM_PIPE:
+            wprintf(L"%ls正在读取PCM数据 %ls ...\n", prefix, to_wide(source_config.path).c_str());
+            break;
+        case AUDIO_SOURCE_SYNTH:
+            wprintf(L"%ls正在生成合成信号...\n", prefix);
+            break;
+        }
+        // 识别文本由输出线程直接写入标准输出，stdio中缓冲的提示信息要先写出
+        fflush(stdout);
+
+        if (!audio_source_start(sources[i])) {
+            fwprintf(stderr, L"Failed to start audio capture\n");
+            engine.stop();
+            for (size_t j = 0; j < i; j++) {
+                audio_source_stop(sources[j]);
+            }
+            destroy_sources();
+            return 1;
+        }
+    }
+
+    // 按需输出各阶段延迟：信号处理函数只置标志，由这个线程在输出锁下打印到标准错误，
+    // 不与输出线程直接写入标准输出的识别文本交错
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, dump_signal_handler);
+#elif defined(SIGBREAK)
+    std::signal(SIGBREAK, dump_signal_handler);
+#endif
+    std::thread dump_thread([&engine] {
+        while (g_is_running) {
+            if (g_dump_stages.exchange(false)) {
+                std::lock_guard<std::mutex> lock(g_output_mutex);
+                print_stage_latency(engine, stderr);
+                fflush(stderr);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+
+    bool input_finished = false;
+    if (any_live) {
+        wprintf(L"Started capturing. Press Enter to stop, s + Enter to show stage latency...\n");
+        fflush(stdout);
+        char line[64];
+        while (fgets(line, sizeof(line), stdin)) {
+            if (line[0] != 's' && line[0] != 'S') {
+                break;
+            }
+            g_dump_stages = true;
+        }
+    } else {
+        // 回放源：运行到所有音频结束或Ctrl+C，每个音频源结束后立即处理其剩余音频
+        std::signal(SIGINT, signal_handler);
+        std::vector<bool> finished(sources.size(), false);
+        size_t n_finished = 0;
+        while (g_is_running && n_finished < sources.size()) {
+            for (size_t i = 0; i < sources.size(); i++) {
+                if (!finished[i] && audio_source_is_finished(sources[i])) {
+                    engine.finish_stream((int)i);
+                    finished[i] = true;
+                    n_finished++;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        input_finished = n_finished == sources.size();
+    }
 
     // 清理资源
+    if (input_finished) {
+        // 等待各流消费完剩余音频
+        engine.wait_finished();
+    }
     g_is_running = false;
-    whisper_thread.join();
-    wasapi_capture_stop(capture);
-    wasapi_capture_destroy(capture);
-    whisper_free(ctx);
+    dump_thread.join();
+    engine.stop();
+    for (void* source : sources) {
+        audio_source_stop(source);
+    }
+    // 写出剩余的识别文本，之后的统计输出不会与之交错
+    g_sink.close();
+    if (g_sink.dropped() > 0) {
+        fwprintf(stderr, L"输出队列已满, 丢弃 %llu 条识别文本\n", (unsigned long long)g_sink.dropped());
+    }
+
+    for (int i = 0; i < engine.stream_count(); i++) {
+        print_stream_stats(i, engine.stats(i));
+    }
+    print_stage_latency(engine, stdout);
+    metrics_http.stop();
+    metrics_file.stop();
+
+    if (!g_params.trace_path.empty()) {
+        const long long n_events = trace_write(g_params.trace_path);
+        if (n_events >= 0) {
+            wprintf(L"\n时间线已写入 %ls (%lld 个事件)\n", to_wide(g_params.trace_path.c_str()).c_str(), n_events);
+        } else {
+            fwprintf(stderr, L"无法写入时间线文件 %ls\n", to_wide(g_params.trace_path.c_str()).c_str());
+        }
+    }
 
+    destroy_sources();
     return 0;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,196 @@
+#include "mel_frontend.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Slaney mel刻度（librosa默认，whisper的mel滤波器即由此生成）
+double hz_to_mel(double hz) {
+    const double f_sp = 200.0 / 3.0;
+    const double min_log_hz = 1000.0;
+    const double min_log_mel = min_log_hz / f_sp;
+    const double logstep = std::log(6.4) / 27.0;
+    return hz < min_log_hz ? hz / f_sp : min_log_mel + std::log(hz / min_log_hz) / logstep;
+}
+
+double mel_to_hz(double mel) {
+    const double f_sp = 200.0 / 3.0;
+    const double min_log_hz = 1000.0;
+    const double min_log_mel = min_log_hz / f_sp;
+    const double logstep = std::log(6.4) / 27.0;
+    return mel < min_log_mel ? mel * f_sp : min_log_hz * std::exp(logstep * (mel - min_log_mel));
+}
+
+} // namespace
+
+bool MelFrontend::init(int n_mel, int sample_rate, int n_fft, int hop) {
+    if (n_mel <= 0 || n_fft <= 0 || hop <= 0) return false;
+
+    n_mel_ = n_mel;
+    sample_rate_ = sample_rate;
+    n_fft_ = n_fft;
+    hop_ = hop;
+    n_bins_ = n_fft / 2 + 1;
+
+    fft_.init(n_fft);
+    fft_in_.resize(n_fft);
+    spectrum_.resize(n_bins_);
+    power_.resize(n_bins_);
+
+    // 周期Hann窗，与whisper.cpp一致
+    window_.resize(n_fft);
+    for (int i = 0; i < n_fft; i++) {
+        window_[i] = (float)(0.5 * (1.0 - std::cos(2.0 * 3.14159265358979323846 * i / n_fft)));
+    }
+
+    // 三角mel滤波器，Slaney面积归一化
+    std::vector<double> mel_hz(n_mel + 2);
+    const double mel_min = hz_to_mel(0.0);
+    const double mel_max = hz_to_mel(sample_rate / 2.0);
+    for (int i = 0; i < n_mel + 2; i++) {
+        mel_hz[i] = mel_to_hz(mel_min + (mel_max - mel_min) * i / (n_mel + 1));
+    }
+    filters_.assign((size_t)n_mel * n_bins_, 0.0f);
+    for (int m = 0; m < n_mel; m++) {
+        const double enorm = 2.0 / (mel_hz[m + 2] - mel_hz[m]);
+        for (int k = 0; k < n_bins_; k++) {
+            const double hz = (double)k * sample_rate / n_fft;
+            const double lower = (hz - mel_hz[m]) / (mel_hz[m + 1] - mel_hz[m]);
+            const double upper = (mel_hz[m + 2] - hz) / (mel_hz[m + 2] - mel_hz[m + 1]);
+            filters_[(size_t)m * n_bins_ + k] = (float)(std::max(0.0, std::min(lower, upper)) * enorm);
+        }
+    }
+
+    reset();
+    return true;
+}
+
+void MelFrontend::reset() {
+    restart(0);
+    frames_computed_ = 0;
+}
+
+void MelFrontend::restart(uint64_t position) {
+    // 与流开头相同：首帧以f*hop为中心，前半帧为其后样本的反射；[f*hop, position)视为静音
+    const uint64_t f = position / hop_;
+    pending_pos_ = (int64_t)(f * hop_) - n_fft_ / 2;
+    pending_.assign((size_t)(position - f * hop_), 0.0f);
+    reflect_pending_ = true;
+    frames_.clear();
+    frame_base_ = f;
+    next_frame_ = f;
+}
+
+void MelFrontend::append_reflection(std::vector<float>& dst) const {
+    const size_t half = (size_t)n_fft_ / 2;
+    for (size_t i = 0; i < half; i++) {
+        const size_t src = half - i;
+        dst.push_back(src < pending_.size() ? pending_[src] : 0.0f);
+    }
+}
+
+void MelFrontend::compute_frame(const float* centered, float* mel_out) {
+    for (int i = 0; i < n_fft_; i++) {
+        fft_in_[i] = centered[i] * window_[i];
+    }
+    fft_.forward_real(fft_in_.data(), spectrum_.data());
+    for (int k = 0; k < n_bins_; k++) {
+        power_[k] = std::norm(spectrum_[k]);
+    }
+    for (int m = 0; m < n_mel_; m++) {
+        const float* filter = filters_.data() + (size_t)m * n_bins_;
+        double sum = 0.0;
+        for (int k = 0; k < n_bins_; k++) {
+            sum += filter[k] * power_[k];
+        }
+        mel_out[m] = (float)std::log10(std::max(sum, 1e-10));
+    }
+}
+
+void MelFrontend::process(const float* samples, size_t n) {
+    pending_.insert(pending_.end(), samples, samples + n);
+    if (reflect_pending_) {
+        // 反射需要开头之后的n_fft/2个样本，凑够之前也不可能有完整的帧
+        if (pending_.size() <= (size_t)n_fft_ / 2) {
+            return;
+        }
+        padded_.clear();
+        append_reflection(padded_);
+        padded_.insert(padded_.end(), pending_.begin(), pending_.end());
+        pending_.swap(padded_);
+        reflect_pending_ = false;
+    }
+
+    // 第f帧覆盖绝对样本[f*hop - n_fft/2, f*hop + n_fft/2)
+    size_t offset = 0;
+    while (pending_.size() - offset >= (size_t)n_fft_) {
+        frames_.resize(frames_.size() + n_mel_);
+        compute_frame(pending_.data() + offset, frames_.data() + frames_.size() - n_mel_);
+        next_frame_++;
+        frames_computed_++;
+        offset += hop_;
+    }
+
+    pending_.erase(pending_.begin(), pending_.begin() + offset);
+    pending_pos_ += offset;
+}
+
+int MelFrontend::build(uint64_t start_sample, uint64_t end_sample, int min_frames, std::vector<float>& out) {
+    const uint64_t f0 = start_sample / hop_;
+    const uint64_t f1 = (end_sample + hop_ - 1) / hop_;
+    const int n_real = (int)(f1 - f0);
+    const int n_len = std::max(n_real, min_frames);
+
+    // 窗口末尾尚未凑满右侧半帧的几帧：按whisper的做法右侧补零后临时计算，不写入滚动矩阵
+    const int n_tail = f1 > next_frame_ ? (int)(f1 - next_frame_) : 0;
+    tail_.resize((size_t)n_tail * n_mel_);
+    if (n_tail > 0) {
+        padded_.clear();
+        if (reflect_pending_) {
+            append_reflection(padded_);
+        }
+        padded_.insert(padded_.end(), pending_.begin(), pending_.end());
+        padded_.resize(std::max(padded_.size(), (size_t)(n_tail - 1) * hop_ + n_fft_), 0.0f);
+        for (int i = 0; i < n_tail; i++) {
+            compute_frame(padded_.data() + (size_t)i * hop_, tail_.data() + (size_t)i * n_mel_);
+        }
+    }
+
+    auto frame_at = [&](uint64_t f) -> const float* {
+        if (f >= next_frame_) return tail_.data() + (f - next_frame_) * n_mel_;
+        return frames_.data() + (f - frame_base_) * n_mel_;
+    };
+
+    // 与whisper一致的归一化：以窗口最大值-8为下限截断，再(x+4)/4
+    float mmax = -1e20f;
+    for (uint64_t f = std::max(f0, frame_base_); f < f1; f++) {
+        const float* frame = frame_at(f);
+        for (int m = 0; m < n_mel_; m++) {
+            mmax = std::max(mmax, frame[m]);
+        }
+    }
+    const float floor = std::max(mmax - 8.0f, -10.0f);
+    const float silence = (floor + 4.0f) / 4.0f;
+
+    out.assign((size_t)n_mel_ * n_len, silence);
+    for (uint64_t f = std::max(f0, frame_base_); f < f1; f++) {
+        const float* frame = frame_at(f);
+        const size_t i = (size_t)(f - f0);
+        for (int m = 0; m < n_mel_; m++) {
+            out[(size_t)m * n_len + i] = (std::max(frame[m], floor) + 4.0f) / 4.0f;
+        }
+    }
+    return n_len;
+}
+
+void MelFrontend::discard_before(uint64_t sample) {
+    const uint64_t f = std::min<uint64_t>(sample / hop_, next_frame_);
+    if (f <= frame_base_) return;
+
+    // 丢弃量超过一半时才整体前移，摊还拷贝开销
+    const size_t n_drop = (size_t)(f - frame_base_) * n_mel_;
+    if (n_drop * 2 >= frames_.size()) {
+        frames_.erase(frames_.begin(), frames_.begin() + n_drop);
+        frame_base_ = f;
+    }
+}
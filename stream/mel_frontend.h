@@ -0,0 +1,69 @@
+#ifndef MEL_FRONTEND_H
+#define MEL_FRONTEND_H
+
+#include "fft.h"
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 流式log-mel前端：与whisper.cpp相同的STFT参数（n_fft=400、hop=160、周期Hann窗、Slaney mel滤波器），
+// 每个10ms帧在音频到达时只计算一次并保存在滚动矩阵中；
+// 每次推理只需对窗口内的帧做归一化，然后通过whisper_set_mel送入模型，
+// 前端开销与新到达的音频量成正比，而不是与窗口长度成正比。
+class MelFrontend {
+public:
+    bool init(int n_mel, int sample_rate = 16000, int n_fft = 400, int hop = 160);
+    void reset();
+    // 从绝对样本位置position重新开始（输入跳过了一段音频），之前的帧全部丢弃
+    void restart(uint64_t position);
+
+    // 追加新到达的样本（必须按时间顺序连续）
+    void process(const float* samples, size_t n);
+
+    // 生成[start_sample, end_sample)对应的归一化log-mel，按mel通道行优先存放（与whisper_set_mel一致）；
+    // 不足min_frames帧时以静音值填充（对应whisper对PCM末尾补零）。返回总帧数。
+    int build(uint64_t start_sample, uint64_t end_sample, int min_frames, std::vector<float>& out);
+
+    // 丢弃早于sample位置的帧
+    void discard_before(uint64_t sample);
+
+    int n_mel() const { return n_mel_; }
+    uint64_t frames_computed() const { return frames_computed_; }
+
+private:
+    void compute_frame(const float* centered, float* mel_out);
+    // 把开头n_fft/2个反射填充样本追加到dst（与whisper的log_mel_spectrogram相同），不足的样本按0
+    void append_reflection(std::vector<float>& dst) const;
+
+    int n_mel_ = 80;
+    int sample_rate_ = 16000;
+    int n_fft_ = 400;
+    int hop_ = 160;
+    int n_bins_ = 201;
+
+    Fft fft_;
+    std::vector<float> window_;
+    std::vector<float> filters_;      // n_mel × n_bins
+    std::vector<float> fft_in_;
+    std::vector<std::complex<float>> spectrum_;
+    std::vector<float> power_;
+
+    // 待分帧的样本：pending_[0]对应绝对位置pending_pos_（可为负）。
+    // 流开头的n_fft/2个反射填充样本要等凑够样本后才能生成，在此之前reflect_pending_为true，
+    // pending_[0]对应pending_pos_ + n_fft/2
+    std::vector<float> pending_;
+    int64_t pending_pos_ = 0;
+    bool reflect_pending_ = false;
+
+    // 滚动mel矩阵（帧优先，未归一化的log10值），frames_[0]对应绝对帧号frame_base_
+    std::vector<float> frames_;
+    uint64_t frame_base_ = 0;
+    uint64_t next_frame_ = 0;
+    uint64_t frames_computed_ = 0;
+
+    std::vector<float> tail_;         // build()中临时计算的窗口末尾帧
+    std::vector<float> padded_;       // 生成开头反射填充、计算末尾帧时的临时样本，跨调用复用
+};
+
+#endif // MEL_FRONTEND_H
@@ -0,0 +1,341 @@
+#include "metrics_exporter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <psapi.h>
+typedef SOCKET socket_t;
+const socket_t BAD_SOCKET = INVALID_SOCKET;
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+const socket_t BAD_SOCKET = -1;
+#define close_socket close
+#endif
+
+namespace {
+
+const int HTTP_POLL_MS = 200;          // 等待连接的超时，之后检查是否停止
+const int HTTP_IO_TIMEOUT_MS = 1000;    // 单线程逐个处理请求：不读不写的客户端最多占用这么久
+
+// 对方已断开时send不产生SIGPIPE（否则整个进程被终止），返回错误即可
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;               // Windows没有SIGPIPE；macOS在socket上设置SO_NOSIGPIPE
+#endif
+
+// 进程当前的常驻内存（字节），未知为0
+uint64_t process_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    const int n = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    return n == 2 ? resident * (uint64_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+// 进程累计CPU时间（用户态+内核态，秒）
+double process_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time)) {
+        return 0.0;
+    }
+    const auto to_100ns = [](const FILETIME& t) { return ((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime; };
+    return (to_100ns(kernel_time) + to_100ns(user_time)) / 1e7;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+}
+
+// 逐行拼接指标文本
+class MetricWriter {
+public:
+    void header(const char* name, const char* type, const char* help) {
+        append("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    }
+    void value(const char* name, const char* labels, double v) {
+        if (labels && labels[0]) {
+            append("%s{%s} %.9g\n", name, labels, v);
+        } else {
+            append("%s %.9g\n", name, v);
+        }
+    }
+    const std::string& text() const { return text_; }
+
+private:
+    template <typename... Args>
+    void append(const char* format, Args... args) {
+        char buf[512];
+        const int n = snprintf(buf, sizeof(buf), format, args...);
+        if (n > 0) {
+            text_.append(buf, std::min((size_t)n, sizeof(buf) - 1));
+        }
+    }
+
+    std::string text_;
+};
+
+// 把文本完整写入已连接的socket
+void send_all(socket_t sock, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const int n = send(sock, data.data() + sent, (int)(data.size() - sent), SEND_FLAGS);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+}
+
+} // namespace
+
+std::string MetricsExporter::render() const {
+    MetricWriter w;
+    const int n_streams = engine_.stream_count();
+    std::vector<StreamCounters> counters(n_streams);
+    for (int i = 0; i < n_streams; i++) {
+        counters[i] = engine_.counters(i);
+    }
+    // 每路流一行，带stream标签
+    auto per_stream = [&](const char* name, const char* type, const char* help, double (*get)(const StreamCounters&)) {
+        w.header(name, type, help);
+        for (int i = 0; i < n_streams; i++) {
+            char labels[32];
+            snprintf(labels, sizeof(labels), "stream=\"%d\"", i);
+            w.value(name, labels, get(counters[i]));
+        }
+    };
+
+    per_stream("voice_whisper_audio_seconds_total", "counter", "Audio processed, in seconds of input.",
+        [](const StreamCounters& c) { return c.sample_rate > 0 ? (double)c.samples_in / c.sample_rate : 0.0; });
+    per_stream("voice_whisper_realtime_factor", "gauge", "Cumulative inference time divided by audio processed.",
+        [](const StreamCounters& c) {
+            const double audio_s = c.sample_rate > 0 ? (double)c.samples_in / c.sample_rate : 0.0;
+            return audio_s > 0.0 ? c.inference_s / audio_s : 0.0;
+        });
+    per_stream("voice_whisper_backlog_seconds", "gauge", "Captured audio waiting to be processed.",
+        [](const StreamCounters& c) { return c.sample_rate > 0 ? (double)c.backlog_samples / c.sample_rate : 0.0; });
+    per_stream("voice_whisper_dropped_chunks_total", "counter", "Capture packets that were fully or partly dropped because the buffer was full.",
+        [](const StreamCounters& c) { return (double)c.dropped_chunks; });
+    per_stream("voice_whisper_dropped_seconds_total", "counter", "Audio dropped because the buffer was full.",
+        [](const StreamCounters& c) { return c.sample_rate > 0 ? (double)c.dropped_samples / c.sample_rate : 0.0; });
+    per_stream("voice_whisper_windows_total", "counter", "Windows that reached the inference decision.",
+        [](const StreamCounters& c) { return (double)c.windows; });
+    per_stream("voice_whisper_silent_windows_total", "counter", "Windows skipped without inference because they had no new speech.",
+        [](const StreamCounters& c) { return (double)c.skipped_windows; });
+    per_stream("voice_whisper_inferences_total", "counter", "whisper_full calls.",
+        [](const StreamCounters& c) { return (double)c.inferences; });
+    per_stream("voice_whisper_inference_seconds_total", "counter", "Time spent in whisper_full.",
+        [](const StreamCounters& c) { return c.inference_s; });
+    per_stream("voice_whisper_encode_seconds_total", "counter", "Encoder time of completed whisper_full calls.",
+        [](const StreamCounters& c) { return c.encode_s; });
+    per_stream("voice_whisper_decode_seconds_total", "counter", "Decoder time of completed whisper_full calls.",
+        [](const StreamCounters& c) { return c.decode_s; });
+    per_stream("voice_whisper_deadline_misses_total", "counter", "Windows abandoned because inference exceeded its deadline.",
+        [](const StreamCounters& c) { return (double)c.deadline_misses; });
+
+    w.header("voice_whisper_run_queue_depth", "gauge", "Streams waiting for an inference worker.");
+    w.value("voice_whisper_run_queue_depth", nullptr, (double)engine_.run_queue_depth());
+
+    w.header("voice_whisper_stage_latency_seconds", "summary", "Per-stage pipeline latency, all streams combined.");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram hist;
+        engine_.stage_timings().snapshot((PipelineStage)i, &hist);
+        const char* stage = pipeline_stage_name((PipelineStage)i);
+        char labels[64];
+        for (double q : { 0.5, 0.9, 0.99 }) {
+            snprintf(labels, sizeof(labels), "stage=\"%s\",quantile=\"%g\"", stage, q);
+            w.value("voice_whisper_stage_latency_seconds", labels, hist.percentile_ms(q) / 1e3);
+        }
+        snprintf(labels, sizeof(labels), "stage=\"%s\"", stage);
+        w.value("voice_whisper_stage_latency_seconds_sum", labels, hist.mean_ms() * hist.count() / 1e3);
+        w.value("voice_whisper_stage_latency_seconds_count", labels, (double)hist.count());
+    }
+
+    w.header("process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+    w.value("process_resident_memory_bytes", nullptr, (double)process_rss_bytes());
+    w.header("process_cpu_seconds_total", "counter", "Total user and system CPU time spent in seconds.");
+    w.value("process_cpu_seconds_total", nullptr, process_cpu_seconds());
+    return w.text();
+}
+
+bool MetricsExporter::serve_http(const std::string& host, int port) {
+    if (running_) {
+        return false;
+    }
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return false;
+    }
+#endif
+    const socket_t sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == BAD_SOCKET) {
+        std::cerr << "Failed to create metrics socket" << std::endl;
+        return false;
+    }
+    const int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "Invalid metrics address: " << host << std::endl;
+        close_socket(sock);
+        return false;
+    }
+    if (bind(sock, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(sock, 8) != 0) {
+        std::cerr << "Failed to listen on " << host << ":" << port << std::endl;
+        close_socket(sock);
+        return false;
+    }
+
+    listen_socket_ = (intptr_t)sock;
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::http_loop, this);
+    return true;
+}
+
+// 逐个处理连接：GET /metrics（或 /）返回指标，其余路径返回404
+void MetricsExporter::http_loop() {
+    const socket_t sock = (socket_t)listen_socket_;
+    while (running_) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sock, &fds);
+        timeval tv = { 0, HTTP_POLL_MS * 1000 };
+        if (select((int)sock + 1, &fds, nullptr, nullptr, &tv) <= 0) {
+            continue;
+        }
+        const socket_t client = accept(sock, nullptr, nullptr);
+        if (client == BAD_SOCKET) {
+            continue;
+        }
+#ifdef _WIN32
+        const DWORD timeout = HTTP_IO_TIMEOUT_MS;
+#else
+        const timeval timeout = { HTTP_IO_TIMEOUT_MS / 1000, (HTTP_IO_TIMEOUT_MS % 1000) * 1000 };
+#endif
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+        const int no_sigpipe = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+
+        // 只需要请求行，读到请求头结束或缓冲满为止
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            const int n = recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                break;
+            }
+            request.append(buf, n);
+        }
+
+        std::string response;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+            const std::string body = render();
+            response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+        send_all(client, response);
+        close_socket(client);
+    }
+    close_socket(sock);
+    listen_socket_ = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool MetricsExporter::write_file(const std::string& path, int interval_ms) {
+    if (running_) {
+        return false;
+    }
+    path_ = path;
+    interval_ms_ = std::max(interval_ms, 100);
+    if (!write_once()) {
+        std::cerr << "Failed to write metrics file: " << path << std::endl;
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&MetricsExporter::file_loop, this);
+    return true;
+}
+
+void MetricsExporter::file_loop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_), [&] { return !running_; });
+        write_once();
+    }
+}
+
+// 先写同目录下的临时文件，再原子地替换目标文件
+bool MetricsExporter::write_once() const {
+    const std::string tmp_path = path_ + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const std::string text = render();
+    const bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (fclose(file) != 0 || !ok) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tmp_path.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(tmp_path.c_str(), path_.c_str()) == 0;
+#endif
+}
+
+void MetricsExporter::stop() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "stream_engine.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Prometheus文本格式的监控指标：由StreamEngine的运行中计数、阶段直方图和进程资源占用生成，
+// 通过本地HTTP端口（GET /metrics）或定期重写的文件（node_exporter的textfile方式）导出。
+// 读取只有relaxed原子量的load和直方图分片的合并，采集与推理线程不会因导出而阻塞
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const StreamEngine& engine) : engine_(engine) {}
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // 在host:port上监听HTTP，由后台线程逐个处理请求
+    bool serve_http(const std::string& host, int port);
+    // 每隔interval_ms写入临时文件再改名覆盖path，读取方不会看到写了一半的文件
+    bool write_file(const std::string& path, int interval_ms);
+    // 停止后台线程；文件方式在停止前再写一次最终值
+    void stop();
+
+    // 当前指标的Prometheus文本
+    std::string render() const;
+
+private:
+    void http_loop();
+    void file_loop();
+    bool write_once() const;
+
+    const StreamEngine& engine_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+
+    intptr_t listen_socket_ = -1;
+    std::string path_;
+    int interval_ms_ = 1000;
+};
+
+#endif // METRICS_EXPORTER_H
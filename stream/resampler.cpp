@@ -0,0 +1,181 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// 第一类零阶修正贝塞尔函数，用于Kaiser窗
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < 1e-12 * sum) break;
+    }
+    return sum;
+}
+
+// 点积，n为8的倍数
+inline float dot(const float* a, const float* b, int n) {
+#if defined(__AVX__)
+    __m256 acc0 = _mm256_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+#if defined(__FMA__)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+#else
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+    }
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+#elif defined(RESAMPLER_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 s = _mm_add_ps(acc0, acc1);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t s = vaddq_f32(acc0, acc1);
+    float32x2_t s2 = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+    return vget_lane_f32(vpadd_f32(s2, s2), 0);
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+} // namespace
+
+bool Resampler::init(int in_rate, int out_rate, int zero_crossings) {
+    if (in_rate <= 0 || out_rate <= 0 || zero_crossings <= 0) return false;
+
+    in_rate_ = in_rate;
+    out_rate_ = out_rate;
+    const int g = std::gcd(in_rate, out_rate);
+    up_ = out_rate / g;
+    down_ = in_rate / g;
+    passthrough_ = up_ == 1 && down_ == 1;
+
+    if (passthrough_) {
+        taps_ = 0;
+        coeffs_.clear();
+        reset();
+        return true;
+    }
+
+    // 低通截止频率取输入/输出奈奎斯特频率中较小者，留出约10%过渡带；
+    // 降采样时按比例加长滤波器以保持相同的过渡带陡度
+    const double ratio = (double)down_ / up_;
+    const double cutoff = 0.5 * 0.9 * std::min(1.0, 1.0 / ratio);   // 相对输入采样率
+    taps_ = (int)std::ceil(2.0 * zero_crossings * std::max(1.0, ratio));
+    taps_ = (taps_ + 7) & ~7;
+
+    // 原型滤波器定义在上采样域（长度taps_*up_），Kaiser窗(beta=8.6，阻带约-85dB)
+    const int n_proto = taps_ * up_;
+    const double center = (n_proto - 1) / 2.0;
+    const double beta = 8.6;
+    const double i0_beta = bessel_i0(beta);
+    std::vector<double> proto(n_proto);
+    for (int i = 0; i < n_proto; i++) {
+        const double t = (i - center) / up_;   // 以输入样本为单位的时间
+        const double x = 2.0 * cutoff * t;
+        const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(PI * x) / (PI * x);
+        const double r = (i - center) / center;
+        const double window = bessel_i0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / i0_beta;
+        proto[i] = 2.0 * cutoff * sinc * window;
+    }
+
+    // 拆分为up_个相位：第p相第j个抽头乘以x[base - j]，逆序存放后与输入顺序一致
+    coeffs_.assign((size_t)up_ * taps_, 0.0f);
+    for (int p = 0; p < up_; p++) {
+        double gain = 0.0;
+        for (int j = 0; j < taps_; j++) {
+            gain += proto[p + j * up_];
+        }
+        // 每相单独归一化直流增益，避免相间幅度起伏
+        for (int j = 0; j < taps_; j++) {
+            coeffs_[(size_t)p * taps_ + (taps_ - 1 - j)] = (float)(proto[p + j * up_] / gain);
+        }
+    }
+
+    reset();
+    return true;
+}
+
+void Resampler::reset() {
+    const size_t history = taps_ > 0 ? taps_ - 1 : 0;
+    hist_.assign(history, 0.0f);
+    edge_.assign(history * 2, 0.0f);
+    pos_ = 0;
+}
+
+size_t Resampler::process(const float* in, size_t n, std::vector<float>& out) {
+    const size_t out_start = out.size();
+    out.resize(out_start + max_output(n));
+    const size_t n_out = process(in, n, out.data() + out_start);
+    out.resize(out_start + n_out);
+    return n_out;
+}
+
+size_t Resampler::process(const float* in, size_t n, float* out) {
+    if (passthrough_) {
+        memcpy(out, in, n * sizeof(float));
+        return n;
+    }
+
+    const size_t history = taps_ - 1;
+    const size_t head = std::min(n, history);
+    memcpy(edge_.data(), hist_.data(), history * sizeof(float));
+    memcpy(edge_.data() + history, in, head * sizeof(float));
+
+    size_t n_out = 0;
+    const uint64_t end = (uint64_t)n * up_;
+    for (; pos_ < end; pos_ += down_) {
+        // 点积覆盖 历史+输入 序列中的[base, base+taps_)，base < head时跨越历史与输入的边界
+        const size_t base = (size_t)(pos_ / up_);
+        const int phase = (int)(pos_ % up_);
+        const float* x = base < head ? edge_.data() + base : in + (base - history);
+        out[n_out++] = dot(coeffs_.data() + (size_t)phase * taps_, x, taps_);
+    }
+
+    // 保留最后taps_-1个样本作为下一次的历史
+    pos_ -= end;
+    if (n >= history) {
+        memcpy(hist_.data(), in + (n - history), history * sizeof(float));
+    } else {
+        memmove(hist_.data(), hist_.data() + n, (history - n) * sizeof(float));
+        memcpy(hist_.data() + (history - n), in, n * sizeof(float));
+    }
+    return n_out;
+}
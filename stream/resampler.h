@@ -0,0 +1,46 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 流式多相(polyphase)窗函数sinc重采样器
+// 支持任意有理数比例（如48000/16000、44100/16000），滤波器历史在多次process()之间保留，
+// 因此每个输入样本只在到达时处理一次，分块边界处输出与一次性处理完全一致。
+class Resampler {
+public:
+    // 初始化in_rate→out_rate的重采样器；zero_crossings为sinc每侧的过零点数，越大过渡带越陡
+    bool init(int in_rate, int out_rate, int zero_crossings = 8);
+
+    // 清空滤波器历史
+    void reset();
+
+    // 处理一段输入，将结果追加到out，返回本次输出的样本数
+    size_t process(const float* in, size_t n, std::vector<float>& out);
+    // 同上，结果写入out（至少max_output(n)个float的空间）
+    size_t process(const float* in, size_t n, float* out);
+
+    // 处理n个输入样本最多会产生的输出样本数
+    size_t max_output(size_t n) const { return (size_t)(((uint64_t)n * up_ + down_ - 1) / down_) + 1; }
+
+    int in_rate() const { return in_rate_; }
+    int out_rate() const { return out_rate_; }
+
+private:
+    int in_rate_ = 0;
+    int out_rate_ = 0;
+    int up_ = 1;        // 上采样因子L
+    int down_ = 1;      // 下采样因子M
+    int taps_ = 0;      // 每相抽头数（8的倍数，便于SIMD）
+    bool passthrough_ = true;
+
+    std::vector<float> coeffs_;   // up_相 × taps_，每相系数逆序存放，与输入顺序对齐做点积
+    // 概念上的输入序列为 taps_-1个历史样本 + 本次输入：完全落在本次输入内的点积直接读取输入，
+    // 只有跨越两者边界的前几个输出使用edge_，每次调用只拷贝两端各taps_-1个样本
+    std::vector<float> hist_;     // 最近taps_-1个输入样本
+    std::vector<float> edge_;     // hist_ + 本次输入的前taps_-1个样本
+    uint64_t pos_ = 0;            // 下一个输出样本在上采样域中相对本次首个输入样本的位置
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,125 @@
+#include "sliding_window.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+size_t page_size() {
+#ifdef _WIN32
+    // 映射视图的起始地址必须按分配粒度（通常64KB）对齐
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+#elif defined(__linux__)
+    const long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+#else
+    return 4096;
+#endif
+}
+
+} // namespace
+
+SlidingWindow::~SlidingWindow() {
+    release();
+}
+
+void SlidingWindow::release() {
+    if (base_) {
+        const size_t bytes = capacity_ * sizeof(float);
+#ifdef _WIN32
+        if (mirrored_) {
+            UnmapViewOfFile(base_);
+            UnmapViewOfFile((char*)base_ + bytes);
+        } else {
+            free(base_);
+        }
+#elif defined(__linux__)
+        if (mirrored_) {
+            munmap(base_, 2 * bytes);
+        } else {
+            free(base_);
+        }
+#else
+        (void)bytes;
+        free(base_);
+#endif
+    }
+#ifdef _WIN32
+    if (mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+#endif
+    base_ = nullptr;
+    capacity_ = 0;
+    mirrored_ = false;
+    clear();
+}
+
+bool SlidingWindow::init(size_t min_capacity) {
+    release();
+
+    const size_t page = page_size();
+    const size_t bytes = (min_capacity * sizeof(float) + page - 1) / page * page;
+    capacity_ = bytes / sizeof(float);
+
+#ifdef _WIN32
+    // 先保留2倍的地址空间确定位置，释放后立即在该处映射两个视图；
+    // 其他线程可能在这之间占用该地址，失败时重试
+    mapping_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        (DWORD)((unsigned long long)bytes >> 32), (DWORD)(bytes & 0xFFFFFFFFu), nullptr);
+    for (int attempt = 0; mapping_ && attempt < 16 && !mirrored_; attempt++) {
+        void* addr = VirtualAlloc(nullptr, 2 * bytes, MEM_RESERVE, PAGE_NOACCESS);
+        if (!addr) break;
+        VirtualFree(addr, 0, MEM_RELEASE);
+
+        void* first = MapViewOfFileEx(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes, addr);
+        void* second = first ? MapViewOfFileEx(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes, (char*)addr + bytes) : nullptr;
+        if (first && second) {
+            base_ = static_cast<float*>(first);
+            mirrored_ = true;
+        } else if (first) {
+            UnmapViewOfFile(first);
+        }
+    }
+    if (!mirrored_ && mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+#elif defined(__linux__)
+    // 保留2倍的地址空间，再把同一个memfd固定映射到前后两半
+    const int fd = memfd_create("sliding_window", MFD_CLOEXEC);
+    if (fd >= 0) {
+        if (ftruncate(fd, (off_t)bytes) == 0) {
+            void* addr = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (addr != MAP_FAILED) {
+                char* p = static_cast<char*>(addr);
+                if (mmap(p, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+                    mmap(p + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    base_ = static_cast<float*>(addr);
+                    mirrored_ = true;
+                } else {
+                    munmap(addr, 2 * bytes);
+                }
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (!mirrored_) {
+        base_ = static_cast<float*>(malloc(2 * bytes));
+        if (!base_) {
+            capacity_ = 0;
+            return false;
+        }
+    }
+    return true;
+}
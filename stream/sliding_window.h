@@ -0,0 +1,76 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+#include <cstddef>
+#include <cstring>
+
+// 滑动窗口缓冲：窗口内容始终是一段连续内存，尾部追加、头部丢弃都不需要拷贝。
+// 同一块物理内存在虚拟地址上连续映射两次（Linux为memfd，Windows为文件映射），
+// 从任意起点开始的capacity()个样本都是连续的，丢弃头部只是移动起点。
+// 双重映射不可用时退化为2倍容量的线性缓冲，起点到达末尾时把窗口整体移回开头（摊还拷贝）。
+class SlidingWindow {
+public:
+    SlidingWindow() = default;
+    ~SlidingWindow();
+
+    SlidingWindow(const SlidingWindow&) = delete;
+    SlidingWindow& operator=(const SlidingWindow&) = delete;
+
+    // 分配至少min_capacity个float的容量（按页大小向上取整），清空窗口
+    bool init(size_t min_capacity);
+
+    float* data() { return base_ + head_; }
+    const float* data() const { return base_ + head_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    size_t free_space() const { return capacity_ - size_; }
+    bool empty() const { return size_ == 0; }
+    bool mirrored() const { return mirrored_; }
+
+    // 返回窗口末尾可写入n个float的连续空间（n不超过free_space()），写入后调用commit()
+    float* prepare(size_t n) {
+        if (!mirrored_ && head_ + size_ + n > 2 * capacity_) {
+            memmove(base_, base_ + head_, size_ * sizeof(float));
+            head_ = 0;
+        }
+        return base_ + head_ + size_;
+    }
+
+    void commit(size_t n) { size_ += n; }
+
+    void append(const float* samples, size_t n) {
+        memcpy(prepare(n), samples, n * sizeof(float));
+        commit(n);
+    }
+
+    // 丢弃最早的n个样本
+    void consume(size_t n) {
+        size_ -= n;
+        head_ += n;
+        if (mirrored_ && head_ >= capacity_) {
+            head_ -= capacity_;
+        }
+        if (size_ == 0) {
+            head_ = 0;
+        }
+    }
+
+    void clear() {
+        size_ = 0;
+        head_ = 0;
+    }
+
+private:
+    void release();
+
+    float* base_ = nullptr;
+    size_t capacity_ = 0;      // 样本数
+    size_t head_ = 0;          // 窗口起点相对base_的偏移
+    size_t size_ = 0;
+    bool mirrored_ = false;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+#endif // SLIDING_WINDOW_H
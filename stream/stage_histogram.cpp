@@ -0,0 +1,146 @@
+#include "stage_histogram.h"
+#include <algorithm>
+#include <thread>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+// 最高置位的位序号，v不为0
+int highest_bit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+std::atomic<uint64_t> g_next_recorder_id{1};
+
+// 每个线程最近一次使用的记录器及其分片
+struct LocalShardCache {
+    uint64_t recorder_id = 0;
+    void* shard = nullptr;
+};
+thread_local LocalShardCache t_shard_cache;
+
+} // namespace
+
+const char* pipeline_stage_name(PipelineStage stage) {
+    switch (stage) {
+    case STAGE_CAPTURE: return "capture";
+    case STAGE_ENQUEUE: return "enqueue";
+    case STAGE_QUEUE_WAIT: return "queue_wait";
+    case STAGE_RESAMPLE: return "resample";
+    case STAGE_FEATURES: return "features";
+    case STAGE_ENCODE: return "encode";
+    case STAGE_DECODE: return "decode";
+    case STAGE_OUTPUT: return "output";
+    case STAGE_END_TO_END: return "end_to_end";
+    default: return "unknown";
+    }
+}
+
+int LatencyHistogram::bucket_of(uint64_t ns) {
+    if (ns < (uint64_t)SUB_COUNT) {
+        return (int)ns;
+    }
+    const int e = highest_bit(ns);
+    if (e >= MAX_EXP) {
+        return N_BUCKETS - 1;
+    }
+    return (e - SUB_BITS + 1) * SUB_COUNT + (int)((ns >> (e - SUB_BITS)) - SUB_COUNT);
+}
+
+uint64_t LatencyHistogram::bucket_low(int bucket) {
+    if (bucket < SUB_COUNT) {
+        return (uint64_t)bucket;
+    }
+    const int k = bucket / SUB_COUNT;
+    const int sub = bucket % SUB_COUNT;
+    return (uint64_t)(SUB_COUNT + sub) << (k - 1);
+}
+
+double LatencyHistogram::percentile_ms(double p) const {
+    if (count_ == 0) {
+        return 0.0;
+    }
+    const uint64_t rank = std::min<uint64_t>(count_, (uint64_t)(p * count_) + 1);
+    uint64_t seen = 0;
+    for (int b = 0; b < N_BUCKETS; b++) {
+        seen += counts_[b];
+        if (seen >= rank) {
+            const uint64_t width = b < SUB_COUNT ? 1 : (uint64_t)1 << (b / SUB_COUNT - 1);
+            const double mid = bucket_low(b) + width / 2.0;
+            return std::min(mid, (double)max_ns_) / 1e6;
+        }
+    }
+    return max_ms();
+}
+
+struct StageRecorder::Shard {
+    std::thread::id owner;
+    std::atomic<uint64_t> counts[STAGE_COUNT][LatencyHistogram::N_BUCKETS];
+    std::atomic<uint64_t> sum_ns[STAGE_COUNT];
+    std::atomic<uint64_t> max_ns[STAGE_COUNT];
+};
+
+StageRecorder::StageRecorder() : id_(g_next_recorder_id.fetch_add(1)) {
+}
+
+StageRecorder::~StageRecorder() = default;
+
+StageRecorder::Shard* StageRecorder::local_shard() {
+    if (t_shard_cache.recorder_id == id_) {
+        return static_cast<Shard*>(t_shard_cache.shard);
+    }
+    // 每个线程第一次记录（或在多个记录器之间切换）时才加锁
+    const std::thread::id self = std::this_thread::get_id();
+    Shard* shard = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (const auto& s : shards_) {
+            if (s->owner == self) {
+                shard = s.get();
+                break;
+            }
+        }
+        if (!shard) {
+            shards_.emplace_back(new Shard());   // 值初始化：计数全为0
+            shard = shards_.back().get();
+            shard->owner = self;
+        }
+    }
+    t_shard_cache.recorder_id = id_;
+    t_shard_cache.shard = shard;
+    return shard;
+}
+
+void StageRecorder::record(PipelineStage stage, int64_t ns) {
+    const uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    Shard* shard = local_shard();
+    // 单写者：普通的load+store即可，读取侧看到的总是某个完整的值
+    std::atomic<uint64_t>& count = shard->counts[stage][LatencyHistogram::bucket_of(v)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    shard->sum_ns[stage].store(shard->sum_ns[stage].load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    if (v > shard->max_ns[stage].load(std::memory_order_relaxed)) {
+        shard->max_ns[stage].store(v, std::memory_order_relaxed);
+    }
+}
+
+void StageRecorder::snapshot(PipelineStage stage, LatencyHistogram* out) const {
+    *out = LatencyHistogram();
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& shard : shards_) {
+        for (int b = 0; b < LatencyHistogram::N_BUCKETS; b++) {
+            const uint64_t n = shard->counts[stage][b].load(std::memory_order_relaxed);
+            if (n > 0) {
+                out->add(b, n);
+            }
+        }
+        out->add_sum(shard->sum_ns[stage].load(std::memory_order_relaxed), shard->max_ns[stage].load(std::memory_order_relaxed));
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef STAGE_HISTOGRAM_H
+#define STAGE_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 采集 → 输出文本流水线的各阶段
+enum PipelineStage {
+    STAGE_CAPTURE = 0,      // 采集时刻（包末尾）到采集回调被调用
+    STAGE_ENQUEUE,          // 采集回调写入环形缓冲（回放源包括等待空间）
+    STAGE_QUEUE_WAIT,       // 数据凑够一个处理步到工作线程开始处理该窗口（调度/轮询/排队）
+    STAGE_RESAMPLE,         // 重采样到16kHz
+    STAGE_FEATURES,         // VAD与流式mel
+    STAGE_ENCODE,           // whisper编码（开始编码到第一次采样token，含提示词解码）
+    STAGE_DECODE,           // whisper解码（第一次采样token到whisper_full返回）
+    STAGE_OUTPUT,           // 事件回调（控制台输出等）
+    STAGE_END_TO_END,       // 采集到输出文本
+    STAGE_COUNT
+};
+
+const char* pipeline_stage_name(PipelineStage stage);
+
+// HDR风格的对数-线性直方图：每个2的幂区间分为32个等宽子桶，相对误差不超过1/32，
+// 覆盖1ns到约36分钟。多线程记录由StageRecorder完成；只有一个线程读写时可直接record()
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int MAX_EXP = 41;                  // 最大可区分的值 2^41 ns
+    static const int N_BUCKETS = (MAX_EXP - SUB_BITS + 1) * SUB_COUNT;
+
+    static int bucket_of(uint64_t ns);
+    static uint64_t bucket_low(int bucket);         // 桶的下界(ns)
+
+    void add(int bucket, uint64_t n) { counts_[bucket] += n; count_ += n; }
+    void add_sum(uint64_t sum_ns, uint64_t max_ns) {
+        sum_ns_ += sum_ns;
+        if (max_ns > max_ns_) max_ns_ = max_ns;
+    }
+    void record(int64_t ns) {
+        const uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+        add(bucket_of(v), 1);
+        add_sum(v, v);
+    }
+
+    uint64_t count() const { return count_; }
+    double mean_ms() const { return count_ > 0 ? sum_ns_ / 1e6 / count_ : 0.0; }
+    double max_ms() const { return max_ns_ / 1e6; }
+    // p为[0, 1]，返回所在桶的中点（毫秒）
+    double percentile_ms(double p) const;
+
+private:
+    uint64_t counts_[N_BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t sum_ns_ = 0;
+    uint64_t max_ns_ = 0;
+};
+
+// 各阶段耗时的记录器：每个记录线程写自己的分片（首次记录时注册），
+// 分片只有一个写者，计数用relaxed的load+store递增，没有锁也没有原子读改写；
+// 读取时合并所有分片，可与记录同时进行（结果可能缺少正在写入的几次记录）
+class StageRecorder {
+public:
+    StageRecorder();
+    ~StageRecorder();
+
+    StageRecorder(const StageRecorder&) = delete;
+    StageRecorder& operator=(const StageRecorder&) = delete;
+
+    void record(PipelineStage stage, int64_t ns);
+
+    // 合并所有线程的记录
+    void snapshot(PipelineStage stage, LatencyHistogram* out) const;
+
+private:
+    struct Shard;
+    Shard* local_shard();
+
+    const uint64_t id_;                 // 区分记录器实例（线程局部的分片缓存按id匹配）
+    mutable std::mutex mtx_;            // 只保护分片列表
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+#endif // STAGE_HISTOGRAM_H
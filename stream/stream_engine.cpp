@@ -0,0 +1,1337 @@
+#include "stream_engine.h"
+#include "audio_ctx.h"
+#include "sliding_window.h"
+#include "thread_placement.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 采集块标记：ring_pos之后的样本属于一个新的采集块
+struct ChunkMark {
+    uint64_t ring_pos;          // 该块首样本在环形缓冲写入流中的序号
+    uint64_t position;          // AudioChunkInfo::position
+    int64_t capture_ns;
+    unsigned int flags;
+};
+
+// 16kHz位置与采集时刻的对应点
+struct TimeAnchor {
+    uint64_t position;
+    int64_t capture_ns;
+};
+
+const size_t MAX_CHUNK_MARKS = 1024;    // 约10秒的10ms包
+const int MAX_GAP_FILL_S = 30;          // 单次丢失最多补入的静音时长
+const size_t SPILL_BLOCK = 16384;       // 从临时文件分块读取的样本数
+const int MIN_DEADLINE_DIV = 4;         // 自动时间预算不低于step_ms的1/4，重试的余量也至少这么多
+const float LANG_LOW_TOKEN_P = 0.35f;   // 锁定语言后窗口的平均token概率低于该值时提前重新检测
+
+// 定位到临时文件中第sample个样本（文件可能超过2GB）
+bool spill_seek(FILE* file, uint64_t sample) {
+#ifdef _WIN32
+    return _fseeki64(file, (int64_t)(sample * sizeof(float)), SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)(sample * sizeof(float)), SEEK_SET) == 0;
+#endif
+}
+
+// 设置环境变量，已存在时保留用户的值
+void set_env_default(const char* name, const std::string& value) {
+    if (getenv(name)) {
+        return;
+    }
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 0);
+#endif
+}
+
+// 只有一个写者的计数：relaxed的load+store，其他线程随时可读
+void counter_add(std::atomic<uint64_t>& counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// 重采样后直接写入窗口末尾，返回输出的样本数
+size_t resample_into(Resampler& resampler, SlidingWindow& window, const float* in, size_t n) {
+    const size_t n_out = resampler.process(in, n, window.prepare(resampler.max_output(n)));
+    window.commit(n_out);
+    return n_out;
+}
+
+} // namespace
+
+// 单路流：生产者侧字段由采集回调访问，其余字段只由当前持有该流的工作线程访问
+struct StreamEngine::Stream {
+    StreamEngine* engine = nullptr;
+    int id = 0;
+    StreamParams params;
+    whisper_state* state = nullptr;
+    whisper_full_params wparams;
+
+    // ---- 采集回调与工作线程共享 ----
+    SpscRing<float> ring;
+    int sample_rate = 48000;
+    bool lossless = false;
+    std::atomic<uint64_t> dropped_samples{0};
+    std::atomic<size_t> threshold{1};          // 可读数据达到该值时调度
+    std::atomic<bool> scheduled{false};        // 已在运行队列中或正在处理
+    std::atomic<bool> input_finished{false};
+    std::atomic<bool> done{false};
+    std::atomic<int64_t> ready_ns{0};          // 数据首次达到阈值的时刻
+    OverflowPolicy overflow = OVERFLOW_DROP_NEWEST;
+    size_t backlog_limit = 0;                  // 允许积压的样本数（采集采样率）
+    SpscRing<ChunkMark> marks;                 // 采集块的位置与时间戳
+    uint64_t ring_written = 0;                 // 生产者：写入环形缓冲的样本数
+    uint64_t next_position = 0;                // 生产者：无时间信息的回调按此推算位置
+
+    // ---- 溢出到磁盘：工作线程与转存线程在input_mtx下轮流从环形缓冲取数据 ----
+    // 临时文件中的样本整体早于环形缓冲中的样本，文件读空之前只从文件读取
+    std::mutex input_mtx;
+    FILE* spill_file = nullptr;
+    uint64_t spill_read = 0;                   // 临时文件中下一个要读取的样本序号
+    uint64_t spill_write = 0;                  // 临时文件中已写入的样本数
+    std::atomic<uint64_t> spill_pending{0};    // spill_write - spill_read，供调度检查
+    std::vector<float> spill_buf;
+
+    // ---- 工作线程 ----
+    Resampler resampler;
+    StreamingVad vad;
+    MelFrontend mel;
+    LocalAgreement agreement;
+    std::vector<whisper_token> prompt;
+    std::vector<AgreementToken> committed;     // 本次新提交的token
+    std::string text;                          // COMMIT/PARTIAL事件的文本
+    std::string partial_text;                  // 上一次PARTIAL事件的文本及时间(ms)，未变化时不再输出
+    int64_t partial_t0 = 0;
+    int64_t partial_t1 = 0;
+    double last_inference_ms = 0.0;            // 当前窗口的推理耗时
+    uint64_t ring_read = 0;                    // 已从环形缓冲取走的样本数
+    uint64_t in_position = 0;                  // 下一个输入样本的采集位置（采集采样率）
+    bool chunk_silent = false;                 // 当前采集块为已知静音
+    uint64_t sound_end = 0;                    // 最后一个非静音采集块的结束位置(16kHz)
+    std::deque<TimeAnchor> anchors;            // 当前窗口范围内的时间对应点
+    uint64_t mark_position = 0;                // 最近一个采集块标记，跳过积压后据此重建时间对应点
+    int64_t mark_capture_ns = 0;
+    bool need_anchor = false;
+    uint64_t dropped_reported = 0;             // 已通过OVERFLOW事件报告的dropped_samples
+    bool behind = false;                       // 上次处理结束时仍有足够再处理一次的积压
+    std::atomic<int64_t> deadline_ns{0};       // 当前推理的截止时刻，0为不限
+    int64_t t_encode_ns = 0;                   // 本次whisper_full开始编码的时刻
+    int64_t t_decode_ns = 0;                   // 本次whisper_full第一次采样token的时刻
+    bool deadline_missed = false;              // 上一次run_inference因超时而放弃
+    float temperature_inc = 0.0f;              // whisper默认的温度回退步长
+    bool lang_auto = false;                    // language为auto且开启了语言锁定
+    int lang_id = -1;                          // 锁定的语言，-1为未锁定
+    uint64_t lang_speech = 0;                  // 未锁定时已推理过的语音样本数(16kHz)
+    uint64_t lang_checked_at = 0;              // 上次检测时的窗口结束位置
+    bool lang_recheck = false;                 // 识别置信度下降，下一个窗口重新检测
+    std::vector<float> lang_probs;
+    int64_t last_wake_ns = 0;
+    SlidingWindow audio_data;                  // 重采样到16kHz后的当前窗口
+    std::vector<float> mel_data;
+    std::vector<StreamSegment> segments;
+    uint64_t window_start = 0;                 // audio_data[0]的绝对样本位置(16kHz)
+    uint64_t infer_end = 0;                    // 上一次推理窗口的结束位置
+    size_t n_samples_seen = 0;                 // audio_data中已参与过推理的样本数
+    bool in_silence = false;
+    int n_samples_step = 0;
+    int n_samples_len = 0;
+
+    StreamStats stats;
+
+    // ---- 监控计数：由当前持有该流的工作线程（dropped_chunks为采集回调）写入，任意线程读取 ----
+    std::atomic<uint64_t> dropped_chunks{0};
+    std::atomic<uint64_t> live_samples_in{0};
+    std::atomic<uint64_t> live_windows{0};
+    std::atomic<uint64_t> live_skipped_windows{0};
+    std::atomic<uint64_t> live_inferences{0};
+    std::atomic<uint64_t> live_inference_ns{0};
+    std::atomic<uint64_t> live_encode_ns{0};
+    std::atomic<uint64_t> live_decode_ns{0};
+    std::atomic<uint64_t> live_deadline_misses{0};
+};
+
+StreamEngine::StreamEngine() = default;
+
+StreamEngine::~StreamEngine() {
+    stop();
+    for (auto& stream : streams_) {
+        if (stream->state) {
+            whisper_free_state(stream->state);
+        }
+        if (stream->spill_file) {
+            fclose(stream->spill_file);
+        }
+    }
+    if (ctx_) {
+        whisper_free(ctx_);
+    }
+}
+
+// ggml的CPU后端以OpenMP构建时，并行区由调用线程的常驻线程组执行：引擎的工作线程本身是常驻的，
+// 每个工作线程的线程组在它处理的所有流、所有whisper_full调用之间复用。
+// 线程组在并行区之间的等待方式由OpenMP运行时的环境变量决定（libgomp与LLVM/Intel运行时各有一套），
+// 只在运行时初始化前读取一次
+void StreamEngine::configure_compute(const ComputeParams& params) {
+    switch (params.wait_policy) {
+    case COMPUTE_WAIT_ACTIVE:
+        set_env_default("OMP_WAIT_POLICY", "ACTIVE");
+        break;
+    case COMPUTE_WAIT_PASSIVE:
+        set_env_default("OMP_WAIT_POLICY", "PASSIVE");
+        break;
+    default:
+        break;
+    }
+
+    int spin_us = params.spin_us;
+    if (params.wait_policy == COMPUTE_WAIT_PASSIVE && spin_us < 0) {
+        spin_us = 0;
+    }
+    if (spin_us >= 0) {
+        // GOMP_SPINCOUNT为自旋次数（按约1ns一次换算），KMP_BLOCKTIME为毫秒
+        set_env_default("GOMP_SPINCOUNT", std::to_string((long long)spin_us * 1000));
+        set_env_default("KMP_BLOCKTIME", std::to_string((spin_us + 999) / 1000));
+    } else if (params.wait_policy == COMPUTE_WAIT_ACTIVE) {
+        set_env_default("KMP_BLOCKTIME", "infinite");
+    }
+}
+
+bool StreamEngine::compute_threads_persistent() {
+    const char* info = whisper_print_system_info();
+    return info && strstr(info, "OPENMP = 1") != nullptr;
+}
+
+bool StreamEngine::load_model(const char* path_model, const whisper_context_params& cparams) {
+    ctx_ = whisper_init_from_file_with_params_no_state(path_model, cparams);
+    return ctx_ != nullptr;
+}
+
+int StreamEngine::add_stream(const StreamParams& params, int sample_rate, bool lossless) {
+    if (!ctx_ || running_) {
+        return -1;
+    }
+
+    std::unique_ptr<Stream> stream(new Stream);
+    stream->engine = this;
+    stream->id = (int)streams_.size();
+    stream->params = params;
+    stream->state = whisper_init_state(ctx_);
+    if (!stream->state) {
+        return -1;
+    }
+
+    // whisper参数设置
+    whisper_full_params& wparams = stream->wparams;
+    wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    wparams.print_progress = false;
+    wparams.print_special = params.print_special;
+    wparams.print_realtime = false;     // 结果通过事件回调输出，避免多路流在stdout上交错
+    wparams.print_timestamps = !params.no_timestamps;
+    wparams.translate = params.translate;
+    wparams.language = stream->params.language.c_str();
+    wparams.n_threads = params.threads;
+    wparams.max_tokens = params.max_tokens;
+    wparams.single_segment = true;
+    wparams.no_context = true;
+    wparams.duration_ms = params.length_ms;
+    wparams.audio_ctx = params.audio_ctx > 0 ? params.audio_ctx : 0;
+    wparams.token_timestamps = params.local_agreement;    // 按token时间裁掉已提交的音频
+    wparams.abort_callback = &StreamEngine::abort_callback;
+    wparams.abort_callback_user_data = stream.get();
+    // 编码/解码分段计时：whisper_get_timings只读取默认状态，对每路流独立的状态不可用
+    wparams.encoder_begin_callback = &StreamEngine::encoder_begin_callback;
+    wparams.encoder_begin_callback_user_data = stream.get();
+    wparams.logits_filter_callback = &StreamEngine::logits_filter_callback;
+    wparams.logits_filter_callback_user_data = stream.get();
+    stream->temperature_inc = wparams.temperature_inc;
+    stream->lang_auto = params.lang_detect_ms > 0 && params.language == "auto";
+
+    // 默认约1秒的采集缓冲（容量向上取整为2的幂）。无损回放由采集回调阻塞，不需要溢出策略；
+    // drop-oldest/skip-to-live由工作线程丢弃积压，缓冲留出余量，使其在工作线程醒来之前不必丢弃新数据
+    stream->sample_rate = sample_rate;
+    stream->lossless = lossless;
+    stream->overflow = lossless ? OVERFLOW_DROP_NEWEST : params.overflow;
+    stream->backlog_limit = std::max<size_t>((size_t)((int64_t)sample_rate * std::max(params.max_backlog_ms, 100) / 1000), 1);
+    size_t capacity = stream->backlog_limit;
+    if (stream->overflow == OVERFLOW_DROP_OLDEST || stream->overflow == OVERFLOW_SKIP_TO_LIVE) {
+        capacity = 2 * stream->backlog_limit + (size_t)((int64_t)sample_rate * params.length_ms / 1000);
+    }
+    if (stream->overflow == OVERFLOW_SPILL_TO_DISK) {
+        stream->spill_file = std::tmpfile();
+        if (!stream->spill_file) {
+            whisper_free_state(stream->state);
+            return -1;
+        }
+    }
+    stream->ring.reset(capacity);
+    stream->marks.reset(MAX_CHUNK_MARKS);
+
+    // 到达的音频立即重采样到16kHz并增量计算VAD与mel
+    stream->resampler.init(sample_rate, WHISPER_SAMPLE_RATE);
+    VadParams vad_params;
+    vad_params.threshold = params.vad_thold;
+    stream->vad.init(vad_params, WHISPER_SAMPLE_RATE);
+    if (params.mel_frontend) {
+        stream->mel.init(whisper_model_n_mels(ctx_), WHISPER_SAMPLE_RATE, WHISPER_N_FFT, WHISPER_HOP_LENGTH);
+    }
+
+    stream->n_samples_step = WHISPER_SAMPLE_RATE * params.step_ms / 1000;
+    stream->n_samples_len = WHISPER_SAMPLE_RATE * params.length_ms / 1000;
+    // 窗口最长为一个窗口加上一次取走的数据，再加上补入的静音
+    if (!stream->audio_data.init((size_t)stream->n_samples_len * 2 + WHISPER_SAMPLE_RATE * MAX_GAP_FILL_S)) {
+        whisper_free_state(stream->state);
+        return -1;
+    }
+    stream->stats.sample_rate = sample_rate;
+    stream->threshold.store(std::max<size_t>(stream->backlog_limit / 2, 1), std::memory_order_relaxed);
+
+    streams_.push_back(std::move(stream));
+    return (int)streams_.size() - 1;
+}
+
+void* StreamEngine::stream_input(int stream_id) {
+    return streams_[stream_id].get();
+}
+
+void StreamEngine::chunk_callback(void* user_data, const float* buffer, int frames, const AudioChunkInfo* info) {
+    auto& stream = *static_cast<Stream*>(user_data);
+    if (info->capture_ns > 0) {
+        // 包末尾的采集时刻到回调被调用
+        const int64_t end_ns = info->capture_ns + (int64_t)frames * 1000000000 / stream.sample_rate;
+        stream.engine->stages_.record(STAGE_CAPTURE, now_ns() - end_ns);
+    }
+    push_chunk(stream, buffer, frames, info);
+}
+
+// 采集回调：只写环形缓冲，数据达到阈值且流未被调度时放入运行队列
+void StreamEngine::push_chunk(Stream& stream, const float* buffer, int frames, const AudioChunkInfo* info) {
+    StreamEngine& engine = *stream.engine;
+    const int64_t t_push = now_ns();
+
+    // 先发布块标记再写样本，工作线程看到样本时一定能看到它所属块的标记；
+    // 标记缓冲满时丢弃标记，之后的块位置仍是绝对的，不连续仍可检测
+    const ChunkMark mark = { stream.ring_written, info->position, info->capture_ns, info->flags };
+    stream.marks.write(&mark, 1);
+
+    size_t written = stream.ring.write(buffer, frames);
+    if (stream.lossless) {
+        // 回放源：等待消费者腾出空间，使投递速度与推理速度一致
+        while (written < (size_t)frames && engine.running_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            written += stream.ring.write(buffer + written, frames - written);
+        }
+    }
+    stream.ring_written += written;
+    if (written < (size_t)frames) {
+        stream.dropped_samples.fetch_add(frames - written, std::memory_order_relaxed);
+        counter_add(stream.dropped_chunks, 1);
+        trace_instant("drop", now_ns(), stream.id);
+    }
+
+    // 与工作线程清除scheduled后的检查配对，避免丢失唤醒
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stream.ring.read_available() >= stream.threshold.load(std::memory_order_relaxed)) {
+        int64_t expected = 0;
+        stream.ready_ns.compare_exchange_strong(expected, now_ns(), std::memory_order_relaxed);
+        if (engine.event_driven_ && engine.running_) {
+            engine.schedule(stream);
+        }
+    }
+    const int64_t t_pushed = now_ns();
+    engine.stages_.record(STAGE_ENQUEUE, t_pushed - t_push);
+    trace_complete("enqueue", t_push, t_pushed, stream.id);
+}
+
+void StreamEngine::audio_callback(void* user_data, float* buffer, int frames) {
+    auto& stream = *static_cast<Stream*>(user_data);
+
+    AudioChunkInfo info = {};
+    info.position = stream.next_position;
+    info.capture_ns = now_ns() - (int64_t)frames * 1000000000 / stream.sample_rate;
+    stream.next_position += frames;
+    push_chunk(stream, buffer, frames, &info);
+}
+
+bool StreamEngine::start(int n_workers, bool event_driven) {
+    if (!ctx_ || streams_.empty() || running_) {
+        return false;
+    }
+
+    event_driven_ = event_driven;
+    running_ = true;
+    t_start_ = std::chrono::steady_clock::now();
+    n_workers = std::max(1, n_workers);
+    for (int i = 0; i < n_workers; i++) {
+        workers_.emplace_back(&StreamEngine::worker_loop, this, i, n_workers);
+    }
+    for (auto& stream : streams_) {
+        if (stream->spill_file) {
+            spill_thread_ = std::thread(&StreamEngine::spill_loop, this);
+            break;
+        }
+    }
+    return true;
+}
+
+void StreamEngine::schedule(Stream& stream) {
+    if (stream.scheduled.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        run_queue_.push_back(&stream);
+        queue_depth_.store(run_queue_.size(), std::memory_order_relaxed);
+    }
+    cv_.notify_one();
+}
+
+// 超时兜底/轮询模式：检查所有流是否有足够数据
+void StreamEngine::poll_streams() {
+    for (auto& stream : streams_) {
+        if (stream->done) {
+            continue;
+        }
+        if (stream->input_finished ||
+            backlog(*stream) >= stream->threshold.load(std::memory_order_relaxed)) {
+            schedule(*stream);
+        }
+    }
+}
+
+void StreamEngine::worker_loop(int index, int n_workers) {
+    trace_set_thread_name("inference " + std::to_string(index));
+    // 固定后whisper的计算线程由本线程创建，继承同一组CPU（Windows上由进程默认CPU集合保证）
+    if (!worker_cpus_.empty()) {
+        const std::vector<int> cpus = partition_cpus(worker_cpus_, n_workers, index);
+        if (!pin_current_thread(cpus)) {
+            std::cerr << "Failed to pin worker " << index << " to CPUs " << format_cpu_list(cpus) << std::endl;
+        }
+    }
+
+    const auto timeout = event_driven_ ? std::chrono::milliseconds(1000) : std::chrono::milliseconds(10);
+
+    while (true) {
+        Stream* stream = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait_for(lock, timeout, [&] { return !run_queue_.empty() || !running_; });
+            if (!running_) {
+                break;
+            }
+            if (!run_queue_.empty()) {
+                stream = run_queue_.front();
+                run_queue_.pop_front();
+                queue_depth_.store(run_queue_.size(), std::memory_order_relaxed);
+                n_busy_++;
+            }
+        }
+
+        if (stream) {
+            process_stream(*stream);
+
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (--n_busy_ == 0 && run_queue_.empty()) {
+                idle_cv_.notify_all();
+            }
+        } else {
+            poll_streams();
+        }
+    }
+}
+
+void StreamEngine::emit(const StreamEvent& event) {
+    if (event_callback_) {
+        const int64_t t_emit = now_ns();
+        event_callback_(event_user_data_, &event);
+        const int64_t t_emitted = now_ns();
+        stages_.record(STAGE_OUTPUT, t_emitted - t_emit);
+        trace_complete("output", t_emit, t_emitted, event.stream_id);
+    }
+    if ((event.type == STREAM_EVENT_SEGMENTS || event.type == STREAM_EVENT_COMMIT) && event.capture_ns > 0) {
+        stages_.record(STAGE_END_TO_END, now_ns() - event.capture_ns);
+    }
+}
+
+// 处理一路流：取走凑满当前窗口所需的数据，窗口凑满（或输入结束）时推理一次。
+// 积压超过一个窗口时不会一次取走，而是逐个窗口处理（处理完立即重新调度）
+void StreamEngine::process_stream(Stream& s) {
+    using clock = std::chrono::steady_clock;
+    TraceSpan span("process", s.id);
+    s.stats.n_wakeups++;
+
+    // 落后于实时的时间：上次处理结束时仍有积压，则到这次处理之间都算落后
+    const int64_t wake_ns = now_ns();
+    if (s.behind && s.last_wake_ns > 0) {
+        s.stats.behind_live_s += (wake_ns - s.last_wake_ns) / 1e9;
+    }
+    s.last_wake_ns = wake_ns;
+    s.stats.max_lag_ms = std::max(s.stats.max_lag_ms, backlog(s) * 1000.0 / s.sample_rate);
+
+    // 当累积足够的音频数据时进行处理：
+    // 默认等窗口凑满length_ms；稳定前缀模式每到达step_ms新音频就对未提交的部分推理一次
+    const bool agreement = s.params.local_agreement;
+    // 凑齐当前窗口还需要的样本数（换算为采集采样率）
+    auto input_needed = [&]() {
+        const size_t n_target = agreement ? s.n_samples_seen + s.n_samples_step : (size_t)s.n_samples_len;
+        const size_t n_needed = s.audio_data.size() < n_target ? n_target - s.audio_data.size() : 1;
+        return (size_t)((uint64_t)n_needed * s.sample_rate / WHISPER_SAMPLE_RATE) + 1;
+    };
+
+    // 必须先读取结束标志再取数据，保证结束后缓冲中不再有新数据
+    const bool input_finished = s.input_finished;
+    if (!s.lossless) {
+        handle_overflow(s);
+    }
+    {
+        const size_t n_before = s.audio_data.size();
+        consume_input(s, input_needed(), false);
+        const int64_t t_features = now_ns();
+        s.vad.process(s.audio_data.data() + n_before, s.audio_data.size() - n_before);
+        if (s.params.mel_frontend) {
+            s.mel.process(s.audio_data.data() + n_before, s.audio_data.size() - n_before);
+        }
+        if (s.audio_data.size() > n_before) {
+            const int64_t t_featured = now_ns();
+            stages_.record(STAGE_FEATURES, t_featured - t_features);
+            trace_complete("features", t_features, t_featured, s.id);
+        }
+    }
+    const bool drained = input_finished && backlog(s) == 0;
+
+    // 音频源结束后，处理最后不足一个窗口的剩余音频
+    const bool flush_tail = drained && s.audio_data.size() > s.n_samples_seen;
+
+    const bool window_ready = agreement
+        ? s.audio_data.size() >= s.n_samples_seen + s.n_samples_step
+        : s.audio_data.size() >= (size_t)s.n_samples_len;
+    if (window_ready || flush_tail) {
+        const int64_t ready_ns = s.ready_ns.exchange(0, std::memory_order_relaxed);
+        if (ready_ns > 0) {
+            const int64_t wait_ns = now_ns() - ready_ns;
+            s.stats.wake_latency.record(wait_ns);
+            stages_.record(STAGE_QUEUE_WAIT, wait_ns);
+        }
+
+        s.last_inference_ms = 0.0;
+
+        // 上次推理之后的新音频中有语音才需要推理，之前的部分已经在上一个窗口中处理过；
+        // 新音频全部是设备报告的静音或补入的丢失部分时，不必再看VAD
+        const uint64_t window_end = s.window_start + s.audio_data.size();
+        const uint64_t new_start = std::max(s.window_start, s.infer_end);
+        const bool known_silent = s.sound_end <= new_start;
+        const bool is_valid = !known_silent && s.vad.has_speech(new_start, window_end);
+        s.vad.count_window(!is_valid);
+        if (known_silent) {
+            s.stats.silent_windows++;
+        }
+        counter_add(s.live_windows, 1);
+        if (!is_valid) {
+            counter_add(s.live_skipped_windows, 1);
+        }
+
+        if (!is_valid) {
+            if (!s.in_silence) {
+                StreamEvent event = {};
+                event.type = STREAM_EVENT_SILENCE;
+                event.stream_id = s.id;
+                event.n_samples = s.audio_data.size();
+                event.window_end = window_end;
+                event.vad_score = s.vad.last_score();
+                event.capture_ns = capture_time(s, window_end);
+                emit(event);
+                s.in_silence = true;
+            }
+            if (agreement) {
+                // 语音已结束，未稳定的部分不会再有新的上下文
+                s.committed.clear();
+                s.agreement.flush(s.committed);
+                emit_agreement(s);
+            }
+        } else {
+            s.in_silence = false;
+            s.lang_speech += window_end - new_start;
+
+            // 稳定前缀模式下只有强制提交的推理是最终结果
+            const bool force = flush_tail || s.audio_data.size() >= (size_t)s.n_samples_len;
+            const int ret = run_inference(s, window_end, !agreement || force);
+            if (s.deadline_missed) {
+                StreamEvent event = {};
+                event.type = STREAM_EVENT_DEADLINE;
+                event.stream_id = s.id;
+                event.error = ret;
+                event.n_samples = s.audio_data.size();
+                event.window_end = window_end;
+                event.inference_ms = s.last_inference_ms;
+                event.vad_score = s.vad.last_score();
+                event.capture_ns = capture_time(s, window_end);
+                emit(event);
+            } else if (ret != 0) {
+                StreamEvent event = {};
+                event.type = STREAM_EVENT_ERROR;
+                event.stream_id = s.id;
+                event.error = ret;
+                event.n_samples = s.audio_data.size();
+                event.window_end = window_end;
+                event.inference_ms = s.last_inference_ms;
+                event.vad_score = s.vad.last_score();
+                event.capture_ns = capture_time(s, window_end);
+                emit(event);
+            } else if (agreement) {
+                // 窗口凑满length_ms仍未达成一致，或输入已结束时，强制提交
+                update_agreement(s, window_end, force);
+            } else {
+                emit_segments(s);
+            }
+        }
+
+        // 保留最后一部分音频用于下一次处理
+        const int n_samples_keep = s.n_samples_len - s.n_samples_step;
+        uint64_t keep_start = window_end;
+        if (agreement) {
+            // 裁掉已提交部分的音频（对齐到mel帧），最多保留length_ms-step_ms
+            if (is_valid) {
+                const uint64_t committed_end = s.agreement.committed_end() / WHISPER_HOP_LENGTH * WHISPER_HOP_LENGTH;
+                keep_start = std::min(std::max(committed_end, s.window_start), window_end);
+            }
+            if (n_samples_keep > 0) {
+                keep_start = std::max(keep_start, window_end - std::min<uint64_t>(window_end, n_samples_keep));
+            }
+        } else if (n_samples_keep > 0 && s.audio_data.size() > (size_t)n_samples_keep) {
+            keep_start = window_end - n_samples_keep;
+        }
+        s.audio_data.consume((size_t)(keep_start - s.window_start));
+        s.n_samples_seen = s.audio_data.size();
+        s.window_start = keep_start;
+        while (s.anchors.size() > 1 && s.anchors[1].position <= s.window_start) {
+            s.anchors.pop_front();
+        }
+        s.vad.discard_before(s.window_start);
+        s.mel.discard_before(s.window_start);
+    }
+
+    if (drained) {
+        // 保持scheduled，结束的流不再被调度
+        s.stats.wall_s = std::chrono::duration<double>(clock::now() - t_start_).count();
+        {
+            std::lock_guard<std::mutex> lock(done_mtx_);
+            s.done = true;
+        }
+        done_cv_.notify_all();
+        return;
+    }
+
+    // 等待凑齐当前窗口所需的样本（不超过允许积压量的一半，以便及时取走数据）
+    const size_t threshold = std::max<size_t>(std::min(input_needed(), s.backlog_limit / 2), 1);
+    s.threshold.store(threshold, std::memory_order_relaxed);
+    s.ready_ns.store(0, std::memory_order_relaxed);
+    s.behind = backlog(s) >= threshold;
+
+    // 释放调度标志后再检查一次，防止采集回调在此期间写入而未调度
+    s.scheduled.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (s.input_finished || backlog(s) >= s.threshold.load(std::memory_order_relaxed)) {
+        schedule(s);
+    }
+}
+
+// 积压的样本数（采集采样率）：环形缓冲 + 临时文件
+size_t StreamEngine::backlog(Stream& s) {
+    return s.ring.read_available() + (size_t)s.spill_pending.load(std::memory_order_acquire);
+}
+
+// 报告缓冲满丢弃的新数据；积压超过上限时按策略丢弃旧数据并跳到之后的位置
+void StreamEngine::handle_overflow(Stream& s) {
+    const uint64_t window_end = s.window_start + s.audio_data.size();
+
+    const uint64_t dropped = s.dropped_samples.load(std::memory_order_relaxed);
+    if (dropped > s.dropped_reported) {
+        StreamEvent event = {};
+        event.type = STREAM_EVENT_OVERFLOW;
+        event.stream_id = s.id;
+        event.n_samples = (size_t)((dropped - s.dropped_reported) * WHISPER_SAMPLE_RATE / s.sample_rate);
+        event.window_end = window_end;
+        event.capture_ns = capture_time(s, window_end);
+        emit(event);
+        s.dropped_reported = dropped;
+    }
+
+    const size_t queued = backlog(s);
+    if (queued <= s.backlog_limit) {
+        return;
+    }
+    size_t n_discard = 0;
+    if (s.overflow == OVERFLOW_DROP_OLDEST) {
+        n_discard = queued - s.backlog_limit;
+    } else if (s.overflow == OVERFLOW_SKIP_TO_LIVE) {
+        // 只留下最新一个窗口的音频，下一次推理就是最新的内容
+        const size_t n_len_in = (size_t)((uint64_t)s.n_samples_len * s.sample_rate / WHISPER_SAMPLE_RATE);
+        n_discard = queued - std::min(queued, n_len_in);
+    }
+    if (n_discard == 0) {
+        return;
+    }
+
+    // 丢弃的样本仍按采集块标记推进位置，跳过之后的时间保持准确
+    trace_instant("discard_backlog", now_ns(), s.id);
+    const uint64_t in_before = s.in_position;
+    consume_input(s, n_discard, true);
+    const uint64_t skipped = (s.in_position - in_before) * WHISPER_SAMPLE_RATE / s.sample_rate;
+
+    StreamEvent event = {};
+    event.type = STREAM_EVENT_OVERFLOW;
+    event.stream_id = s.id;
+    event.n_samples = (size_t)(s.audio_data.size() - s.n_samples_seen + skipped);
+    event.window_end = window_end + skipped;
+    event.capture_ns = capture_time(s, window_end);
+    emit(event);
+
+    jump_to(s, window_end + skipped);
+}
+
+// 输入跳过了一段音频：当前窗口作废，重采样、VAD和mel从position重新开始
+void StreamEngine::jump_to(Stream& s, uint64_t position) {
+    if (s.params.local_agreement) {
+        // 跳过之后不会再有这段文本的上下文
+        s.committed.clear();
+        s.agreement.flush(s.committed);
+        emit_agreement(s);
+    }
+
+    s.audio_data.clear();
+    s.window_start = position;
+    s.infer_end = position;
+    s.n_samples_seen = 0;
+    s.anchors.clear();
+    s.need_anchor = true;
+    s.resampler.reset();
+    s.vad.restart(position);
+    s.vad.discard_before(position);
+    s.mel.restart(position);
+    s.stats.n_skips++;
+}
+
+// 按到达顺序取走最多max_samples个样本（先临时文件，后环形缓冲），返回取走的数量。
+// discard为true时只推进位置、不处理音频
+size_t StreamEngine::consume_input(Stream& s, size_t max_samples, bool discard) {
+    std::unique_lock<std::mutex> lock;
+    if (s.spill_file) {
+        lock = std::unique_lock<std::mutex>(s.input_mtx);
+    }
+
+    size_t total = 0;
+    while (total < max_samples && s.spill_read < s.spill_write) {
+        const size_t n = (size_t)std::min<uint64_t>(std::min<uint64_t>(max_samples - total, s.spill_write - s.spill_read), SPILL_BLOCK);
+        s.spill_buf.resize(n);
+        size_t got = 0;
+        if (spill_seek(s.spill_file, s.spill_read)) {
+            got = fread(s.spill_buf.data(), sizeof(float), n, s.spill_file);
+        }
+        if (got < n) {
+            // 读取失败的部分以静音代替，保持样本序号与块标记对齐
+            memset(s.spill_buf.data() + got, 0, (n - got) * sizeof(float));
+        }
+        consume_span(s, s.spill_buf.data(), n, discard);
+        s.spill_read += n;
+        total += n;
+    }
+    if (s.spill_file) {
+        if (s.spill_read == s.spill_write) {
+            // 读空后从文件开头复用
+            s.spill_read = s.spill_write = 0;
+        }
+        s.spill_pending.store(s.spill_write - s.spill_read, std::memory_order_release);
+        if (s.spill_write > 0) {
+            return total;
+        }
+    }
+
+    // 直接从环形缓冲原地读取
+    const float* first;
+    const float* second;
+    size_t first_n, second_n;
+    const size_t n = std::min(max_samples - total, s.ring.peek(&first, &first_n, &second, &second_n));
+    const size_t n1 = std::min(n, first_n);
+    consume_span(s, first, n1, discard);
+    consume_span(s, second, n - n1, discard);
+    s.ring.consume(n);
+    return total + n;
+}
+
+// 处理一段连续的输入样本并重采样到audio_data，每个样本只处理一次。
+// 按采集块标记切分：位置跳变处补入静音，记录时间对应点和已知静音的范围
+void StreamEngine::consume_span(Stream& s, const float* data, size_t n, bool discard) {
+    // 下一个块标记，没有时返回nullptr
+    auto next_mark = [&]() -> const ChunkMark* {
+        const ChunkMark* m1;
+        const ChunkMark* m2;
+        size_t n1, n2;
+        if (s.marks.peek(&m1, &n1, &m2, &n2) == 0) return nullptr;
+        return n1 > 0 ? m1 : m2;
+    };
+
+    size_t done = 0;
+    while (done < n) {
+        const ChunkMark* mark;
+        while ((mark = next_mark()) != nullptr && mark->ring_pos <= s.ring_read + done) {
+            if (mark->position > s.in_position) {
+                if (!discard) {
+                    // 采集端丢失了数据：补入静音（最多MAX_GAP_FILL_S秒，并为本段剩余样本留出窗口空间），
+                    // 保持之后的时间准确
+                    static const float zeros[1024] = {};
+                    const size_t n_before = s.audio_data.size();
+                    uint64_t n_fill = std::min<uint64_t>(mark->position - s.in_position, (uint64_t)s.sample_rate * MAX_GAP_FILL_S);
+                    while (n_fill > 0) {
+                        const size_t n_chunk = (size_t)std::min<uint64_t>(n_fill, 1024);
+                        if (s.resampler.max_output(n_chunk) + s.resampler.max_output(n - done) > s.audio_data.free_space()) {
+                            break;
+                        }
+                        resample_into(s.resampler, s.audio_data, zeros, n_chunk);
+                        n_fill -= n_chunk;
+                    }
+                    s.stats.gap_samples += s.audio_data.size() - n_before;
+                }
+                s.stats.discontinuities++;
+                s.in_position = mark->position;
+            } else if (mark->flags & AUDIO_CHUNK_DISCONTINUITY) {
+                s.stats.discontinuities++;
+            }
+            s.chunk_silent = (mark->flags & AUDIO_CHUNK_SILENT) != 0;
+            s.mark_position = mark->position;
+            s.mark_capture_ns = mark->capture_ns;
+            if (!discard) {
+                s.anchors.push_back({ s.window_start + s.audio_data.size(), mark->capture_ns });
+                s.need_anchor = false;
+            }
+            s.marks.consume(1);
+        }
+
+        size_t end = n;
+        if (mark && mark->ring_pos < s.ring_read + n) {
+            end = (size_t)(mark->ring_pos - s.ring_read);
+        }
+        if (!discard) {
+            if (s.need_anchor && s.mark_capture_ns != 0) {
+                // 跳过积压后从采集块中间继续：按最近的块标记推算时间
+                s.anchors.push_back({ s.window_start + s.audio_data.size(),
+                    s.mark_capture_ns + (int64_t)((s.in_position - s.mark_position) * 1000000000 / s.sample_rate) });
+                s.need_anchor = false;
+            }
+            const int64_t t_resample = now_ns();
+            resample_into(s.resampler, s.audio_data, data + done, end - done);
+            const int64_t t_resampled = now_ns();
+            s.engine->stages_.record(STAGE_RESAMPLE, t_resampled - t_resample);
+            trace_complete("resample", t_resample, t_resampled, s.id);
+            if (!s.chunk_silent) {
+                s.sound_end = s.window_start + s.audio_data.size();
+            }
+        } else {
+            s.stats.discarded_samples += end - done;
+        }
+        s.in_position += end - done;
+        done = end;
+    }
+
+    s.ring_read += n;
+    s.stats.samples_in += n;
+    counter_add(s.live_samples_in, n);
+}
+
+// 转存线程：定期把各流积压的音频写入临时文件
+void StreamEngine::spill_loop() {
+    trace_set_thread_name("spill");
+    while (running_) {
+        for (auto& stream : streams_) {
+            if (stream->spill_file && !stream->done) {
+                spill_stream(*stream);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// 环形缓冲积压超过允许量的3/4时（工作线程在1/2时就会被唤醒，说明它正忙），把积压全部写入临时文件；
+// 文件中还有数据时新数据也必须写入文件，保持顺序
+void StreamEngine::spill_stream(Stream& s) {
+    {
+        std::lock_guard<std::mutex> lock(s.input_mtx);
+        if (s.spill_read == s.spill_write && s.ring.read_available() < s.backlog_limit / 4 * 3) {
+            return;
+        }
+
+        const float* first;
+        const float* second;
+        size_t first_n, second_n;
+        const size_t n = s.ring.peek(&first, &first_n, &second, &second_n);
+        if (n == 0 || !spill_seek(s.spill_file, s.spill_write)) {
+            return;
+        }
+        // 写入失败（如磁盘已满）时数据留在环形缓冲中，之后由缓冲满丢弃计数
+        size_t written = fwrite(first, sizeof(float), first_n, s.spill_file);
+        if (written == first_n && second_n > 0) {
+            written += fwrite(second, sizeof(float), second_n, s.spill_file);
+        }
+        if (written == 0) {
+            return;
+        }
+        s.ring.consume(written);
+        s.spill_write += written;
+        s.spill_pending.store(s.spill_write - s.spill_read, std::memory_order_release);
+        s.stats.spilled_samples += written;
+        s.stats.max_spill_samples = std::max(s.stats.max_spill_samples, s.spill_write - s.spill_read);
+    }
+
+    // 数据已从环形缓冲移走，采集回调不会再因此调度该流
+    if (backlog(s) >= s.threshold.load(std::memory_order_relaxed)) {
+        int64_t expected = 0;
+        s.ready_ns.compare_exchange_strong(expected, now_ns(), std::memory_order_relaxed);
+        if (event_driven_) {
+            schedule(s);
+        }
+    }
+}
+
+// 16kHz位置position的采集时刻，未知时返回0。
+// 在相邻两个对应点之间插值，超出最后一个点时按最后两个点的斜率外推（回放速度不是实时时也成立）
+int64_t StreamEngine::capture_time(const Stream& s, uint64_t position) const {
+    for (size_t i = s.anchors.size(); i-- > 0;) {
+        const TimeAnchor& a = s.anchors[i];
+        if (a.position >= position) {
+            continue;
+        }
+        const TimeAnchor* b = i + 1 < s.anchors.size() ? &s.anchors[i + 1] : (i > 0 ? &s.anchors[i - 1] : nullptr);
+        double ns_per_sample = 1e9 / WHISPER_SAMPLE_RATE;
+        if (b && b->position != a.position) {
+            ns_per_sample = (double)(b->capture_ns - a.capture_ns) / ((double)b->position - (double)a.position);
+        }
+        return a.capture_ns + (int64_t)((position - a.position) * ns_per_sample);
+    }
+    return 0;
+}
+
+// whisper的中止回调：超过当前推理的截止时刻时返回true
+bool StreamEngine::abort_callback(void* user_data) {
+    const Stream& s = *static_cast<const Stream*>(user_data);
+    const int64_t deadline = s.deadline_ns.load(std::memory_order_relaxed);
+    return deadline > 0 && now_ns() > deadline;
+}
+
+// whisper开始编码（每次whisper_full一次，温度回退时只重新解码）
+bool StreamEngine::encoder_begin_callback(whisper_context* /*ctx*/, whisper_state* /*state*/, void* user_data) {
+    static_cast<Stream*>(user_data)->t_encode_ns = now_ns();
+    return true;
+}
+
+// 每采样一个token前调用，只记录第一次作为解码的开始
+void StreamEngine::logits_filter_callback(whisper_context* /*ctx*/, whisper_state* /*state*/,
+    const whisper_token_data* /*tokens*/, int /*n_tokens*/, float* /*logits*/, void* user_data) {
+    Stream& s = *static_cast<Stream*>(user_data);
+    if (s.t_decode_ns == 0) {
+        s.t_decode_ns = now_ns();
+    }
+}
+
+// 对[window_start, window_end)推理，返回whisper的返回值。
+// 设置了时间预算时超时中止，余量足够且允许重试时以更宽松的设置（不做温度回退、自适应audio_ctx）再试一次；
+// 最终仍超时则设置deadline_missed
+int StreamEngine::run_inference(Stream& s, uint64_t window_end, bool final_window) {
+    // 非最终结果不值得做温度回退：几百毫秒后就会被下一次推理取代
+    s.wparams.temperature_inc = final_window || s.params.partial_fallback ? s.temperature_inc : 0.0f;
+
+    // 时间预算：实时处理时每次推理要在下一个step_ms的音频到达前完成，已经积压的音频再从中扣除
+    const int64_t t_start = now_ns();
+    const double step_ms = s.params.step_ms;
+    auto lag_ms = [&]() { return backlog(s) * 1000.0 / s.sample_rate; };
+    double budget_ms = 0.0;
+    if (s.params.deadline_ms > 0) {
+        budget_ms = s.params.deadline_ms;
+    } else if (s.params.deadline_ms < 0) {
+        budget_ms = std::max(step_ms - lag_ms(), step_ms / MIN_DEADLINE_DIV);
+    }
+    s.deadline_ns.store(budget_ms > 0.0 ? t_start + (int64_t)(budget_ms * 1e6) : 0, std::memory_order_relaxed);
+
+    const int audio_ctx = s.wparams.audio_ctx;
+    int ret = infer_once(s, window_end, lang_detect_due(s, window_end));
+    s.deadline_missed = false;
+    if (ret != 0 && budget_ms > 0.0 && abort_callback(&s)) {
+        trace_instant("deadline_abort", now_ns(), s.id);
+        s.stats.deadline_aborts++;
+        s.deadline_missed = true;
+
+        const double slack_ms = step_ms - lag_ms() - (now_ns() - t_start) / 1e6;
+        if (s.params.deadline_retry && slack_ms >= step_ms / MIN_DEADLINE_DIV) {
+            s.stats.deadline_retries++;
+            s.wparams.temperature_inc = 0.0f;
+            if (s.wparams.audio_ctx == 0) {
+                const int window_ms = (int)(s.audio_data.size() * 1000 / WHISPER_SAMPLE_RATE);
+                s.wparams.audio_ctx = adaptive_audio_ctx(window_ms, whisper_model_n_audio_ctx(ctx_), s.params.audio_ctx_margin);
+            }
+            s.deadline_ns.store(now_ns() + (int64_t)(slack_ms * 1e6), std::memory_order_relaxed);
+            ret = infer_once(s, window_end, false);
+            s.wparams.audio_ctx = audio_ctx;
+            if (ret == 0 || !abort_callback(&s)) {
+                s.deadline_missed = false;
+            } else {
+                s.stats.deadline_aborts++;
+            }
+        }
+        if (s.deadline_missed) {
+            s.stats.deadline_misses++;
+            counter_add(s.live_deadline_misses, 1);
+        }
+    }
+    s.deadline_ns.store(0, std::memory_order_relaxed);
+    if (ret == 0 && s.lang_id >= 0) {
+        check_token_confidence(s);
+    }
+
+    s.last_inference_ms = (now_ns() - t_start) / 1e6;
+    s.infer_end = window_end;
+    return ret;
+}
+
+// 调用一次whisper，统计推理耗时。detect_lang为true时先在同一份mel上检测语言
+int StreamEngine::infer_once(Stream& s, uint64_t window_end, bool detect_lang) {
+    using clock = std::chrono::steady_clock;
+
+    // 已锁定语言时whisper_full不再每个窗口重复检测
+    if (s.lang_auto) {
+        s.wparams.language = s.lang_id >= 0 ? whisper_lang_str(s.lang_id) : s.params.language.c_str();
+    }
+
+    // 自适应audio_ctx：编码器只处理窗口实际覆盖的帧，而不是填充到30秒
+    if (s.params.audio_ctx < 0) {
+        const int window_ms = (int)(s.audio_data.size() * 1000 / WHISPER_SAMPLE_RATE);
+        s.wparams.audio_ctx = adaptive_audio_ctx(window_ms, whisper_model_n_audio_ctx(ctx_),
+            s.params.audio_ctx_margin);
+    }
+
+    // 稳定前缀模式：已提交的文本作为prompt，解码从已确认的上下文继续
+    if (s.params.local_agreement) {
+        s.agreement.prompt(s.prompt, (size_t)std::max(0, s.params.prompt_tokens));
+        s.wparams.prompt_tokens = s.prompt.empty() ? nullptr : s.prompt.data();
+        s.wparams.prompt_n_tokens = (int)s.prompt.size();
+    }
+
+    const auto t_infer = clock::now();
+    s.t_encode_ns = 0;
+    s.t_decode_ns = 0;
+    int ret;
+    if (s.params.mel_frontend) {
+        // 编码器读取2*audio_ctx帧，不足部分以静音mel填充，与whisper对PCM末尾补零的结果一致
+        const int n_ctx = s.wparams.audio_ctx > 0 ? s.wparams.audio_ctx : whisper_model_n_audio_ctx(ctx_);
+        const int n_len = s.mel.build(s.window_start, window_end, 2 * n_ctx, s.mel_data);
+        ret = whisper_set_mel_with_state(ctx_, s.state, s.mel_data.data(), n_len, s.mel.n_mel());
+        if (ret == 0) {
+            if (detect_lang) {
+                detect_language(s, window_end);
+            }
+            ret = whisper_full_with_state(ctx_, s.state, s.wparams, nullptr, 0);
+        }
+    } else {
+        if (detect_lang &&
+            whisper_pcm_to_mel_with_state(ctx_, s.state, s.audio_data.data(), (int)s.audio_data.size(), s.params.threads) == 0) {
+            detect_language(s, window_end);
+        }
+        ret = whisper_full_with_state(ctx_, s.state, s.wparams, s.audio_data.data(), (int)s.audio_data.size());
+    }
+    const auto infer_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_infer).count();
+    s.stats.inference_ms += infer_ns / 1e6;
+    counter_add(s.live_inference_ns, (uint64_t)infer_ns);
+    const int64_t t_end = now_ns();
+    trace_complete("infer", t_end - infer_ns, t_end, s.id);
+    // 中止或失败的调用可能没有到达解码，只记录完整的
+    if (ret == 0 && s.t_encode_ns > 0 && s.t_decode_ns >= s.t_encode_ns) {
+        stages_.record(STAGE_ENCODE, s.t_decode_ns - s.t_encode_ns);
+        stages_.record(STAGE_DECODE, t_end - s.t_decode_ns);
+        trace_complete("encode", s.t_encode_ns, s.t_decode_ns, s.id);
+        trace_complete("decode", s.t_decode_ns, t_end, s.id);
+        counter_add(s.live_encode_ns, (uint64_t)(s.t_decode_ns - s.t_encode_ns));
+        counter_add(s.live_decode_ns, (uint64_t)(t_end - s.t_decode_ns));
+    }
+    s.stats.n_inferences++;
+    counter_add(s.live_inferences, 1);
+    s.stats.window_samples += s.audio_data.size();
+    s.stats.mel_frames_naive += (s.audio_data.size() + WHISPER_SAMPLE_RATE * WHISPER_CHUNK_SIZE) / WHISPER_HOP_LENGTH;
+    return ret;
+}
+
+// 是否需要在这个窗口上检测语言：未锁定时累计到足够的语音，已锁定时到了定期检测的时间或置信度下降
+bool StreamEngine::lang_detect_due(const Stream& s, uint64_t window_end) const {
+    if (!s.lang_auto) {
+        return false;
+    }
+    if (s.lang_id < 0) {
+        return s.lang_speech >= (uint64_t)WHISPER_SAMPLE_RATE * s.params.lang_detect_ms / 1000;
+    }
+    const uint64_t recheck = (uint64_t)WHISPER_SAMPLE_RATE * s.params.lang_recheck_ms / 1000;
+    return s.lang_recheck || (recheck > 0 && window_end - s.lang_checked_at >= recheck);
+}
+
+// 用状态中已有的mel检测语言。本窗口直接使用检测结果；概率足够时锁定，否则解除锁定重新累计语音
+void StreamEngine::detect_language(Stream& s, uint64_t window_end) {
+    using clock = std::chrono::steady_clock;
+
+    const auto t_detect = clock::now();
+    TraceSpan span("lang_detect", s.id);
+    s.lang_probs.assign(whisper_lang_max_id() + 1, 0.0f);
+    const int id = whisper_lang_auto_detect_with_state(ctx_, s.state, 0, s.params.threads, s.lang_probs.data());
+    s.stats.lang_detect_ms += std::chrono::duration<double, std::milli>(clock::now() - t_detect).count();
+    s.stats.lang_detections++;
+    s.lang_checked_at = window_end;
+    s.lang_recheck = false;
+    if (id < 0) {
+        return;
+    }
+
+    s.wparams.language = whisper_lang_str(id);
+    const float prob = s.lang_probs[id];
+    if (prob < s.params.lang_min_prob) {
+        s.lang_id = -1;
+        s.lang_speech = 0;
+        s.stats.language.clear();
+        return;
+    }
+
+    if (id != s.lang_id) {
+        if (!s.stats.language.empty()) {
+            s.stats.lang_changes++;
+        }
+        s.stats.language = whisper_lang_str(id);
+
+        StreamSegment segment = {};
+        segment.text = whisper_lang_str(id);
+        StreamEvent event = {};
+        event.type = STREAM_EVENT_LANGUAGE;
+        event.stream_id = s.id;
+        event.segments = &segment;
+        event.n_segments = 1;
+        event.n_samples = s.audio_data.size();
+        event.window_end = window_end;
+        event.capture_ns = capture_time(s, window_end);
+        emit(event);
+    }
+    s.lang_id = id;
+    s.stats.language_prob = prob;
+}
+
+// 已锁定语言时用识别结果的平均token概率判断置信度，过低时下一个窗口重新检测
+void StreamEngine::check_token_confidence(Stream& s) {
+    const whisper_token token_eot = whisper_token_eot(ctx_);
+    double sum = 0.0;
+    int n = 0;
+    const int n_segments = whisper_full_n_segments_from_state(s.state);
+    for (int i = 0; i < n_segments; ++i) {
+        const int n_tokens = whisper_full_n_tokens_from_state(s.state, i);
+        for (int j = 0; j < n_tokens; ++j) {
+            const whisper_token_data data = whisper_full_get_token_data_from_state(s.state, i, j);
+            if (data.id < token_eot) {
+                sum += data.p;
+                n++;
+            }
+        }
+    }
+    if (n > 0 && sum / n < LANG_LOW_TOKEN_P) {
+        s.lang_recheck = true;
+    }
+}
+
+// 默认模式：输出整个窗口的识别结果
+void StreamEngine::emit_segments(Stream& s) {
+    const int n_segments = whisper_full_n_segments_from_state(s.state);
+    s.segments.clear();
+    for (int i = 0; i < n_segments; ++i) {
+        StreamSegment segment;
+        segment.text = whisper_full_get_segment_text_from_state(s.state, i);
+        segment.t0 = whisper_full_get_segment_t0_from_state(s.state, i) * 10;
+        segment.t1 = whisper_full_get_segment_t1_from_state(s.state, i) * 10;
+        s.segments.push_back(segment);
+    }
+
+    StreamEvent event = {};
+    event.type = STREAM_EVENT_SEGMENTS;
+    event.stream_id = s.id;
+    event.segments = s.segments.data();
+    event.n_segments = (int)s.segments.size();
+    event.n_samples = s.audio_data.size();
+    event.window_end = s.window_start + s.audio_data.size();
+    event.inference_ms = s.last_inference_ms;
+    event.vad_score = s.vad.last_score();
+    event.capture_ns = capture_time(s, event.window_end);
+    emit(event);
+}
+
+// 稳定前缀模式：把本次推理的token与上一次的假设比较，提交公共前缀
+void StreamEngine::update_agreement(Stream& s, uint64_t window_end, bool force) {
+    const whisper_token token_eot = whisper_token_eot(ctx_);
+
+    std::vector<AgreementToken> hyp;
+    const int n_segments = whisper_full_n_segments_from_state(s.state);
+    for (int i = 0; i < n_segments; ++i) {
+        const int n_tokens = whisper_full_n_tokens_from_state(s.state, i);
+        for (int j = 0; j < n_tokens; ++j) {
+            const whisper_token_data data = whisper_full_get_token_data_from_state(s.state, i, j);
+            if (data.id >= token_eot) {
+                continue;   // 跳过特殊token和时间戳token
+            }
+            AgreementToken token;
+            token.id = data.id;
+            token.text = whisper_full_get_token_text_from_state(ctx_, s.state, i, j);
+            token.t0 = std::min(window_end, s.window_start + (uint64_t)std::max<int64_t>(0, data.t0) * WHISPER_HOP_LENGTH);
+            token.t1 = std::min(window_end, s.window_start + (uint64_t)std::max<int64_t>(0, data.t1) * WHISPER_HOP_LENGTH);
+            hyp.push_back(std::move(token));
+        }
+    }
+
+    s.committed.clear();
+    s.agreement.insert(std::move(hyp), s.committed);
+    if (force) {
+        s.agreement.flush(s.committed);
+    }
+    emit_agreement(s);
+}
+
+// 输出新提交的文本和当前未稳定的文本。未稳定的文本与上次相同时不输出，
+// 变为空时只输出一次空的PARTIAL以清除之前的文本
+void StreamEngine::emit_agreement(Stream& s) {
+    auto emit_tokens = [&](StreamEventType type, const std::vector<AgreementToken>& tokens) {
+        StreamSegment segment;
+        segment.text = s.text.c_str();
+        segment.t0 = tokens.empty() ? 0 : (int64_t)(tokens.front().t0 * 1000 / WHISPER_SAMPLE_RATE);
+        segment.t1 = tokens.empty() ? 0 : (int64_t)(tokens.back().t1 * 1000 / WHISPER_SAMPLE_RATE);
+
+        StreamEvent event = {};
+        event.type = type;
+        event.stream_id = s.id;
+        event.segments = &segment;
+        event.n_segments = tokens.empty() ? 0 : 1;
+        event.n_samples = s.audio_data.size();
+        event.window_end = s.window_start + s.audio_data.size();
+        event.inference_ms = s.last_inference_ms;
+        event.vad_score = s.vad.last_score();
+        event.capture_ns = capture_time(s, tokens.empty() ? event.window_end : tokens.back().t1);
+        emit(event);
+    };
+    auto join_text = [&](const std::vector<AgreementToken>& tokens) {
+        s.text.clear();
+        for (const AgreementToken& token : tokens) {
+            s.text += token.text;
+        }
+    };
+
+    if (!s.committed.empty()) {
+        s.stats.tokens_committed += s.committed.size();
+        join_text(s.committed);
+        emit_tokens(STREAM_EVENT_COMMIT, s.committed);
+    }
+
+    const std::vector<AgreementToken>& pending = s.agreement.pending();
+    join_text(pending);
+    // 未稳定部分的末尾可能停在字符中间（后续字节token尚未解码出来），只输出完整的字符
+    s.text.resize(s.text.size() - utf8_incomplete_tail(s.text.data(), s.text.size()));
+    const int64_t t0 = pending.empty() ? 0 : (int64_t)(pending.front().t0 * 1000 / WHISPER_SAMPLE_RATE);
+    const int64_t t1 = pending.empty() ? 0 : (int64_t)(pending.back().t1 * 1000 / WHISPER_SAMPLE_RATE);
+    if (s.text == s.partial_text && t0 == s.partial_t0 && t1 == s.partial_t1) {
+        return;
+    }
+    s.partial_text = s.text;
+    s.partial_t0 = t0;
+    s.partial_t1 = t1;
+    emit_tokens(STREAM_EVENT_PARTIAL, pending);
+}
+
+void StreamEngine::finish_stream(int stream_id) {
+    Stream& stream = *streams_[stream_id];
+    stream.input_finished = true;
+    if (running_) {
+        schedule(stream);
+    }
+}
+
+void StreamEngine::wait_finished() {
+    std::unique_lock<std::mutex> lock(done_mtx_);
+    done_cv_.wait(lock, [&] {
+        if (!running_) return true;
+        for (auto& stream : streams_) {
+            if (stream->input_finished && !stream->done) return false;
+        }
+        return true;
+    });
+}
+
+void StreamEngine::wait_idle() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    idle_cv_.wait(lock, [&] { return (run_queue_.empty() && n_busy_ == 0) || !running_; });
+}
+
+void StreamEngine::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+    }
+    cv_.notify_all();
+    idle_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(done_mtx_);
+    }
+    done_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    if (spill_thread_.joinable()) {
+        spill_thread_.join();
+    }
+    run_queue_.clear();
+
+    const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start_).count();
+    for (auto& stream : streams_) {
+        if (!stream->done) {
+            stream->stats.wall_s = wall_s;
+        }
+    }
+}
+
+StreamStats StreamEngine::stats(int stream_id) const {
+    const Stream& stream = *streams_[stream_id];
+    StreamStats stats = stream.stats;
+    stats.dropped_samples = stream.dropped_samples.load();
+    stats.mel_frames = stream.mel.frames_computed();
+    stats.vad_enabled = stream.vad.enabled();
+    stats.vad = stream.vad.stats();
+    return stats;
+}
+
+StreamCounters StreamEngine::counters(int stream_id) const {
+    const Stream& stream = *streams_[stream_id];
+    const auto load = [](const std::atomic<uint64_t>& counter) { return counter.load(std::memory_order_relaxed); };
+    StreamCounters c;
+    c.sample_rate = stream.sample_rate;
+    c.samples_in = load(stream.live_samples_in);
+    c.dropped_samples = load(stream.dropped_samples);
+    c.dropped_chunks = load(stream.dropped_chunks);
+    // 从第三个线程读取环形缓冲的两个位置不是同一时刻的，可能短暂得到负值
+    const int64_t available = (int64_t)stream.ring.read_available();
+    c.backlog_samples = (uint64_t)std::max<int64_t>(available, 0) + stream.spill_pending.load(std::memory_order_relaxed);
+    c.windows = load(stream.live_windows);
+    c.skipped_windows = load(stream.live_skipped_windows);
+    c.inferences = load(stream.live_inferences);
+    c.inference_s = load(stream.live_inference_ns) / 1e9;
+    c.encode_s = load(stream.live_encode_ns) / 1e9;
+    c.decode_s = load(stream.live_decode_ns) / 1e9;
+    c.deadline_misses = load(stream.live_deadline_misses);
+    return c;
+}
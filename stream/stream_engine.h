@@ -0,0 +1,283 @@
+#ifndef STREAM_ENGINE_H
+#define STREAM_ENGINE_H
+
+#include "whisper.h"
+#include "resampler.h"
+#include "vad.h"
+#include "mel_frontend.h"
+#include "local_agreement.h"
+#include "spsc_ring.h"
+#include "stage_histogram.h"
+#include "audio_types.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 推理跟不上实时、采集缓冲积压超过上限时的处理策略
+enum OverflowPolicy {
+    OVERFLOW_DROP_NEWEST = 0,    // 缓冲满时丢弃新到达的音频（积压的旧音频按顺序处理完）
+    OVERFLOW_DROP_OLDEST,        // 丢弃最旧的积压音频，只保留最近max_backlog_ms
+    OVERFLOW_SKIP_TO_LIVE,       // 丢弃全部积压和当前窗口，直接跳到最新一个窗口的音频
+    OVERFLOW_SPILL_TO_DISK       // 积压部分写入临时文件，之后按顺序处理，不丢任何音频
+};
+
+// ggml计算线程在两次并行计算之间的等待方式
+enum ComputeWaitPolicy {
+    COMPUTE_WAIT_DEFAULT = 0,    // 不修改运行时默认值
+    COMPUTE_WAIT_ACTIVE,         // 一直自旋：唤醒延迟最低，空闲时占满CPU
+    COMPUTE_WAIT_PASSIVE         // 立即休眠：不占CPU，每次唤醒需要系统调用
+};
+
+// 计算线程池设置，对所有流共享
+struct ComputeParams {
+    ComputeWaitPolicy wait_policy = COMPUTE_WAIT_DEFAULT;
+    int spin_us = -1;                // 休眠前的自旋时长（微秒），-1为运行时默认
+};
+
+// 单路流的推理参数
+struct StreamParams {
+    std::string language = "auto";  // 输入语言（翻译时为目标语言）
+    bool translate = false;
+    bool print_special = false;
+    bool no_timestamps = true;
+    int threads = 8;                 // 每次whisper_full使用的线程数
+    int max_tokens = 32;
+    float vad_thold = 0.6f;          // <=0 表示关闭VAD
+    int step_ms = 500;
+    int length_ms = 5000;
+    int audio_ctx = 0;               // 0为模型默认，-1为按窗口长度自适应
+    float audio_ctx_margin = 0.1f;
+    bool mel_frontend = false;       // 流式mel前端 + whisper_set_mel（false时由whisper_full对整个窗口计算mel）
+    bool local_agreement = false;    // 稳定前缀模式：每个步长推理一次未提交的音频，只输出稳定的文本
+    int prompt_tokens = 128;         // 稳定前缀模式下作为prompt的已提交token数
+    OverflowPolicy overflow = OVERFLOW_DROP_NEWEST;  // 无损回放（lossless）时不生效
+    int max_backlog_ms = 1000;       // 允许积压的音频时长，超过后按overflow策略处理
+    int deadline_ms = 0;             // 每次推理的时间预算：0为不限，-1为按step_ms减去当前积压自动计算
+    bool partial_fallback = true;    // 稳定前缀模式下非强制提交的推理也使用温度回退（false时只做一次贪心解码）
+    bool deadline_retry = false;     // 超时中止后若仍有余量，以更宽松的设置重试一次
+    int lang_detect_ms = 0;          // language为auto时累计这么多语音后检测一次并锁定语言；0为每个窗口由whisper重新检测
+    int lang_recheck_ms = 30000;     // 锁定后每隔这么长的音频重新检测一次，0为不再定期检测
+    float lang_min_prob = 0.5f;      // 检测概率低于该值时不锁定（已锁定的解除锁定）
+};
+
+// 识别结果中的一个片段，时间为毫秒：SEGMENTS事件相对窗口起点，COMMIT/PARTIAL事件为自流开始的绝对时间
+struct StreamSegment {
+    const char* text;
+    int64_t t0;
+    int64_t t1;
+};
+
+enum StreamEventType {
+    STREAM_EVENT_SEGMENTS = 0,   // 一个窗口的识别结果
+    STREAM_EVENT_SILENCE,        // 进入静音（连续跳过的窗口只报告一次）
+    STREAM_EVENT_ERROR,          // whisper推理失败
+    STREAM_EVENT_COMMIT,         // 稳定前缀模式：新提交的最终文本
+    STREAM_EVENT_PARTIAL,        // 稳定前缀模式：当前尚未稳定的文本（之后可能改变），只在变化时输出，无片段表示清除
+    STREAM_EVENT_OVERFLOW,       // 积压超过上限而丢弃了音频：n_samples为丢弃的样本数(16kHz)，window_end为之后的起点
+    STREAM_EVENT_DEADLINE,       // 推理超出时间预算被中止，该窗口没有结果
+    STREAM_EVENT_LANGUAGE        // 锁定的语言改变：segments[0].text为语言代码
+};
+
+struct StreamEvent {
+    StreamEventType type;
+    int stream_id;
+    const StreamSegment* segments;
+    int n_segments;
+    int error;                   // whisper返回值
+    size_t n_samples;            // 窗口样本数(16kHz)
+    uint64_t window_end;         // 窗口结束的绝对样本位置(16kHz)
+    double inference_ms;         // 本窗口的推理耗时，未推理时为0
+    float vad_score;
+    int64_t capture_ns;          // 窗口最后一个样本（COMMIT为最后一个提交的token）的采集时刻，steady_clock纳秒，未知为0
+};
+
+// 事件回调，可能在任意工作线程上被调用（同一路流的事件不会并发）
+typedef void (*stream_event_callback)(void* user_data, const StreamEvent* event);
+
+// 单路流的统计，stop()之后读取
+struct StreamStats {
+    uint64_t samples_in = 0;         // 收到的音频样本数（采集采样率）
+    int sample_rate = 0;
+    double wall_s = 0.0;             // 从start()到处理结束的时间
+    int n_inferences = 0;
+    double inference_ms = 0.0;
+    uint64_t n_wakeups = 0;          // 被调度执行的次数
+    uint64_t dropped_samples = 0;    // 缓冲满而丢弃的新音频样本数（采集采样率）
+    uint64_t discarded_samples = 0;  // drop-oldest/skip-to-live丢弃的积压样本数（采集采样率）
+    uint64_t n_skips = 0;            // 因丢弃积压而跳过的次数
+    uint64_t spilled_samples = 0;    // 写入临时文件的样本数（采集采样率）
+    uint64_t max_spill_samples = 0;  // 临时文件中同时积压的最大样本数
+    double max_lag_ms = 0.0;         // 处理时最大的积压音频时长
+    double behind_live_s = 0.0;      // 积压未能在一次处理内消化（落后于实时）的累计时间
+    uint64_t deadline_misses = 0;    // 超出时间预算而放弃的窗口数
+    uint64_t deadline_aborts = 0;    // 被中止的whisper调用数（包括之后重试成功的）
+    uint64_t deadline_retries = 0;   // 中止后重试的次数
+    std::string language;            // 锁定的语言代码，未锁定为空
+    float language_prob = 0.0f;      // 最近一次锁定时的检测概率
+    uint64_t lang_detections = 0;    // whisper_lang_auto_detect的调用次数
+    uint64_t lang_changes = 0;       // 锁定后又换成其他语言的次数
+    double lang_detect_ms = 0.0;     // 语言检测的总耗时
+    uint64_t mel_frames = 0;
+    uint64_t mel_frames_naive = 0;   // 逐窗口重算时需要的mel帧数
+    uint64_t window_samples = 0;     // 送入推理的窗口样本总数(16kHz)
+    uint64_t tokens_committed = 0;   // 稳定前缀模式下提交的token数
+    uint64_t discontinuities = 0;    // 采集数据不连续的次数（设备报告或位置跳变）
+    uint64_t gap_samples = 0;        // 为丢失的数据补入的静音样本数(16kHz)
+    uint64_t silent_windows = 0;     // 新音频全部为已知静音而跳过的窗口数
+    bool vad_enabled = false;
+    VadStats vad;
+    LatencyHistogram wake_latency;   // 数据就绪到开始处理的延迟
+};
+
+// 单路流的运行中计数，可在处理过程中从任意线程读取（监控用，各项之间不保证一致）
+struct StreamCounters {
+    int sample_rate = 0;
+    uint64_t samples_in = 0;         // 已处理的音频样本数（采集采样率）
+    uint64_t dropped_samples = 0;    // 缓冲满而丢弃的新音频样本数
+    uint64_t dropped_chunks = 0;     // 发生丢弃的采集包数
+    uint64_t backlog_samples = 0;    // 当前积压（环形缓冲与临时文件）
+    uint64_t windows = 0;            // 处理过的窗口数
+    uint64_t skipped_windows = 0;    // 没有新语音而跳过推理的窗口数（VAD或已知静音）
+    uint64_t inferences = 0;         // whisper_full调用数
+    double inference_s = 0.0;
+    double encode_s = 0.0;           // 完整调用中的编码耗时（含提示词解码）
+    double decode_s = 0.0;
+    uint64_t deadline_misses = 0;
+};
+
+// 多路流推理引擎：模型权重只加载一次，每路流持有独立的whisper_state，
+// 由固定数量的工作线程调度执行whisper_full_with_state。
+// 内存随流数增长的只有状态（KV缓存、mel等），而不是整份模型权重。
+//
+// 每路流有自己的无锁环形缓冲：采集回调只写环形缓冲，可读数据达到阈值时把该流放入运行队列
+// （每个处理步至多一次加锁）；同一路流任一时刻只会被一个工作线程处理。
+class StreamEngine {
+public:
+    StreamEngine();
+    ~StreamEngine();
+
+    StreamEngine(const StreamEngine&) = delete;
+    StreamEngine& operator=(const StreamEngine&) = delete;
+
+    // 配置ggml计算线程的自旋/休眠策略，必须在load_model()之前调用（计算运行时首次使用前）；
+    // 用户已通过环境变量设置的项不覆盖
+    static void configure_compute(const ComputeParams& params);
+    // ggml是否以OpenMP构建：是则每个工作线程的计算线程组在whisper_full调用之间常驻并复用，
+    // 否则ggml每次图计算都会创建和销毁线程
+    static bool compute_threads_persistent();
+
+    // 加载模型（不创建默认状态）
+    bool load_model(const char* path_model, const whisper_context_params& cparams);
+    whisper_context* context() const { return ctx_; }
+
+    // 添加一路流，sample_rate为采集采样率；lossless为true时缓冲满则阻塞采集回调而不是丢弃。
+    // 必须在start()之前调用，返回流ID，失败返回-1
+    int add_stream(const StreamParams& params, int sample_rate, bool lossless);
+    int stream_count() const { return (int)streams_.size(); }
+
+    // 传给audio_source_set_chunk_callback的回调与user_data：带采集位置与时间戳，
+    // 丢失的数据以静音补齐，保持绝对时间准确，已知静音的部分不做推理
+    static void chunk_callback(void* user_data, const float* buffer, int frames, const AudioChunkInfo* info);
+    // 传给audio_source_set_callback的回调：位置按收到的样本数累计，时间戳取回调时刻
+    static void audio_callback(void* user_data, float* buffer, int frames);
+    void* stream_input(int stream_id);
+
+    void set_event_callback(stream_event_callback callback, void* user_data) {
+        event_callback_ = callback;
+        event_user_data_ = user_data;
+    }
+
+    // 推理工作线程使用的逻辑CPU，必须在start()之前调用：CPU平均分给各工作线程，
+    // 每个工作线程（及其创建的ggml计算线程）只在自己的一份上运行；为空时不限制
+    void set_worker_cpus(const std::vector<int>& cpus) { worker_cpus_ = cpus; }
+
+    // 启动n_workers个工作线程；event_driven为false时每10ms轮询各流
+    bool start(int n_workers, bool event_driven);
+
+    // 有限长度的输入投递完毕：处理完剩余音频后该流结束
+    void finish_stream(int stream_id);
+
+    // 等待所有已调用finish_stream()的流处理完毕
+    void wait_finished();
+
+    // 等待运行队列清空且没有流正在处理（回放测试按步推进时使用）
+    void wait_idle();
+
+    // 停止工作线程（未结束的流直接丢弃剩余音频）
+    void stop();
+
+    StreamStats stats(int stream_id) const;
+
+    // 各阶段耗时（所有流合并），运行中也可读取
+    const StageRecorder& stage_timings() const { return stages_; }
+    // 运行中的计数与运行队列长度，读取不会阻塞采集与推理
+    StreamCounters counters(int stream_id) const;
+    size_t run_queue_depth() const { return queue_depth_.load(std::memory_order_relaxed); }
+
+private:
+    struct Stream;
+
+    void worker_loop(int index, int n_workers);
+    void poll_streams();
+    void schedule(Stream& stream);
+    void process_stream(Stream& stream);
+    size_t consume_input(Stream& stream, size_t max_samples, bool discard);
+    void consume_span(Stream& stream, const float* data, size_t n, bool discard);
+    size_t backlog(Stream& stream);
+    void handle_overflow(Stream& stream);
+    void jump_to(Stream& stream, uint64_t position);
+    void spill_loop();
+    void spill_stream(Stream& stream);
+    int64_t capture_time(const Stream& stream, uint64_t position) const;
+    int run_inference(Stream& stream, uint64_t window_end, bool final_window);
+    int infer_once(Stream& stream, uint64_t window_end, bool detect_lang);
+    bool lang_detect_due(const Stream& stream, uint64_t window_end) const;
+    void detect_language(Stream& stream, uint64_t window_end);
+    void check_token_confidence(Stream& stream);
+    static bool abort_callback(void* user_data);
+    static bool encoder_begin_callback(whisper_context* ctx, whisper_state* state, void* user_data);
+    static void logits_filter_callback(whisper_context* ctx, whisper_state* state,
+        const whisper_token_data* tokens, int n_tokens, float* logits, void* user_data);
+    void emit_segments(Stream& stream);
+    void update_agreement(Stream& stream, uint64_t window_end, bool force);
+    void emit_agreement(Stream& stream);
+    void emit(const StreamEvent& event);
+    static void push_chunk(Stream& stream, const float* buffer, int frames, const AudioChunkInfo* info);
+
+    whisper_context* ctx_ = nullptr;
+    std::vector<std::unique_ptr<Stream>> streams_;
+
+    stream_event_callback event_callback_ = nullptr;
+    void* event_user_data_ = nullptr;
+
+    std::vector<std::thread> workers_;
+    std::vector<int> worker_cpus_;
+    std::thread spill_thread_;          // 有流使用OVERFLOW_SPILL_TO_DISK时，把积压搬到临时文件
+    std::atomic<bool> running_{false};
+    bool event_driven_ = true;
+    std::chrono::steady_clock::time_point t_start_;
+
+    // 运行队列：就绪的流等待工作线程处理
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Stream*> run_queue_;
+    std::atomic<size_t> queue_depth_{0};   // run_queue_.size()，供监控无锁读取
+    int n_busy_ = 0;                    // 正在处理流的工作线程数
+    std::condition_variable idle_cv_;
+
+    StageRecorder stages_;
+
+    // 流结束通知
+    std::mutex done_mtx_;
+    std::condition_variable done_cv_;
+};
+
+#endif // STREAM_ENGINE_H
@@ -0,0 +1,325 @@
+#include "transcript_sink.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t MAX_PENDING_BYTES = 64 * 1024;    // 格式化文本超过这么多时不等节奏立即写出
+
+// 写入标准输出的文件描述符/句柄：绕过宽字符方式的stdio流（控制台的其他输出使用wprintf），
+// Windows上控制台代码页为UTF-8，直接写UTF-8字节
+void write_stdout(const char* data, size_t n) {
+#ifdef _WIN32
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    while (n > 0) {
+        DWORD written = 0;
+        if (!WriteFile(out, data, (DWORD)std::min<size_t>(n, 1 << 30), &written, nullptr) || written == 0) {
+            return;
+        }
+        data += written;
+        n -= written;
+    }
+#else
+    while (n > 0) {
+        const ssize_t written = write(STDOUT_FILENO, data, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        n -= (size_t)written;
+    }
+#endif
+}
+
+void append_json_string(std::string& out, const std::string& text) {
+    out += '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+// 字幕时间 hh:mm:ss,mmm（SRT）或 hh:mm:ss.mmm（WebVTT）
+void append_cue_time(std::string& out, int64_t ms, char separator) {
+    ms = std::max<int64_t>(ms, 0);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d%c%03d", (int)(ms / 3600000), (int)((ms / 60000) % 60),
+        (int)((ms / 1000) % 60), separator, (int)(ms % 1000));
+    out += buf;
+}
+
+// 控制台时间 m:ss.mmm
+void append_console_time(std::string& out, int64_t ms) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%d:%02d.%03d", (int)(ms / 60000), (int)((ms / 1000) % 60), (int)(ms % 1000));
+    out += buf;
+}
+
+} // namespace
+
+bool TranscriptSink::open(const TranscriptSinkParams& params, int n_streams) {
+    if (running_) {
+        return false;
+    }
+    params_ = params;
+    if (!params_.path.empty() && params_.path != "-") {
+        file_ = fopen(params_.path.c_str(), "wb");
+        if (!file_) {
+            return false;
+        }
+    } else {
+        fflush(stdout);     // 之前由stdio缓冲的输出先写出，保持顺序
+    }
+
+    queues_.clear();
+    for (int i = 0; i < n_streams; i++) {
+        std::unique_ptr<Queue> queue(new Queue);
+        queue->entries.reset(params_.queue_entries);
+        queue->text.reset(params_.queue_bytes);
+        queues_.push_back(std::move(queue));
+    }
+
+    buffer_.clear();
+    cue_index_ = 0;
+    cue_end_ms_.assign(n_streams, 0);
+    if (params_.format == TRANSCRIPT_VTT) {
+        buffer_ += "WEBVTT\n\n";
+    }
+    running_ = true;
+    thread_ = std::thread(&TranscriptSink::output_loop, this);
+    return true;
+}
+
+void TranscriptSink::push(const StreamEvent& event) {
+    if (!running_ || event.stream_id < 0 || event.stream_id >= (int)queues_.size()) {
+        return;
+    }
+    Queue& queue = *queues_[event.stream_id];
+    const bool console = params_.format == TRANSCRIPT_CONSOLE;
+    const bool jsonl = params_.format == TRANSCRIPT_JSONL;
+    // 字幕只取稳定前缀模式提交的文本：逐窗口的段在相邻窗口间重叠重复
+    if (!console && !jsonl && event.type != STREAM_EVENT_COMMIT) {
+        return;
+    }
+
+    Entry entry = {};
+    entry.type = event.type;
+    entry.stream_id = event.stream_id;
+    switch (event.type) {
+    case STREAM_EVENT_SEGMENTS: {
+        // 段的时间相对窗口起点，换算为自流开始的绝对时间
+        const int64_t window_ms = (int64_t)((event.window_end - event.n_samples) * 1000 / WHISPER_SAMPLE_RATE);
+        int last = -1;
+        for (int i = 0; i < event.n_segments; i++) {
+            if (event.segments[i].text && event.segments[i].text[0]) {
+                last = i;
+            }
+        }
+        for (int i = 0; i <= last; i++) {
+            const StreamSegment& segment = event.segments[i];
+            if (!segment.text || !segment.text[0]) {
+                continue;
+            }
+            entry.t0_ms = window_ms + segment.t0;
+            entry.t1_ms = window_ms + segment.t1;
+            entry.last = i == last;
+            enqueue(queue, entry, segment.text);
+        }
+        break;
+    }
+    case STREAM_EVENT_COMMIT:
+    case STREAM_EVENT_PARTIAL:
+        // 未稳定的文本只有JSON Lines输出；空的partial表示之前的未稳定文本已清空
+        if (event.type == STREAM_EVENT_PARTIAL ? !jsonl : event.n_segments == 0) {
+            return;
+        }
+        entry.t0_ms = event.n_segments > 0 ? event.segments[0].t0 : 0;
+        entry.t1_ms = event.n_segments > 0 ? event.segments[0].t1 : 0;
+        entry.last = true;
+        enqueue(queue, entry, event.n_segments > 0 ? event.segments[0].text : "");
+        break;
+    case STREAM_EVENT_SILENCE:
+    case STREAM_EVENT_LANGUAGE:
+        if (!console && !jsonl) {
+            return;
+        }
+        entry.t0_ms = entry.t1_ms = (int64_t)(event.window_end * 1000 / WHISPER_SAMPLE_RATE);
+        entry.last = true;
+        enqueue(queue, entry, event.type == STREAM_EVENT_LANGUAGE ? event.segments[0].text : "");
+        break;
+    default:
+        break;
+    }
+}
+
+// 先写文本再写记录：输出线程看到记录时，文本一定已经可读
+void TranscriptSink::enqueue(Queue& queue, const Entry& entry, const char* text) {
+    const size_t len = strlen(text);
+    if (queue.entries.write_available() < 1 || queue.text.write_available() < len) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Entry e = entry;
+    e.text_len = (uint32_t)len;
+    queue.text.write(text, len);
+    queue.entries.write(&e, 1);
+}
+
+void TranscriptSink::output_loop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(std::max(params_.flush_ms, 1)), [&] { return !running_; });
+        lock.unlock();
+        drain();
+        flush();
+        lock.lock();
+    }
+}
+
+// 取出所有队列中的记录并格式化到buffer_
+void TranscriptSink::drain() {
+    for (auto& queue : queues_) {
+        const Entry* first;
+        const Entry* second;
+        size_t first_n, second_n;
+        while (queue->entries.peek(&first, &first_n, &second, &second_n) > 0) {
+            const Entry entry = *first;
+            text_.resize(entry.text_len);
+            queue->text.read(&text_[0], entry.text_len);
+            queue->entries.consume(1);
+            format(entry, text_);
+            if (buffer_.size() >= MAX_PENDING_BYTES) {
+                flush();
+            }
+        }
+    }
+}
+
+void TranscriptSink::format(const Entry& entry, const std::string& text) {
+    std::string prefix;
+    if (params_.stream_prefix) {
+        prefix = "[" + std::to_string(entry.stream_id) + "] ";
+    }
+
+    switch (params_.format) {
+    case TRANSCRIPT_CONSOLE:
+        if (entry.type == STREAM_EVENT_SILENCE) {
+            buffer_ += prefix + "跳过静音音频段\n";
+        } else if (entry.type == STREAM_EVENT_LANGUAGE) {
+            buffer_ += prefix + "[检测到语言: " + text + "]\n";
+        } else if (!params_.timestamps) {
+            // 文本连续输出；逐窗口模式在一个窗口的所有段之后换行
+            buffer_ += prefix + text;
+            if (entry.type == STREAM_EVENT_SEGMENTS && entry.last) {
+                buffer_ += '\n';
+            }
+        } else {
+            buffer_ += prefix + "[";
+            append_console_time(buffer_, entry.t0_ms);
+            buffer_ += " -> ";
+            append_console_time(buffer_, entry.t1_ms);
+            buffer_ += "] " + text + "\n";
+        }
+        break;
+
+    case TRANSCRIPT_JSONL: {
+        const char* type = "segment";
+        switch (entry.type) {
+        case STREAM_EVENT_COMMIT: type = "commit"; break;
+        case STREAM_EVENT_PARTIAL: type = "partial"; break;
+        case STREAM_EVENT_SILENCE: type = "silence"; break;
+        case STREAM_EVENT_LANGUAGE: type = "language"; break;
+        default: break;
+        }
+        char head[128];
+        snprintf(head, sizeof(head), "{\"stream\": %d, \"type\": \"%s\", \"t0\": %.3f, \"t1\": %.3f, \"text\": ",
+            entry.stream_id, type, entry.t0_ms / 1000.0, entry.t1_ms / 1000.0);
+        buffer_ += head;
+        append_json_string(buffer_, text);
+        buffer_ += "}\n";
+        break;
+    }
+
+    case TRANSCRIPT_SRT:
+    case TRANSCRIPT_VTT: {
+        // whisper的文本以空格开头，字幕中去掉
+        const size_t begin = text.find_first_not_of(' ');
+        if (begin == std::string::npos) {
+            break;
+        }
+        const bool srt = params_.format == TRANSCRIPT_SRT;
+        if (srt) {
+            buffer_ += std::to_string(++cue_index_) + "\n";
+        }
+        // 提交文本的token时间来自不同的窗口，可能与上一条略有交叠
+        int64_t& prev_end = cue_end_ms_[entry.stream_id];
+        const int64_t t0 = std::max(entry.t0_ms, prev_end);
+        const int64_t t1 = std::max(entry.t1_ms, t0 + 1);
+        prev_end = t1;
+        append_cue_time(buffer_, t0, srt ? ',' : '.');
+        buffer_ += " --> ";
+        append_cue_time(buffer_, t1, srt ? ',' : '.');
+        buffer_ += "\n" + prefix;
+        buffer_.append(text, begin, std::string::npos);
+        buffer_ += "\n\n";
+        break;
+    }
+    }
+}
+
+// 合并后的文本一次写出
+void TranscriptSink::flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    if (file_) {
+        fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        fflush(file_);
+    } else {
+        write_stdout(buffer_.data(), buffer_.size());
+    }
+    buffer_.clear();
+}
+
+void TranscriptSink::close() {
+    if (!running_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    drain();
+    flush();
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TRANSCRIPT_SINK_H
+#define TRANSCRIPT_SINK_H
+
+#include "stream_engine.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 识别文本的输出格式
+enum TranscriptFormat {
+    TRANSCRIPT_CONSOLE = 0,     // 与原控制台输出相同：文本连续输出，可带时间戳
+    TRANSCRIPT_JSONL,           // 每个事件一行JSON，含未稳定文本（partial）
+    TRANSCRIPT_SRT,             // SubRip字幕
+    TRANSCRIPT_VTT              // WebVTT字幕
+};
+
+struct TranscriptSinkParams {
+    TranscriptFormat format = TRANSCRIPT_CONSOLE;
+    std::string path;               // 输出文件，空或"-"为标准输出
+    int flush_ms = 50;              // 合并写入的间隔：文本最多延迟这么久写出
+    bool timestamps = false;        // 控制台格式是否带时间戳
+    bool stream_prefix = false;     // 多路流时在文本前标注 "[流ID] "
+    size_t queue_entries = 1024;    // 每路流的队列容量（条）
+    size_t queue_bytes = 256 * 1024;  // 每路流的文本缓冲容量（字节）
+};
+
+// 识别文本的异步输出：引擎的事件回调只把文本拷入该流的无锁队列（不加锁、不分配内存、不做I/O），
+// 输出线程按flush_ms的节奏取出、格式化为UTF-8并合并为一次写入，慢速的终端或管道不会阻塞推理。
+// 队列满时丢弃该条文本并计数
+class TranscriptSink {
+public:
+    TranscriptSink() = default;
+    ~TranscriptSink() { close(); }
+
+    TranscriptSink(const TranscriptSink&) = delete;
+    TranscriptSink& operator=(const TranscriptSink&) = delete;
+
+    // 打开输出并启动输出线程，n_streams为引擎的流数
+    bool open(const TranscriptSinkParams& params, int n_streams);
+
+    // 在引擎事件回调中调用，同一路流的事件不可并发（引擎保证）
+    void push(const StreamEvent& event);
+
+    // 写出队列中剩余的文本并关闭输出
+    void close();
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // 队列中的一条记录，文本在同一路流的文本缓冲中按顺序存放
+    struct Entry {
+        StreamEventType type;
+        int stream_id;
+        int64_t t0_ms;              // 自流开始的绝对时间
+        int64_t t1_ms;
+        uint32_t text_len;
+        bool last;                  // SEGMENTS事件的最后一段
+    };
+    struct Queue {
+        SpscRing<Entry> entries;
+        SpscRing<char> text;
+    };
+
+    void enqueue(Queue& queue, const Entry& entry, const char* text);
+    void output_loop();
+    void drain();
+    void format(const Entry& entry, const std::string& text);
+    void flush();
+
+    TranscriptSinkParams params_;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<uint64_t> dropped_{0};
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+
+    // ---- 输出线程 ----
+    FILE* file_ = nullptr;          // 为空时写标准输出
+    std::string buffer_;            // 待写出的格式化文本
+    std::string text_;
+    int cue_index_ = 0;             // SRT字幕序号
+    std::vector<int64_t> cue_end_ms_;   // 每路流上一条字幕的结束时间，下一条从此之后开始
+};
+
+#endif // TRANSCRIPT_SINK_H
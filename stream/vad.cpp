@@ -0,0 +1,160 @@
+#include "vad.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float clamp01(float x) {
+    return std::min(1.0f, std::max(0.0f, x));
+}
+
+} // namespace
+
+void StreamingVad::init(const VadParams& params, int sample_rate) {
+    params_ = params;
+    sample_rate_ = sample_rate;
+    frame_len_ = sample_rate * params.frame_ms / 1000;
+    hop_len_ = sample_rate * params.hop_ms / 1000;
+    hangover_frames_ = params.hangover_ms / params.hop_ms;
+
+    n_fft_ = 1;
+    while (n_fft_ < frame_len_) n_fft_ <<= 1;
+    fft_.init(n_fft_);
+    bin_lo_ = std::max(1, 100 * n_fft_ / sample_rate);
+    bin_hi_ = std::min(n_fft_ / 2, 4000 * n_fft_ / sample_rate);
+
+    // Hann窗
+    window_.resize(frame_len_);
+    for (int i = 0; i < frame_len_; i++) {
+        window_[i] = 0.5f * (1.0f - std::cos(2.0f * 3.14159265f * i / frame_len_));
+    }
+    fft_in_.assign(n_fft_, 0.0f);
+    spectrum_.resize(n_fft_ / 2 + 1);
+
+    reset();
+}
+
+void StreamingVad::reset() {
+    pending_.clear();
+    pending_pos_ = 0;
+    noise_init_ = false;
+    hangover_left_ = 0;
+    last_score_ = 0.0f;
+    speech_.clear();
+    stats_ = VadStats();
+}
+
+void StreamingVad::restart(uint64_t position) {
+    pending_.clear();
+    pending_pos_ = position;
+    hangover_left_ = 0;
+}
+
+void StreamingVad::process(const float* samples, size_t n) {
+    if (!enabled()) return;
+
+    pending_.insert(pending_.end(), samples, samples + n);
+
+    size_t offset = 0;
+    while (pending_.size() - offset >= (size_t)frame_len_) {
+        const float score = frame_score(pending_.data() + offset);
+        last_score_ = score;
+        stats_.frames_total++;
+
+        // 当前帧的帧移区间
+        const uint64_t hop_start = pending_pos_ + offset;
+        const uint64_t hop_end = hop_start + hop_len_;
+
+        if (score >= params_.threshold) {
+            stats_.frames_speech++;
+            hangover_left_ = hangover_frames_;
+            const uint64_t preroll = (uint64_t)params_.preroll_ms * sample_rate_ / 1000;
+            push_speech(hop_start > preroll ? hop_start - preroll : 0, hop_start + frame_len_);
+        } else if (hangover_left_ > 0) {
+            hangover_left_--;
+            push_speech(hop_start, hop_end + frame_len_ - hop_len_);
+        }
+
+        offset += hop_len_;
+    }
+
+    pending_.erase(pending_.begin(), pending_.begin() + offset);
+    pending_pos_ += offset;
+}
+
+float StreamingVad::frame_score(const float* frame) {
+    // 能量与过零率
+    double energy = 0.0;
+    int crossings = 0;
+    for (int i = 0; i < frame_len_; i++) {
+        energy += (double)frame[i] * frame[i];
+        if (i > 0 && (frame[i] >= 0.0f) != (frame[i - 1] >= 0.0f)) {
+            crossings++;
+        }
+    }
+    const float energy_db = 10.0f * (float)std::log10(energy / frame_len_ + 1e-10);
+    const float zcr = (float)crossings / frame_len_;
+
+    // 噪声底跟踪：下降快；接近噪声底时上升约3dB/s，明显高于噪声底（多为语音）时只上升约0.3dB/s
+    const float rise_per_frame = 0.03f * params_.hop_ms / 10.0f;
+    if (!noise_init_) {
+        noise_floor_db_ = energy_db;
+        noise_init_ = true;
+    } else if (energy_db < noise_floor_db_) {
+        noise_floor_db_ += 0.3f * (energy_db - noise_floor_db_);
+    } else if (energy_db < noise_floor_db_ + 10.0f) {
+        noise_floor_db_ += rise_per_frame;
+    } else {
+        noise_floor_db_ += 0.1f * rise_per_frame;
+    }
+
+    if (energy_db < params_.min_energy_db) {
+        return 0.0f;
+    }
+
+    // 频谱平坦度（几何均值/算术均值）：谐波语音低，白噪声/宽带噪声高
+    for (int i = 0; i < frame_len_; i++) {
+        fft_in_[i] = frame[i] * window_[i];
+    }
+    fft_.forward_real(fft_in_.data(), spectrum_.data());
+    double log_sum = 0.0;
+    double sum = 0.0;
+    for (int k = bin_lo_; k < bin_hi_; k++) {
+        const double power = std::norm(spectrum_[k]) + 1e-12;
+        log_sum += std::log(power);
+        sum += power;
+    }
+    const int n_bins = bin_hi_ - bin_lo_;
+    const float flatness = (float)(std::exp(log_sum / n_bins) / (sum / n_bins));
+
+    // 各特征映射到[0,1]：信噪比3dB→0、15dB→1；平坦度0.1→1、0.6→0；过零率超出语音范围时衰减
+    const float s_energy = clamp01((energy_db - noise_floor_db_ - 3.0f) / 12.0f);
+    const float s_flat = clamp01((0.6f - flatness) / 0.5f);
+    const float s_zcr = zcr < 0.35f ? 1.0f : clamp01((0.5f - zcr) / 0.15f);
+
+    return s_energy * (0.5f * s_flat + 0.5f * s_zcr);
+}
+
+void StreamingVad::push_speech(uint64_t start, uint64_t end) {
+    if (!speech_.empty() && start <= speech_.back().second) {
+        speech_.back().second = std::max(speech_.back().second, end);
+    } else {
+        speech_.emplace_back(start, end);
+    }
+}
+
+bool StreamingVad::has_speech(uint64_t start, uint64_t end) const {
+    if (!enabled()) return true;
+
+    for (auto it = speech_.rbegin(); it != speech_.rend(); ++it) {
+        if (it->second <= start) break;
+        if (it->first < end) return true;
+    }
+    return false;
+}
+
+void StreamingVad::discard_before(uint64_t pos) {
+    while (!speech_.empty() && speech_.front().second <= pos) {
+        speech_.pop_front();
+    }
+}
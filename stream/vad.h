@@ -0,0 +1,88 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include "fft.h"
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// VAD参数
+struct VadParams {
+    float threshold = 0.6f;     // 语音判决阈值 [0-1]，对应 -vt/--vad-thold，<=0 表示关闭VAD
+    int frame_ms = 25;          // 分析帧长
+    int hop_ms = 10;            // 帧移
+    int hangover_ms = 300;      // 语音结束后继续视为语音的时长
+    int preroll_ms = 200;       // 语音开始前一并视为语音的时长
+    float min_energy_db = -55.0f; // 低于该能量(dBFS)的帧直接判为静音
+};
+
+// VAD统计计数
+struct VadStats {
+    uint64_t frames_total = 0;
+    uint64_t frames_speech = 0;
+    uint64_t windows_total = 0;     // 送检的推理窗口数
+    uint64_t windows_skipped = 0;   // 判为非语音而跳过whisper_full的窗口数
+};
+
+// 流式帧级VAD：随音频到达增量计算能量、过零率和频谱平坦度，
+// 每帧只计算一次；语音区间加上前导(pre-roll)和拖尾(hangover)后按绝对样本位置记录，
+// 供推理窗口查询是否包含语音。
+class StreamingVad {
+public:
+    void init(const VadParams& params, int sample_rate);
+    void reset();
+    // 从绝对样本位置position继续（输入跳过了一段音频），保留噪声底估计和统计
+    void restart(uint64_t position);
+
+    // 追加新到达的样本（必须按时间顺序连续）
+    void process(const float* samples, size_t n);
+
+    // [start, end)区间（自开始以来的绝对样本位置）内是否有语音
+    bool has_speech(uint64_t start, uint64_t end) const;
+
+    // 丢弃早于pos的语音区间记录
+    void discard_before(uint64_t pos);
+
+    // 记录一次窗口判决结果
+    void count_window(bool skipped) {
+        stats_.windows_total++;
+        if (skipped) stats_.windows_skipped++;
+    }
+
+    bool enabled() const { return params_.threshold > 0.0f; }
+    float last_score() const { return last_score_; }
+    const VadStats& stats() const { return stats_; }
+
+private:
+    float frame_score(const float* frame);
+    void push_speech(uint64_t start, uint64_t end);
+
+    VadParams params_;
+    int sample_rate_ = 16000;
+    int frame_len_ = 400;
+    int hop_len_ = 160;
+    int n_fft_ = 512;
+    int bin_lo_ = 0;    // 平坦度统计的频带（约100Hz-4kHz）
+    int bin_hi_ = 0;
+    int hangover_frames_ = 0;
+
+    Fft fft_;
+    std::vector<float> window_;
+    std::vector<float> fft_in_;
+    std::vector<std::complex<float>> spectrum_;
+
+    std::vector<float> pending_;     // 尚未凑满一帧的样本（含上一帧重叠部分）
+    uint64_t pending_pos_ = 0;       // pending_[0]的绝对样本位置
+
+    float noise_floor_db_ = 0.0f;
+    bool noise_init_ = false;
+    int hangover_left_ = 0;
+    float last_score_ = 0.0f;
+
+    std::deque<std::pair<uint64_t, uint64_t>> speech_;  // 合并后的语音区间[start, end)
+    VadStats stats_;
+};
+
+#endif // VAD_H
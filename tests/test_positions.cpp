@@ -0,0 +1,191 @@
+// 位置与时间簿记测试：合成信号源（注入数据丢失、设备报告的静音块）经过完整的StreamEngine，
+// 检查事件的window_end/capture_ns单调不减、为丢失补入的静音样本数，以及已知静音的窗口不做推理。
+// 参数为whisper模型路径；模型不存在时返回77（ctest记为跳过）
+#include "whisper.h"
+#include "audio_source.h"
+#include "stream_engine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int EXIT_SKIP = 77;
+
+const double DURATION_S = 6.0;
+const double GAP_INTERVAL_S = 1.0;
+const double GAP_MS = 200.0;
+const int EXPECTED_GAPS = 4;            // 1.0, 2.2, 3.4, 4.6秒处；5.8秒处的丢失之后没有数据，不会被发现
+
+int g_failures = 0;
+
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            g_failures++; \
+        } \
+    } while (0)
+
+// 事件回调外segments已失效，只保留标量字段
+struct EventLog {
+    std::mutex mtx;
+    std::vector<StreamEvent> events;
+};
+
+void on_event(void* user_data, const StreamEvent* event) {
+    auto* log = static_cast<EventLog*>(user_data);
+    StreamEvent copy = *event;
+    copy.segments = nullptr;
+    std::lock_guard<std::mutex> lock(log->mtx);
+    log->events.push_back(copy);
+}
+
+AudioSourceConfig synth_config(AudioSynthSignal signal) {
+    AudioSourceConfig config;
+    audio_source_default_config(&config);
+    config.type = AUDIO_SOURCE_SYNTH;
+    config.synth_signal = signal;
+    config.sample_rate = 48000;
+    config.duration_s = DURATION_S;
+    config.pace = 0.0f;                 // 尽可能快，由引擎无损地消费
+    return config;
+}
+
+// 同一路流的事件按发出顺序：window_end与capture_ns单调不减
+void check_monotonic(const std::vector<StreamEvent>& events, int stream_id) {
+    uint64_t last_end = 0;
+    int64_t last_capture = 0;
+    for (const StreamEvent& event : events) {
+        if (event.stream_id != stream_id || event.type == STREAM_EVENT_PARTIAL) {
+            continue;
+        }
+        CHECK(event.window_end >= last_end, "stream %d: window_end %llu after %llu", stream_id,
+            (unsigned long long)event.window_end, (unsigned long long)last_end);
+        last_end = event.window_end;
+        if (event.capture_ns > 0) {
+            CHECK(event.capture_ns >= last_capture, "stream %d: capture_ns went back by %lld ns", stream_id,
+                (long long)(last_capture - event.capture_ns));
+            last_capture = event.capture_ns;
+        }
+    }
+    const uint64_t timeline = (uint64_t)(DURATION_S * WHISPER_SAMPLE_RATE);
+    CHECK(last_end <= timeline, "stream %d: last window_end %llu beyond the %llu-sample timeline", stream_id,
+        (unsigned long long)last_end, (unsigned long long)timeline);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* model_path = argc > 1 ? argv[1] : nullptr;
+    FILE* model_file = model_path ? fopen(model_path, "rb") : nullptr;
+    if (!model_file) {
+        fprintf(stderr, "skip: 没有模型文件 (%s)\n", model_path ? model_path : "未指定");
+        return EXIT_SKIP;
+    }
+    fclose(model_file);
+
+    StreamEngine engine;
+    whisper_context_params cparams = whisper_context_default_params();
+    cparams.use_gpu = false;
+    if (!engine.load_model(model_path, cparams)) {
+        fprintf(stderr, "无法加载模型 %s\n", model_path);
+        return 1;
+    }
+
+    EventLog log;
+    engine.set_event_callback(on_event, &log);
+
+    // 流0：正弦信号，每秒丢失200ms；流1：设备报告为静音的信号。
+    // 关闭VAD，跳过推理只能来自已知静音
+    AudioSourceConfig gap_config = synth_config(AUDIO_SYNTH_SINE);
+    gap_config.synth_gap_interval_s = GAP_INTERVAL_S;
+    gap_config.synth_gap_ms = GAP_MS;
+    const AudioSourceConfig silent_config = synth_config(AUDIO_SYNTH_SILENCE);
+
+    StreamParams params;
+    params.language = "en";
+    params.threads = 4;
+    params.vad_thold = 0.0f;
+
+    const AudioSourceConfig* configs[] = { &gap_config, &silent_config };
+    std::vector<void*> sources;
+    for (const AudioSourceConfig* config : configs) {
+        void* source = audio_source_create(config);
+        AudioFormat format;
+        if (!source || !audio_source_get_format(source, &format) || !audio_source_initialize(source)) {
+            fprintf(stderr, "无法创建合成信号源\n");
+            return 1;
+        }
+        const int stream_id = engine.add_stream(params, format.sample_rate, true);
+        if (stream_id < 0) {
+            fprintf(stderr, "无法添加流\n");
+            return 1;
+        }
+        audio_source_set_chunk_callback(source, StreamEngine::chunk_callback, engine.stream_input(stream_id));
+        sources.push_back(source);
+    }
+
+    if (!engine.start(1, true)) {
+        fprintf(stderr, "无法启动引擎\n");
+        return 1;
+    }
+    for (void* source : sources) {
+        audio_source_start(source);
+    }
+    std::vector<bool> finished(sources.size(), false);
+    for (size_t n_finished = 0; n_finished < sources.size();) {
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (!finished[i] && audio_source_is_finished(sources[i])) {
+                engine.finish_stream((int)i);
+                finished[i] = true;
+                n_finished++;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    engine.wait_finished();
+    engine.stop();
+    for (void* source : sources) {
+        audio_source_stop(source);
+        audio_source_destroy(source);
+    }
+
+    // ---- 流0：丢失的数据以静音补齐，时间线连续 ----
+    const StreamStats gap_stats = engine.stats(0);
+    const uint64_t gap_each = (uint64_t)(GAP_MS * WHISPER_SAMPLE_RATE / 1000);
+    CHECK(gap_stats.discontinuities == EXPECTED_GAPS, "discontinuities %llu, expected %d",
+        (unsigned long long)gap_stats.discontinuities, EXPECTED_GAPS);
+    const long long gap_error = (long long)gap_stats.gap_samples - (long long)(gap_each * gap_stats.discontinuities);
+    CHECK(gap_error >= -(long long)gap_stats.discontinuities && gap_error <= (long long)gap_stats.discontinuities,
+        "gap_samples %llu, expected %llu per gap", (unsigned long long)gap_stats.gap_samples, (unsigned long long)gap_each);
+    CHECK(gap_stats.n_inferences > 0, "stream with sound was never inferred");
+    check_monotonic(log.events, 0);
+
+    // ---- 流1：全部是已知静音，窗口不做推理 ----
+    const StreamStats silent_stats = engine.stats(1);
+    CHECK(silent_stats.n_inferences == 0, "silent stream ran %d inferences", silent_stats.n_inferences);
+    CHECK(silent_stats.silent_windows > 0, "no window was gated as known silence");
+    int n_silence_events = 0;
+    for (const StreamEvent& event : log.events) {
+        if (event.stream_id != 1) {
+            continue;
+        }
+        CHECK(event.type == STREAM_EVENT_SILENCE, "silent stream emitted event type %d", (int)event.type);
+        n_silence_events += event.type == STREAM_EVENT_SILENCE;
+    }
+    CHECK(n_silence_events == 1, "silent stream reported silence %d times", n_silence_events);
+    check_monotonic(log.events, 1);
+
+    if (g_failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    printf("ok: %llu gaps, %llu gap samples, %llu silent windows\n", (unsigned long long)gap_stats.discontinuities,
+        (unsigned long long)gap_stats.gap_samples, (unsigned long long)silent_stats.silent_windows);
+    return 0;
+}